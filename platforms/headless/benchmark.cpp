@@ -0,0 +1,2484 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include "benchmark.h"
+#include "../../src/gearnes.h"
+#include "../../src/memory.h"
+#include "../../src/mappers/nrom.h"
+#include "../../src/compositor.h"
+#include "../../src/palette.h"
+#include "../../src/ntsc_filter.h"
+
+using namespace std::chrono;
+
+static const unsigned int kCPUBenchmarkCycles = 50000000;
+// CPU cycles in one NTSC frame, the slice GearnesCore hands to RunFor()
+static const unsigned int kFrameCycles = 29780;
+
+// Flat 64KB RAM bus, enough to run synthetic instruction streams
+class BenchmarkMemory : public g6502::MemoryInterface
+{
+public:
+    BenchmarkMemory() { memset(map_, 0, sizeof(map_)); }
+    virtual ~BenchmarkMemory() { }
+    virtual u8 Read(u16 address) { return map_[address]; }
+    virtual void Write(u16 address, u8 value) { map_[address] = value; }
+    virtual void Disassemble(u16, const char*) { }
+    virtual bool IsDisassembled(u16) { return true; }
+    void Load(u16 address, const u8* data, int size) { memcpy(map_ + address, data, size); }
+
+    u32 Checksum() const
+    {
+        u32 checksum = 0;
+        for (int i = 0; i < 0x10000; i++)
+            checksum = (checksum * 31) + map_[i];
+        return checksum;
+    }
+
+private:
+    u8 map_[0x10000];
+};
+
+struct stProgram
+{
+    const char* name;
+    const u8* code;
+    int size;
+};
+
+// ALU heavy loop: arithmetic, logic and shifts on zero page
+static const u8 kProgramALU[] = {
+    0xA2, 0x00,             // $8000 LDX #$00
+    0xA5, 0x10,             // $8002 LDA $10
+    0x18,                   // $8004 CLC
+    0x69, 0x07,             // $8005 ADC #$07
+    0x85, 0x10,             // $8007 STA $10
+    0x45, 0x11,             // $8009 EOR $11
+    0x2A,                   // $800B ROL A
+    0x85, 0x11,             // $800C STA $11
+    0x29, 0x3F,             // $800E AND #$3F
+    0x05, 0x12,             // $8010 ORA $12
+    0x4A,                   // $8012 LSR A
+    0x95, 0x20,             // $8013 STA $20,X
+    0xE8,                   // $8015 INX
+    0xE0, 0x40,             // $8016 CPX #$40
+    0xD0, 0xE8,             // $8018 BNE $8002
+    0x38,                   // $801A SEC
+    0xE5, 0x13,             // $801B SBC $13
+    0x85, 0x13,             // $801D STA $13
+    0x4C, 0x00, 0x80        // $801F JMP $8000
+};
+
+// Memory and stack heavy loop: indexed, indirect, push/pull and subroutines
+static const u8 kProgramMemory[] = {
+    0xA0, 0x00,             // $8000 LDY #$00
+    0xA2, 0x00,             // $8002 LDX #$00
+    0xBD, 0x00, 0x03,       // $8004 LDA $0300,X
+    0x99, 0x00, 0x04,       // $8007 STA $0400,Y
+    0x48,                   // $800A PHA
+    0x20, 0x18, 0x80,       // $800B JSR $8018
+    0x68,                   // $800E PLA
+    0x91, 0x40,             // $800F STA ($40),Y
+    0xC8,                   // $8011 INY
+    0xE8,                   // $8012 INX
+    0xD0, 0xEF,             // $8013 BNE $8004
+    0x4C, 0x02, 0x80,       // $8015 JMP $8002
+    0xB1, 0x40,             // $8018 LDA ($40),Y
+    0x65, 0x50,             // $801A ADC $50
+    0x85, 0x50,             // $801C STA $50
+    0x08,                   // $801E PHP
+    0x28,                   // $801F PLP
+    0x60                    // $8020 RTS
+};
+
+// Branch heavy loop: nested countdown loops
+static const u8 kProgramBranch[] = {
+    0xA0, 0x10,             // $8000 LDY #$10
+    0xA2, 0x20,             // $8002 LDX #$20
+    0xCA,                   // $8004 DEX
+    0xD0, 0xFD,             // $8005 BNE $8004
+    0xE6, 0x60,             // $8007 INC $60
+    0xA5, 0x60,             // $8009 LDA $60
+    0xC9, 0x80,             // $800B CMP #$80
+    0xF0, 0x03,             // $800D BEQ $8012
+    0x88,                   // $800F DEY
+    0xD0, 0xF0,             // $8010 BNE $8002
+    0x4C, 0x00, 0x80        // $8012 JMP $8000
+};
+
+static const stProgram kPrograms[] = {
+    { "alu", kProgramALU, sizeof(kProgramALU) },
+    { "memory", kProgramMemory, sizeof(kProgramMemory) },
+    { "branch", kProgramBranch, sizeof(kProgramBranch) }
+};
+
+static const int kProgramCount = sizeof(kPrograms) / sizeof(kPrograms[0]);
+
+static void LoadProgram(BenchmarkMemory* memory, const stProgram& program)
+{
+    const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+    const u8 pointer[2] = { 0x00, 0x05 };
+
+    memory->Load(0x8000, program.code, program.size);
+    memory->Load(0xFFFA, vectors, 6);
+    memory->Load(0x0040, pointer, 2);
+}
+
+static const char* DispatchEngineName()
+{
+#if defined(G6502_DISPATCH_TABLE) || defined(G6502_DISASM) || defined(G6502_DEBUG)
+    return "table";
+#elif defined(G6502_DISPATCH_THREADED)
+    return "threaded";
+#else
+    return "switch";
+#endif
+}
+
+static const char* FlagsModeName()
+{
+#ifdef G6502_EAGER_FLAGS
+    return "eager";
+#else
+    return "lazy";
+#endif
+}
+
+static bool BenchmarkCPUDispatch()
+{
+    bool ok = true;
+
+    printf("%-8s %-10s %12s %10s %10s\n", "program", "engine", "Mcycles/s", "ns/cycle", "speedup");
+
+    for (int i = 0; i < kProgramCount; i++)
+    {
+        BenchmarkMemory* memory = new BenchmarkMemory();
+        g6502::G6502<g6502::MemoryInterface>* cpu = new g6502::G6502<g6502::MemoryInterface>();
+        LoadProgram(memory, kPrograms[i]);
+        cpu->Init(memory);
+        cpu->Reset();
+
+        steady_clock::time_point start = steady_clock::now();
+        unsigned int table_cycles = 0;
+        while (table_cycles < kCPUBenchmarkCycles)
+            table_cycles += cpu->Tick();
+        double table_seconds = duration_cast<duration<double> >(steady_clock::now() - start).count();
+        u32 table_checksum = memory->Checksum();
+
+        SafeDelete(cpu);
+        SafeDelete(memory);
+
+        memory = new BenchmarkMemory();
+        cpu = new g6502::G6502<g6502::MemoryInterface>();
+        LoadProgram(memory, kPrograms[i]);
+        cpu->Init(memory);
+        cpu->Reset();
+
+        start = steady_clock::now();
+        unsigned int batch_cycles = cpu->RunFor(kCPUBenchmarkCycles);
+        double batch_seconds = duration_cast<duration<double> >(steady_clock::now() - start).count();
+        u32 batch_checksum = memory->Checksum();
+
+        SafeDelete(cpu);
+        SafeDelete(memory);
+
+        printf("%-8s %-10s %12.1f %10.3f %10s\n", kPrograms[i].name, "tick",
+                table_cycles / table_seconds / 1000000.0, table_seconds * 1000000000.0 / table_cycles, "1.00x");
+        printf("%-8s %-10s %12.1f %10.3f %9.2fx\n", kPrograms[i].name, DispatchEngineName(),
+                batch_cycles / batch_seconds / 1000000.0, batch_seconds * 1000000000.0 / batch_cycles,
+                table_seconds / batch_seconds * batch_cycles / table_cycles);
+
+        if ((table_cycles != batch_cycles) || (table_checksum != batch_checksum))
+        {
+            printf("ERROR: %s diverged: %u/%u cycles, checksum %08X/%08X\n", kPrograms[i].name,
+                    table_cycles, batch_cycles, table_checksum, batch_checksum);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+// Flag heavy loop: every ALU result goes through PHP, PLP with arbitrary
+// values (N and Z both set) and branches on each flag
+static const u8 kProgramFlags[] = {
+    0xA2, 0xFF,             // $8000 LDX #$FF
+    0x9A,                   // $8002 TXS
+    0xA9, 0x5A,             // $8003 LDA #$5A
+    0x85, 0x10,             // $8005 STA $10
+    0xA9, 0xC3,             // $8007 LDA #$C3
+    0x85, 0x11,             // $8009 STA $11
+    0xA0, 0x00,             // $800B LDY #$00
+    0xA5, 0x10,             // $800D LDA $10
+    0x65, 0x11,             // $800F ADC $11
+    0x85, 0x10,             // $8011 STA $10
+    0x08,                   // $8013 PHP
+    0xE5, 0x12,             // $8014 SBC $12
+    0x85, 0x11,             // $8016 STA $11
+    0x08,                   // $8018 PHP
+    0xC5, 0x10,             // $8019 CMP $10
+    0x08,                   // $801B PHP
+    0x24, 0x11,             // $801C BIT $11
+    0x08,                   // $801E PHP
+    0x2A,                   // $801F ROL A
+    0x66, 0x12,             // $8020 ROR $12
+    0x08,                   // $8022 PHP
+    0x45, 0x13,             // $8023 EOR $13
+    0x85, 0x12,             // $8025 STA $12
+    0x48,                   // $8027 PHA
+    0x28,                   // $8028 PLP
+    0x08,                   // $8029 PHP
+    0x68,                   // $802A PLA
+    0x99, 0x00, 0x02,       // $802B STA $0200,Y
+    0x68,                   // $802E PLA
+    0x99, 0x00, 0x03,       // $802F STA $0300,Y
+    0x68,                   // $8032 PLA
+    0x99, 0x00, 0x04,       // $8033 STA $0400,Y
+    0x68,                   // $8036 PLA
+    0x99, 0x00, 0x05,       // $8037 STA $0500,Y
+    0x68,                   // $803A PLA
+    0x99, 0x00, 0x06,       // $803B STA $0600,Y
+    0x68,                   // $803E PLA
+    0x99, 0x00, 0x07,       // $803F STA $0700,Y
+    0xB0, 0x02,             // $8042 BCS +2
+    0xE6, 0x14,             // $8044 INC $14
+    0x70, 0x02,             // $8046 BVS +2
+    0xE6, 0x15,             // $8048 INC $15
+    0xF0, 0x02,             // $804A BEQ +2
+    0xE6, 0x16,             // $804C INC $16
+    0x30, 0x02,             // $804E BMI +2
+    0xE6, 0x17,             // $8050 INC $17
+    0xC8,                   // $8052 INY
+    0xD0, 0xB8,             // $8053 BNE $800D
+    0xE6, 0x13,             // $8055 INC $13
+    0x4C, 0x0D, 0x80        // $8057 JMP $800D
+};
+
+static const stProgram kFlagsPrograms[] = {
+    { "flags", kProgramFlags, sizeof(kProgramFlags) },
+    { "alu", kProgramALU, sizeof(kProgramALU) },
+    { "branch", kProgramBranch, sizeof(kProgramBranch) }
+};
+
+static const int kFlagsProgramCount = sizeof(kFlagsPrograms) / sizeof(kFlagsPrograms[0]);
+
+// Results of the eager flags implementation, memory and registers after
+// kCPUBenchmarkCycles. Eager flags are a build option, so they can not run
+// next to the lazy ones: after changing a program or the cycle count,
+// rebuild with "make clean && make EAGER_FLAGS=1" and copy the checksum
+// column of -b cpu-flags here.
+static const u32 kFlagsReference[kFlagsProgramCount] = { 0x57DF0889, 0x99489247, 0xD1450A22 };
+
+static bool BenchmarkCPUFlags()
+{
+    bool ok = true;
+
+    printf("%-8s %-8s %12s %10s %10s\n", "program", "flags", "Mcycles/s", "ns/cycle", "checksum");
+
+    for (int i = 0; i < kFlagsProgramCount; i++)
+    {
+        BenchmarkMemory* memory = new BenchmarkMemory();
+        g6502::G6502<g6502::MemoryInterface>* cpu = new g6502::G6502<g6502::MemoryInterface>();
+        LoadProgram(memory, kFlagsPrograms[i]);
+        cpu->Init(memory);
+        cpu->Reset();
+
+        steady_clock::time_point start = steady_clock::now();
+        unsigned int cycles = cpu->RunFor(kCPUBenchmarkCycles);
+        double seconds = duration_cast<duration<double> >(steady_clock::now() - start).count();
+
+        g6502::stProcessorState state;
+        cpu->GetState(&state);
+        u32 checksum = memory->Checksum();
+        checksum = (checksum * 31) + cycles;
+        checksum = (checksum * 31) + state.PC;
+        checksum = (checksum * 31) + state.A;
+        checksum = (checksum * 31) + state.X;
+        checksum = (checksum * 31) + state.Y;
+        checksum = (checksum * 31) + state.S;
+        checksum = (checksum * 31) + state.P;
+
+        printf("%-8s %-8s %12.1f %10.3f %10X\n", kFlagsPrograms[i].name, FlagsModeName(),
+                cycles / seconds / 1000000.0, seconds * 1000000000.0 / cycles, checksum);
+
+        if (checksum != kFlagsReference[i])
+        {
+            printf("ERROR: %s differs from the eager flags result %08X\n", kFlagsPrograms[i].name, kFlagsReference[i]);
+            ok = false;
+        }
+
+        SafeDelete(cpu);
+        SafeDelete(memory);
+    }
+
+    return ok;
+}
+
+// For runs with nothing to set up or read back
+template <class MemoryImpl>
+static void NoCPUHook(g6502::G6502<MemoryImpl>*)
+{
+}
+
+// Runs the program on the real Gearnes bus (RAM + NROM mapper) for a fixed
+// number of cycles, in RunFor() frame slices like the core. configure()
+// sets the CPU up before its reset and collect() reads its counters after
+// the run. Returns the elapsed time, the checksum covers the cycles and the
+// internal RAM.
+template <class MemoryImpl, class Configure, class Collect>
+static double RunCPUOnNESBus(MemoryImpl* memory, Configure configure, Collect collect, unsigned int* cycles, u32* checksum)
+{
+    g6502::G6502<MemoryImpl>* cpu = new g6502::G6502<MemoryImpl>();
+    cpu->Init(memory);
+    configure(cpu);
+    cpu->Reset();
+
+    memory->Write(0x0040, 0x00);
+    memory->Write(0x0041, 0x05);
+
+    *cycles = 0;
+
+    steady_clock::time_point start = steady_clock::now();
+
+    while (*cycles < kCPUBenchmarkCycles)
+    {
+        *cycles += cpu->RunFor(kFrameCycles);
+    }
+
+    double seconds = duration_cast<duration<double> >(steady_clock::now() - start).count();
+
+    collect(cpu);
+
+    *checksum = *cycles;
+    for (int i = 0; i < 0x800; i++)
+        *checksum = (*checksum * 31) + memory->Read(static_cast<u16>(i));
+
+    SafeDelete(cpu);
+
+    return seconds;
+}
+
+static bool BenchmarkCPUBus()
+{
+    bool ok = true;
+
+    printf("%-8s %-10s %12s %12s %10s\n", "program", "bus", "Mcycles/s", "ns/cycle", "speedup");
+
+    for (int i = 0; i < kProgramCount; i++)
+    {
+        u8* rom = new u8[16 + 0x4000 + 0x2000];
+        memset(rom, 0, 16 + 0x4000 + 0x2000);
+        const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x01, 0x01, 0x00, 0x00 };
+        const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+        memcpy(rom, header, 8);
+        memcpy(rom + 16, kPrograms[i].code, kPrograms[i].size);
+        memcpy(rom + 16 + 0x3FFA, vectors, 6);
+
+        Gearnes::Cartridge* cartridge = new Gearnes::Cartridge();
+        Gearnes::Scheduler* scheduler = new Gearnes::Scheduler();
+        Gearnes::Video* video = new Gearnes::Video();
+        Gearnes::Memory* memory = new Gearnes::Memory(video);
+        Gearnes::NROMMapper* mapper = new Gearnes::NROMMapper(memory, video, cartridge);
+        cartridge->Init();
+        cartridge->LoadFromBuffer(rom, 16 + 0x4000 + 0x2000);
+        // The CPU is driven directly, the PPU only needs a clock to read
+        video->Init(cartridge, scheduler, nullptr);
+        memory->Init();
+        memory->SetCurrentMapper(mapper);
+        mapper->Reset();
+
+        unsigned int virtual_cycles = 0;
+        u32 virtual_checksum = 0;
+        double virtual_seconds = RunCPUOnNESBus<g6502::MemoryInterface>(memory, NoCPUHook<g6502::MemoryInterface>,
+                NoCPUHook<g6502::MemoryInterface>, &virtual_cycles, &virtual_checksum);
+
+        memory->Reset();
+        memory->SetCurrentMapper(mapper);
+        mapper->Reset();
+
+        unsigned int inline_cycles = 0;
+        u32 inline_checksum = 0;
+        double inline_seconds = RunCPUOnNESBus<Gearnes::Memory>(memory, NoCPUHook<Gearnes::Memory>,
+                NoCPUHook<Gearnes::Memory>, &inline_cycles, &inline_checksum);
+
+        double virtual_ns = virtual_seconds * 1000000000.0 / virtual_cycles;
+        double inline_ns = inline_seconds * 1000000000.0 / inline_cycles;
+
+        printf("%-8s %-10s %12.1f %12.3f %10s\n", kPrograms[i].name, "virtual",
+                virtual_cycles / virtual_seconds / 1000000.0, virtual_ns, "1.00x");
+        printf("%-8s %-10s %12.1f %12.3f %9.2fx\n", kPrograms[i].name, "inline",
+                inline_cycles / inline_seconds / 1000000.0, inline_ns, virtual_ns / inline_ns);
+
+        if ((virtual_cycles != inline_cycles) || (virtual_checksum != inline_checksum))
+        {
+            printf("ERROR: %s diverged between bus types\n", kPrograms[i].name);
+            ok = false;
+        }
+
+        SafeDelete(mapper);
+        SafeDelete(memory);
+        SafeDelete(video);
+        SafeDelete(scheduler);
+        SafeDelete(cartridge);
+        SafeDeleteArray(rom);
+    }
+
+    return ok;
+}
+
+// Stack heavy loop: pushes, pulls and nested subroutine calls
+static const u8 kProgramStack[] = {
+    0xA2, 0x00,             // $8000 LDX #$00
+    0x8A,                   // $8002 TXA
+    0x48,                   // $8003 PHA
+    0x08,                   // $8004 PHP
+    0x20, 0x14, 0x80,       // $8005 JSR $8014
+    0x28,                   // $8008 PLP
+    0x68,                   // $8009 PLA
+    0x9D, 0x00, 0x03,       // $800A STA $0300,X
+    0xE8,                   // $800D INX
+    0xD0, 0xF2,             // $800E BNE $8002
+    0x4C, 0x00, 0x80,       // $8010 JMP $8000
+    0xEA,                   // $8013 NOP
+    0x48,                   // $8014 PHA
+    0x8A,                   // $8015 TXA
+    0x48,                   // $8016 PHA
+    0x20, 0x1F, 0x80,       // $8017 JSR $801F
+    0x68,                   // $801A PLA
+    0xAA,                   // $801B TAX
+    0x68,                   // $801C PLA
+    0x60,                   // $801D RTS
+    0xEA,                   // $801E NOP
+    0x08,                   // $801F PHP
+    0x28,                   // $8020 PLP
+    0x60                    // $8021 RTS
+};
+
+// Zero page heavy loop: indexed, read-modify-write and pointer accesses
+static const u8 kProgramZeroPage[] = {
+    0xA2, 0x00,             // $8000 LDX #$00
+    0xB5, 0x00,             // $8002 LDA $00,X
+    0x18,                   // $8004 CLC
+    0x65, 0x20,             // $8005 ADC $20
+    0x95, 0x00,             // $8007 STA $00,X
+    0xE6, 0x20,             // $8009 INC $20
+    0xA4, 0x21,             // $800B LDY $21
+    0xB1, 0x40,             // $800D LDA ($40),Y
+    0x45, 0x22,             // $800F EOR $22
+    0x85, 0x22,             // $8011 STA $22
+    0x26, 0x23,             // $8013 ROL $23
+    0xE8,                   // $8015 INX
+    0xD0, 0xEA,             // $8016 BNE $8002
+    0xE6, 0x21,             // $8018 INC $21
+    0x4C, 0x00, 0x80        // $801A JMP $8000
+};
+
+static const stProgram kRAMPrograms[] = {
+    { "stack", kProgramStack, sizeof(kProgramStack) },
+    { "zeropage", kProgramZeroPage, sizeof(kProgramZeroPage) }
+};
+
+static const int kRAMProgramCount = sizeof(kRAMPrograms) / sizeof(kRAMPrograms[0]);
+
+static bool BenchmarkCPURAM()
+{
+    bool ok = true;
+
+    printf("%-8s %-8s %-6s %12s %10s\n", "program", "bus", "direct", "Mcycles/s", "speedup");
+
+    for (int i = 0; i < kRAMProgramCount; i++)
+    {
+        u8* rom = new u8[16 + 0x4000 + 0x2000];
+        memset(rom, 0, 16 + 0x4000 + 0x2000);
+        const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x01, 0x01, 0x00, 0x00 };
+        const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+        memcpy(rom, header, 8);
+        memcpy(rom + 16, kRAMPrograms[i].code, kRAMPrograms[i].size);
+        memcpy(rom + 16 + 0x3FFA, vectors, 6);
+
+        Gearnes::Cartridge* cartridge = new Gearnes::Cartridge();
+        Gearnes::Scheduler* scheduler = new Gearnes::Scheduler();
+        Gearnes::Video* video = new Gearnes::Video();
+        Gearnes::Memory* memory = new Gearnes::Memory(video);
+        Gearnes::NROMMapper* mapper = new Gearnes::NROMMapper(memory, video, cartridge);
+        cartridge->Init();
+        cartridge->LoadFromBuffer(rom, 16 + 0x4000 + 0x2000);
+        video->Init(cartridge, scheduler, nullptr);
+
+        const char* bus_names[2] = { "virtual", "inline" };
+        u32 reference = 0;
+        double off_seconds_per_cycle = 0.0;
+
+        for (int run = 0; run < 4; run++)
+        {
+            bool inlined = (run >= 2);
+            bool direct = ((run & 1) != 0);
+            unsigned int cycles = 0;
+            u32 checksum = 0;
+            double seconds;
+
+            memory->Init();
+            memory->SetCurrentMapper(mapper);
+            mapper->Reset();
+
+            if (inlined)
+                seconds = RunCPUOnNESBus<Gearnes::Memory>(memory,
+                        [direct](g6502::G6502<Gearnes::Memory>* cpu) { cpu->EnableDirectMemory(direct); },
+                        NoCPUHook<Gearnes::Memory>, &cycles, &checksum);
+            else
+                seconds = RunCPUOnNESBus<g6502::MemoryInterface>(memory,
+                        [direct](g6502::G6502<g6502::MemoryInterface>* cpu) { cpu->EnableDirectMemory(direct); },
+                        NoCPUHook<g6502::MemoryInterface>, &cycles, &checksum);
+
+            double seconds_per_cycle = seconds / cycles;
+
+            if (!direct)
+                off_seconds_per_cycle = seconds_per_cycle;
+
+            printf("%-8s %-8s %-6s %12.1f %9.2fx\n", kRAMPrograms[i].name, bus_names[inlined ? 1 : 0], direct ? "on" : "off",
+                    1.0 / seconds_per_cycle / 1000000.0, off_seconds_per_cycle / seconds_per_cycle);
+
+            if (run == 0)
+            {
+                reference = checksum;
+            }
+            else if (checksum != reference)
+            {
+                printf("ERROR: %s diverged, checksum %08X vs %08X\n", kRAMPrograms[i].name, checksum, reference);
+                ok = false;
+            }
+        }
+
+        SafeDelete(mapper);
+        SafeDelete(memory);
+        SafeDelete(video);
+        SafeDelete(scheduler);
+        SafeDelete(cartridge);
+        SafeDeleteArray(rom);
+    }
+
+    return ok;
+}
+
+// Loop idioms that map onto the fused instruction pairs
+static const u8 kProgramIdioms[] = {
+    0xA2, 0x10,             // $8000 LDX #$10
+    0xCA,                   // $8002 DEX
+    0xD0, 0xFD,             // $8003 BNE $8002
+    0xA0, 0x10,             // $8005 LDY #$10
+    0x88,                   // $8007 DEY
+    0xD0, 0xFD,             // $8008 BNE $8007
+    0xA0, 0x20,             // $800A LDY #$20
+    0xA2, 0x00,             // $800C LDX #$00
+    0xBD, 0x00, 0x03,       // $800E LDA $0300,X
+    0x99, 0x00, 0x04,       // $8011 STA $0400,Y
+    0xC8,                   // $8014 INY
+    0xE8,                   // $8015 INX
+    0xE0, 0x20,             // $8016 CPX #$20
+    0xD0, 0xF4,             // $8018 BNE $800E
+    0xE6, 0x30,             // $801A INC $30
+    0xD0, 0x02,             // $801C BNE $8020
+    0xE6, 0x31,             // $801E INC $31
+    0xA5, 0x30,             // $8020 LDA $30
+    0xC9, 0x80,             // $8022 CMP #$80
+    0xF0, 0x03,             // $8024 BEQ $8029
+    0x4C, 0x00, 0x80,       // $8026 JMP $8000
+    0xE6, 0x32,             // $8029 INC $32
+    0x4C, 0x00, 0x80        // $802B JMP $8000
+};
+
+static const stProgram kFusionPrograms[] = {
+    kPrograms[0],
+    kPrograms[1],
+    kPrograms[2],
+    { "idioms", kProgramIdioms, sizeof(kProgramIdioms) }
+};
+
+static const int kFusionProgramCount = sizeof(kFusionPrograms) / sizeof(kFusionPrograms[0]);
+
+static bool BenchmarkCPUFusion()
+{
+    bool ok = true;
+
+    printf("%-8s %-6s %12s %10s  %s\n", "program", "fusion", "Mcycles/s", "speedup", "fused pairs");
+
+    for (int i = 0; i < kFusionProgramCount; i++)
+    {
+        u8* rom = new u8[16 + 0x4000 + 0x2000];
+        memset(rom, 0, 16 + 0x4000 + 0x2000);
+        const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x01, 0x01, 0x00, 0x00 };
+        const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+        memcpy(rom, header, 8);
+        memcpy(rom + 16, kFusionPrograms[i].code, kFusionPrograms[i].size);
+        memcpy(rom + 16 + 0x3FFA, vectors, 6);
+
+        Gearnes::Cartridge* cartridge = new Gearnes::Cartridge();
+        Gearnes::Scheduler* scheduler = new Gearnes::Scheduler();
+        Gearnes::Video* video = new Gearnes::Video();
+        Gearnes::Memory* memory = new Gearnes::Memory(video);
+        Gearnes::NROMMapper* mapper = new Gearnes::NROMMapper(memory, video, cartridge);
+        cartridge->Init();
+        cartridge->LoadFromBuffer(rom, 16 + 0x4000 + 0x2000);
+        video->Init(cartridge, scheduler, nullptr);
+
+        u32 reference = 0;
+        double off_seconds_per_cycle = 0.0;
+
+        for (int run = 0; run < 2; run++)
+        {
+            bool fusion = (run == 1);
+            g6502::stFusionStats stats;
+            unsigned int cycles = 0;
+            u32 checksum = 0;
+
+            memory->Init();
+            memory->SetCurrentMapper(mapper);
+            mapper->Reset();
+
+            double seconds_per_cycle = RunCPUOnNESBus(memory,
+                    [fusion](g6502::G6502<Gearnes::Memory>* cpu) { cpu->EnableInstructionFusion(fusion); },
+                    [&stats](g6502::G6502<Gearnes::Memory>* cpu) { cpu->GetFusionStats(&stats); },
+                    &cycles, &checksum) / cycles;
+
+            if (!fusion)
+                off_seconds_per_cycle = seconds_per_cycle;
+
+            u64 fused = 0;
+            for (int pair = 0; pair < g6502::kFusedPairCount; pair++)
+                fused += stats.pairs[pair];
+
+            printf("%-8s %-6s %12.1f %9.2fx  %llu\n", kFusionPrograms[i].name, fusion ? "on" : "off",
+                    1.0 / seconds_per_cycle / 1000000.0, off_seconds_per_cycle / seconds_per_cycle,
+                    static_cast<unsigned long long>(fused));
+
+            if (fusion)
+            {
+                for (int pair = 0; pair < g6502::kFusedPairCount; pair++)
+                {
+                    if (stats.pairs[pair] != 0)
+                        printf("%-8s %-6s %s %llu\n", "", "", g6502::kFusedPairNames[pair],
+                                static_cast<unsigned long long>(stats.pairs[pair]));
+                }
+
+                if (checksum != reference)
+                {
+                    printf("ERROR: %s diverged with fusion, checksum %08X vs %08X\n", kFusionPrograms[i].name, checksum, reference);
+                    ok = false;
+                }
+            }
+            else
+            {
+                reference = checksum;
+
+                if (fused != 0)
+                {
+                    printf("ERROR: %s fused pairs with fusion disabled\n", kFusionPrograms[i].name);
+                    ok = false;
+                }
+            }
+        }
+
+        SafeDelete(mapper);
+        SafeDelete(memory);
+        SafeDelete(video);
+        SafeDelete(scheduler);
+        SafeDelete(cartridge);
+        SafeDeleteArray(rom);
+    }
+
+    return ok;
+}
+
+#ifdef G6502_PROFILER
+
+static const stProgram kProfilerPrograms[] = {
+    kPrograms[0],
+    kPrograms[1],
+    kPrograms[2],
+    kRAMPrograms[0]
+};
+
+static const int kProfilerProgramCount = sizeof(kProfilerPrograms) / sizeof(kProfilerPrograms[0]);
+
+struct stProfiledRun
+{
+    unsigned int cycles;
+    // What the profiler saw, 0 when it was off
+    u64 profiled_t_states;
+    u64 profiled_instructions;
+    u32 checksum;
+};
+
+#endif
+
+static bool BenchmarkCPUProfiler()
+{
+#ifndef G6502_PROFILER
+    printf("Built without G6502_PROFILER, rebuild with make PROFILE=1\n");
+    return true;
+#else
+    bool ok = true;
+
+    printf("%-8s %-8s %12s %10s %14s\n", "program", "profiler", "Mcycles/s", "slowdown", "instructions");
+
+    for (int i = 0; i < kProfilerProgramCount; i++)
+    {
+        u8* rom = new u8[16 + 0x4000 + 0x2000];
+        memset(rom, 0, 16 + 0x4000 + 0x2000);
+        const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x01, 0x01, 0x00, 0x00 };
+        const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+        memcpy(rom, header, 8);
+        memcpy(rom + 16, kProfilerPrograms[i].code, kProfilerPrograms[i].size);
+        memcpy(rom + 16 + 0x3FFA, vectors, 6);
+
+        Gearnes::Cartridge* cartridge = new Gearnes::Cartridge();
+        Gearnes::Scheduler* scheduler = new Gearnes::Scheduler();
+        Gearnes::Video* video = new Gearnes::Video();
+        Gearnes::Memory* memory = new Gearnes::Memory(video);
+        Gearnes::NROMMapper* mapper = new Gearnes::NROMMapper(memory, video, cartridge);
+        cartridge->Init();
+        cartridge->LoadFromBuffer(rom, 16 + 0x4000 + 0x2000);
+        video->Init(cartridge, scheduler, nullptr);
+
+        u32 reference = 0;
+        double off_seconds_per_cycle = 0.0;
+
+        for (int run = 0; run < 2; run++)
+        {
+            bool profile = (run == 1);
+            stProfiledRun result;
+            result.profiled_t_states = 0;
+            result.profiled_instructions = 0;
+
+            memory->Init();
+            memory->SetCurrentMapper(mapper);
+            mapper->Reset();
+
+            auto collect = [profile, &result](g6502::G6502<Gearnes::Memory>* cpu)
+            {
+                if (!profile)
+                    return;
+
+                g6502::Profiler* profiler = cpu->GetProfiler();
+                result.profiled_t_states = profiler->GetTotalTStates();
+
+                for (int address = 0; address < 0x10000; address++)
+                    result.profiled_instructions += profiler->GetAddress(static_cast<u16>(address))->instructions;
+            };
+
+            double seconds_per_cycle = RunCPUOnNESBus(memory,
+                    [profile](g6502::G6502<Gearnes::Memory>* cpu) { cpu->EnableProfiler(profile); },
+                    collect, &result.cycles, &result.checksum) / result.cycles;
+
+            if (!profile)
+            {
+                off_seconds_per_cycle = seconds_per_cycle;
+                reference = result.checksum;
+            }
+
+            printf("%-8s %-8s %12.1f %9.2fx %14llu\n", kProfilerPrograms[i].name, profile ? "on" : "off",
+                    1.0 / seconds_per_cycle / 1000000.0, seconds_per_cycle / off_seconds_per_cycle,
+                    static_cast<unsigned long long>(result.profiled_instructions));
+
+            if (profile && (result.checksum != reference))
+            {
+                printf("ERROR: %s diverged with the profiler, checksum %08X vs %08X\n", kProfilerPrograms[i].name, result.checksum, reference);
+                ok = false;
+            }
+
+            if (profile && ((result.profiled_t_states != result.cycles) || (result.profiled_instructions == 0)))
+            {
+                printf("ERROR: %s profiled %llu of %u cycles\n", kProfilerPrograms[i].name,
+                        static_cast<unsigned long long>(result.profiled_t_states), result.cycles);
+                ok = false;
+            }
+        }
+
+        SafeDelete(mapper);
+        SafeDelete(memory);
+        SafeDelete(video);
+        SafeDelete(scheduler);
+        SafeDelete(cartridge);
+        SafeDeleteArray(rom);
+    }
+
+    return ok;
+#endif
+}
+
+static bool BenchmarkCPUInstructionCache()
+{
+#ifndef G6502_INSTRUCTION_CACHE
+    printf("Built without G6502_INSTRUCTION_CACHE, rebuild with make ICACHE=1\n");
+    return true;
+#else
+    bool ok = true;
+
+    printf("%-8s %-10s %12s %10s %10s\n", "program", "i-cache", "ns/cycle", "hit rate", "speedup");
+
+    for (int i = 0; i < kProgramCount; i++)
+    {
+        u8* rom = new u8[16 + 0x4000 + 0x2000];
+        memset(rom, 0, 16 + 0x4000 + 0x2000);
+        const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x01, 0x01, 0x00, 0x00 };
+        const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+        memcpy(rom, header, 8);
+        memcpy(rom + 16, kPrograms[i].code, kPrograms[i].size);
+        memcpy(rom + 16 + 0x3FFA, vectors, 6);
+
+        Gearnes::Cartridge* cartridge = new Gearnes::Cartridge();
+        Gearnes::Scheduler* scheduler = new Gearnes::Scheduler();
+        Gearnes::Video* video = new Gearnes::Video();
+        Gearnes::Memory* memory = new Gearnes::Memory(video);
+        Gearnes::NROMMapper* mapper = new Gearnes::NROMMapper(memory, video, cartridge);
+        cartridge->Init();
+        cartridge->LoadFromBuffer(rom, 16 + 0x4000 + 0x2000);
+        video->Init(cartridge, scheduler, nullptr);
+
+        double seconds_per_cycle[2];
+        u32 checksums[2];
+        g6502::stInstructionCacheStats stats[2];
+
+        for (int cached = 0; cached < 2; cached++)
+        {
+            memory->Init();
+            memory->SetCurrentMapper(mapper);
+            mapper->Reset();
+
+            unsigned int cycles = 0;
+            seconds_per_cycle[cached] = RunCPUOnNESBus(memory,
+                    [cached](g6502::G6502<Gearnes::Memory>* cpu) { cpu->EnableInstructionCache(cached != 0); },
+                    [cached, &stats](g6502::G6502<Gearnes::Memory>* cpu) { cpu->GetInstructionCacheStats(&stats[cached]); },
+                    &cycles, &checksums[cached]) / cycles;
+        }
+
+        u64 lookups = stats[1].hits + stats[1].misses + stats[1].uncached;
+
+        printf("%-8s %-10s %12.3f %10s %10s\n", kPrograms[i].name, "off",
+                seconds_per_cycle[0] * 1000000000.0, "-", "1.00x");
+        printf("%-8s %-10s %12.3f %9.2f%% %9.2fx\n", kPrograms[i].name, "on",
+                seconds_per_cycle[1] * 1000000000.0, (lookups > 0) ? (stats[1].hits * 100.0 / lookups) : 0.0,
+                seconds_per_cycle[0] / seconds_per_cycle[1]);
+
+        if (checksums[0] != checksums[1])
+        {
+            printf("ERROR: %s diverged with the instruction cache\n", kPrograms[i].name);
+            ok = false;
+        }
+
+        if ((stats[1].hits == 0) || (stats[0].hits + stats[0].misses + stats[0].uncached != 0))
+        {
+            printf("ERROR: %s instruction cache counters are wrong\n", kPrograms[i].name);
+            ok = false;
+        }
+
+        SafeDelete(mapper);
+        SafeDelete(memory);
+        SafeDelete(video);
+        SafeDelete(scheduler);
+        SafeDelete(cartridge);
+        SafeDeleteArray(rom);
+    }
+
+    return ok;
+#endif
+}
+
+// PPU setup: palette, two nametables, 64 sprites through OAM DMA, then
+// rendering on and one of the loops below
+static const u8 kProgramPPUSetup[] = {
+    0x78,                   // $8000 SEI
+    0xD8,                   // $8001 CLD
+    0xA2, 0xFF,             // $8002 LDX #$FF
+    0x9A,                   // $8004 TXS
+    0xA9, 0x00,             // $8005 LDA #$00
+    0x8D, 0x00, 0x20,       // $8007 STA $2000
+    0x8D, 0x01, 0x20,       // $800A STA $2001
+    0xA9, 0x3F,             // $800D LDA #$3F
+    0x8D, 0x06, 0x20,       // $800F STA $2006
+    0xA9, 0x00,             // $8012 LDA #$00
+    0x8D, 0x06, 0x20,       // $8014 STA $2006
+    0xA2, 0x00,             // $8017 LDX #$00
+    0x8A,                   // $8019 TXA
+    0x09, 0x10,             // $801A ORA #$10
+    0x8D, 0x07, 0x20,       // $801C STA $2007
+    0xE8,                   // $801F INX
+    0xE0, 0x20,             // $8020 CPX #$20
+    0xD0, 0xF5,             // $8022 BNE $8019
+    0xA9, 0x20,             // $8024 LDA #$20
+    0x8D, 0x06, 0x20,       // $8026 STA $2006
+    0xA9, 0x00,             // $8029 LDA #$00
+    0x8D, 0x06, 0x20,       // $802B STA $2006
+    0xA0, 0x08,             // $802E LDY #$08
+    0xA2, 0x00,             // $8030 LDX #$00
+    0x8A,                   // $8032 TXA
+    0x8D, 0x07, 0x20,       // $8033 STA $2007
+    0xE8,                   // $8036 INX
+    0xD0, 0xF9,             // $8037 BNE $8032
+    0x88,                   // $8039 DEY
+    0xD0, 0xF6,             // $803A BNE $8032
+    0x8A,                   // $803C TXA
+    0x9D, 0x00, 0x02,       // $803D STA $0200,X
+    0xE8,                   // $8040 INX
+    0xD0, 0xF9,             // $8041 BNE $803C
+    0xA9, 0x02,             // $8043 LDA #$02
+    0x8D, 0x14, 0x40,       // $8045 STA $4014
+    0xA9, 0x00,             // $8048 LDA #$00
+    0x8D, 0x05, 0x20,       // $804A STA $2005
+    0x8D, 0x05, 0x20,       // $804D STA $2005
+    0xA9, 0x10,             // $8050 LDA #$10
+    0x8D, 0x00, 0x20,       // $8052 STA $2000
+    0xA9, 0x1E,             // $8055 LDA #$1E (PPUMASK)
+    0x8D, 0x01, 0x20        // $8057 STA $2001
+};
+
+static const int kPPUSetupMaskOffset = 0x56;
+
+// Idle, every line takes the whole-line path
+static const u8 kProgramPPUStatic[] = {
+    0x4C, 0x5A, 0x80        // $805A JMP $805A
+};
+
+// Rewrites PPUMASK with the same value, every line is split in segments
+// but must come out identical to the static frame
+static const u8 kProgramPPUSegmented[] = {
+    0xA9, 0x1E,             // $805A LDA #$1E
+    0x8D, 0x01, 0x20,       // $805C STA $2001
+    0x4C, 0x5A, 0x80        // $805F JMP $805A
+};
+
+// Changes the horizontal scroll all the time
+static const u8 kProgramPPURaster[] = {
+    0xE6, 0x00,             // $805A INC $00
+    0xA5, 0x00,             // $805C LDA $00
+    0x8D, 0x05, 0x20,       // $805E STA $2005
+    0x8D, 0x05, 0x20,       // $8061 STA $2005
+    0x4C, 0x5A, 0x80        // $8064 JMP $805A
+};
+
+struct stPPUProgram
+{
+    const char* name;
+    const u8* loop;
+    int loop_size;
+    u8 mask;
+};
+
+static const stPPUProgram kPPUPrograms[] = {
+    { "off", kProgramPPUStatic, sizeof(kProgramPPUStatic), 0x00 },
+    { "static", kProgramPPUStatic, sizeof(kProgramPPUStatic), 0x1E },
+    { "segmented", kProgramPPUSegmented, sizeof(kProgramPPUSegmented), 0x1E },
+    { "raster", kProgramPPURaster, sizeof(kProgramPPURaster), 0x1E }
+};
+
+static const int kPPUProgramCount = sizeof(kPPUPrograms) / sizeof(kPPUPrograms[0]);
+
+static const int kPPUBenchmarkFrames = 2000;
+
+// NROM-128 image with the program at $8000 and pseudo random CHR-ROM
+static int BuildPPUROM(u8* rom, const stPPUProgram& program)
+{
+    const int size = 16 + 0x4000 + 0x2000;
+    const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x01, 0x01, 0x01, 0x00 };
+    const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+
+    memset(rom, 0, size);
+    memcpy(rom, header, 8);
+    memcpy(rom + 16, kProgramPPUSetup, sizeof(kProgramPPUSetup));
+    rom[16 + kPPUSetupMaskOffset] = program.mask;
+    memcpy(rom + 16 + sizeof(kProgramPPUSetup), program.loop, program.loop_size);
+    memcpy(rom + 16 + 0x3FFA, vectors, 6);
+
+    u32 seed = 0x12345678;
+
+    for (int i = 0; i < 0x2000; i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        rom[16 + 0x4000 + i] = static_cast<u8>(seed >> 16);
+    }
+
+    return size;
+}
+
+static u32 FrameChecksum(const Gearnes::NES_Color* frame_buffer)
+{
+    u32 checksum = 0;
+
+    for (int i = 0; i < Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT; i++)
+    {
+        checksum = (checksum * 31) + frame_buffer[i].red;
+        checksum = (checksum * 31) + frame_buffer[i].green;
+        checksum = (checksum * 31) + frame_buffer[i].blue;
+    }
+
+    return checksum;
+}
+
+static bool BenchmarkVideoRender()
+{
+    bool ok = true;
+    double off_ms = 0.0;
+    u32 static_checksum = 0;
+
+    u8* rom = new u8[16 + 0x4000 + 0x2000];
+    Gearnes::NES_Color* frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+
+    printf("%-10s %12s %14s %12s\n", "program", "ms/frame", "render ms", "checksum");
+
+    for (int i = 0; i < kPPUProgramCount; i++)
+    {
+        Gearnes::GearnesCore* core = new Gearnes::GearnesCore();
+        core->Init();
+
+        int size = BuildPPUROM(rom, kPPUPrograms[i]);
+
+        if (!core->LoadROMFromBuffer(rom, size))
+        {
+            printf("ERROR: Unable to load %s\n", kPPUPrograms[i].name);
+            SafeDelete(core);
+            ok = false;
+            continue;
+        }
+
+        // Let the setup code finish
+        for (int f = 0; f < 4; f++)
+        {
+            core->RunToVBlank(frame_buffer);
+        }
+
+        steady_clock::time_point start = steady_clock::now();
+
+        for (int f = 0; f < kPPUBenchmarkFrames; f++)
+        {
+            core->RunToVBlank(frame_buffer);
+        }
+
+        steady_clock::time_point end = steady_clock::now();
+
+        double ms = duration_cast<duration<double> >(end - start).count() * 1000.0 / kPPUBenchmarkFrames;
+        u32 checksum = FrameChecksum(frame_buffer);
+
+        if (i == 0)
+        {
+            off_ms = ms;
+        }
+
+        // Rendering cost is the frame time minus the frame time with the PPU off
+        printf("%-10s %12.4f %14.4f %12X\n", kPPUPrograms[i].name, ms, ms - off_ms, checksum);
+
+        if (strcmp(kPPUPrograms[i].name, "static") == 0)
+        {
+            static_checksum = checksum;
+        }
+        else if ((strcmp(kPPUPrograms[i].name, "segmented") == 0) && (checksum != static_checksum))
+        {
+            printf("ERROR: segmented rendering differs from whole-line rendering\n");
+            ok = false;
+        }
+
+        SafeDelete(core);
+    }
+
+    SafeDeleteArray(frame_buffer);
+    SafeDeleteArray(rom);
+
+    return ok;
+}
+
+static const int kComposeLines = 4096;
+static const int kComposeRepeat = 50;
+
+struct stComposeSegment
+{
+    int x_start;
+    int x_end;
+};
+
+// Random line contents in the compositor input format
+static void FillComposeLine(u32* seed, u8* background, u8* sprites)
+{
+    for (int x = 0; x < Gearnes::NES_WIDTH; x++)
+    {
+        *seed = (*seed * 1103515245) + 12345;
+        u32 r = *seed >> 8;
+        u8 color = r & 0x03;
+        background[x] = (color != 0) ? static_cast<u8>(((r >> 2) & 0x0C) | color) : 0;
+        u8 sprite_color = (r >> 4) & 0x03;
+        sprites[x] = ((r & 0x300) == 0) && (sprite_color != 0) ? static_cast<u8>(0x10 | ((r >> 6) & 0x0C) | sprite_color | ((r >> 10) & 0x40) | ((r >> 11) & 0x80)) : 0;
+    }
+}
+
+static bool BenchmarkVideoCompose()
+{
+    bool ok = true;
+
+    u8* backgrounds = new u8[kComposeLines * Gearnes::NES_WIDTH];
+    u8* sprites = new u8[kComposeLines * Gearnes::NES_WIDTH];
+    int* starts = new int[kComposeLines * 2];
+    Gearnes::NES_Color colors[0x20];
+    u8 indexes[0x20];
+    Gearnes::NES_Color* reference = new Gearnes::NES_Color[Gearnes::NES_WIDTH];
+    Gearnes::NES_Color* output = new Gearnes::NES_Color[Gearnes::NES_WIDTH];
+    u8 indexed_reference[Gearnes::NES_WIDTH];
+    u8 indexed_output[Gearnes::NES_WIDTH];
+
+    u32 seed = 0xCAFE;
+
+    for (int i = 0; i < 0x20; i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        colors[i].red = static_cast<u8>(seed >> 8);
+        colors[i].green = static_cast<u8>(seed >> 16);
+        colors[i].blue = static_cast<u8>(seed >> 24);
+        colors[i].alpha = 0xFF;
+        indexes[i] = static_cast<u8>(seed >> 26);
+    }
+
+    const int clip_starts[4] = { 0, 8, 8, Gearnes::NES_WIDTH };
+
+    for (int i = 0; i < kComposeLines; i++)
+    {
+        FillComposeLine(&seed, backgrounds + (i * Gearnes::NES_WIDTH), sprites + (i * Gearnes::NES_WIDTH));
+        starts[i * 2] = clip_starts[(seed >> 4) & 0x03];
+        starts[(i * 2) + 1] = clip_starts[(seed >> 6) & 0x03];
+    }
+
+    // Whole lines, then the odd segments a mid-line register write makes
+    const stComposeSegment segments[] = { { 0, 256 }, { 0, 5 }, { 5, 37 }, { 37, 100 }, { 100, 101 }, { 101, 223 }, { 223, 256 } };
+    const int segment_count = sizeof(segments) / sizeof(segments[0]);
+
+    Gearnes::CompositorFunction scalar = Gearnes::GetCompositor(Gearnes::kCompositorScalar);
+
+    printf("%-8s %12s %12s %10s\n", "path", "ns/line", "ns/segment", "speedup");
+
+    double scalar_ns = 0.0;
+
+    for (int p = 0; p < Gearnes::kCompositorPathCount; p++)
+    {
+        Gearnes::Compositor_Path path = static_cast<Gearnes::Compositor_Path>(p);
+        Gearnes::CompositorFunction compositor = Gearnes::GetCompositor(path);
+
+        if (!IsValidPointer(compositor))
+        {
+            printf("%-8s %12s\n", Gearnes::GetCompositorPathName(path), "unsupported");
+            continue;
+        }
+
+        Gearnes::stCompositorLine line;
+        line.colors = colors;
+        line.indexes = indexes;
+        InitPointer(line.indexed_output);
+
+        // Bit-exact check against the scalar reference, every segment split
+        for (int i = 0; i < kComposeLines; i++)
+        {
+            line.background = backgrounds + (i * Gearnes::NES_WIDTH);
+            line.sprites = sprites + (i * Gearnes::NES_WIDTH);
+            line.background_start = starts[i * 2];
+            line.sprites_start = starts[(i * 2) + 1];
+
+            for (int s = 0; s < segment_count; s++)
+            {
+                line.output = reference;
+                int reference_hit = scalar(line, segments[s].x_start, segments[s].x_end);
+                line.output = output;
+                int hit = compositor(line, segments[s].x_start, segments[s].x_end);
+
+                int bytes = (segments[s].x_end - segments[s].x_start) * static_cast<int>(sizeof(Gearnes::NES_Color));
+
+                if ((hit != reference_hit) || (memcmp(reference + segments[s].x_start, output + segments[s].x_start, bytes) != 0))
+                {
+                    if (ok)
+                    {
+                        printf("ERROR: %s differs from scalar on line %d, pixels %d-%d\n", Gearnes::GetCompositorPathName(path), i, segments[s].x_start, segments[s].x_end);
+                    }
+                    ok = false;
+                }
+
+                // Same again emitting palette indexes
+                InitPointer(line.output);
+                line.indexed_output = indexed_reference;
+                reference_hit = scalar(line, segments[s].x_start, segments[s].x_end);
+                line.indexed_output = indexed_output;
+                hit = compositor(line, segments[s].x_start, segments[s].x_end);
+
+                bytes = segments[s].x_end - segments[s].x_start;
+
+                if ((hit != reference_hit) || (memcmp(indexed_reference + segments[s].x_start, indexed_output + segments[s].x_start, bytes) != 0))
+                {
+                    if (ok)
+                    {
+                        printf("ERROR: %s indexed output differs from scalar on line %d, pixels %d-%d\n", Gearnes::GetCompositorPathName(path), i, segments[s].x_start, segments[s].x_end);
+                    }
+                    ok = false;
+                }
+                InitPointer(line.indexed_output);
+            }
+        }
+
+        line.output = output;
+        int hits = 0;
+
+        steady_clock::time_point start = steady_clock::now();
+
+        for (int r = 0; r < kComposeRepeat; r++)
+        {
+            for (int i = 0; i < kComposeLines; i++)
+            {
+                line.background = backgrounds + (i * Gearnes::NES_WIDTH);
+                line.sprites = sprites + (i * Gearnes::NES_WIDTH);
+                line.background_start = starts[i * 2];
+                line.sprites_start = starts[(i * 2) + 1];
+                hits += (compositor(line, 0, Gearnes::NES_WIDTH) >= 0) ? 1 : 0;
+            }
+        }
+
+        steady_clock::time_point middle = steady_clock::now();
+
+        for (int r = 0; r < kComposeRepeat; r++)
+        {
+            for (int i = 0; i < kComposeLines; i++)
+            {
+                line.background = backgrounds + (i * Gearnes::NES_WIDTH);
+                line.sprites = sprites + (i * Gearnes::NES_WIDTH);
+                line.background_start = starts[i * 2];
+                line.sprites_start = starts[(i * 2) + 1];
+
+                for (int s = 1; s < segment_count; s++)
+                {
+                    hits += (compositor(line, segments[s].x_start, segments[s].x_end) >= 0) ? 1 : 0;
+                }
+            }
+        }
+
+        steady_clock::time_point end = steady_clock::now();
+
+        double count = static_cast<double>(kComposeRepeat) * kComposeLines;
+        double line_ns = duration_cast<duration<double> >(middle - start).count() * 1000000000.0 / count;
+        double segment_ns = duration_cast<duration<double> >(end - middle).count() * 1000000000.0 / (count * (segment_count - 1));
+
+        if (path == Gearnes::kCompositorScalar)
+        {
+            scalar_ns = line_ns;
+        }
+
+        printf("%-8s %12.1f %12.1f %9.2fx%s\n", Gearnes::GetCompositorPathName(path), line_ns, segment_ns, scalar_ns / line_ns, (hits < 0) ? " " : "");
+    }
+
+    printf("Video uses: %s\n", Gearnes::GetCompositorPathName(Gearnes::GetBestCompositorPath()));
+
+    SafeDeleteArray(output);
+    SafeDeleteArray(reference);
+    SafeDeleteArray(starts);
+    SafeDeleteArray(sprites);
+    SafeDeleteArray(backgrounds);
+
+    return ok;
+}
+
+struct stBenchmark
+{
+    const char* name;
+    const char* description;
+    bool (*function)();
+};
+
+static const int kIndexedBenchmarkFrames = 1000;
+static const int kConvertRepeat = 2000;
+
+// Steps PPUMASK through the 8 emphasis combinations, one per frame.
+// Indexed frames keep emphasis per line, so it only changes in VBlank.
+static const u8 kProgramPPUEmphasis[] = {
+    0x2C, 0x02, 0x20,       // $805A BIT $2002
+    0x10, 0xFB,             // $805D BPL $805A
+    0xE6, 0x00,             // $805F INC $00
+    0xA5, 0x00,             // $8061 LDA $00
+    0x0A,                   // $8063 ASL A
+    0x0A,                   // $8064 ASL A
+    0x0A,                   // $8065 ASL A
+    0x0A,                   // $8066 ASL A
+    0x0A,                   // $8067 ASL A
+    0x09, 0x1E,             // $8068 ORA #$1E
+    0x8D, 0x01, 0x20,       // $806A STA $2001
+    0x4C, 0x5A, 0x80        // $806D JMP $805A
+};
+
+// Same with the grayscale bit set
+static const u8 kProgramPPUGrayscale[] = {
+    0x2C, 0x02, 0x20,       // $805A BIT $2002
+    0x10, 0xFB,             // $805D BPL $805A
+    0xE6, 0x00,             // $805F INC $00
+    0xA5, 0x00,             // $8061 LDA $00
+    0x0A,                   // $8063 ASL A
+    0x0A,                   // $8064 ASL A
+    0x0A,                   // $8065 ASL A
+    0x0A,                   // $8066 ASL A
+    0x0A,                   // $8067 ASL A
+    0x09, 0x1F,             // $8068 ORA #$1F
+    0x8D, 0x01, 0x20,       // $806A STA $2001
+    0x4C, 0x5A, 0x80        // $806D JMP $805A
+};
+
+// Runs both cores in lock-step, every indexed frame must convert back to
+// the RGBA frame
+static bool CompareIndexedFrames(Gearnes::GearnesCore* rgba_core, Gearnes::GearnesCore* indexed_core, const char* name, int frames,
+        Gearnes::NES_Color* frame_buffer, Gearnes::NES_Color* converted, u8* indexed_frame_buffer)
+{
+    for (int f = 0; f < frames; f++)
+    {
+        rgba_core->RunToVBlank(frame_buffer);
+        indexed_core->RunToVBlankIndexed(indexed_frame_buffer);
+        indexed_core->GetPalette()->ConvertFrame(indexed_frame_buffer, converted, Gearnes::kPixelFormatRGBA8888);
+
+        if (memcmp(frame_buffer, converted, Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT * sizeof(Gearnes::NES_Color)) != 0)
+        {
+            printf("ERROR: %s indexed frame %d differs from the RGBA frame\n", name, f);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// .pal files of 64 and 512 colors must end up in the tables as they are,
+// and frames drawn with them must still match
+static bool CheckPaletteFiles(Gearnes::GearnesCore* rgba_core, Gearnes::GearnesCore* indexed_core,
+        Gearnes::NES_Color* frame_buffer, Gearnes::NES_Color* converted, u8* indexed_frame_buffer)
+{
+    bool ok = true;
+    u8 pal[Gearnes::NES_PAL_FILE_EMPHASIS_SIZE];
+    u32 seed = 0x2C02;
+
+    for (int i = 0; i < Gearnes::NES_PAL_FILE_EMPHASIS_SIZE; i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        pal[i] = static_cast<u8>(seed >> 16);
+    }
+
+    const int sizes[2] = { Gearnes::NES_PAL_FILE_SIZE, Gearnes::NES_PAL_FILE_EMPHASIS_SIZE };
+
+    for (int s = 0; s < 2; s++)
+    {
+        if (!rgba_core->GetPalette()->LoadFromBuffer(pal, sizes[s]) || !indexed_core->GetPalette()->LoadFromBuffer(pal, sizes[s]))
+        {
+            printf("ERROR: %d byte palette not loaded\n", sizes[s]);
+            ok = false;
+            continue;
+        }
+
+        const Gearnes::NES_Color* colors = indexed_core->GetPalette()->GetColors();
+
+        for (int i = 0; i < sizes[s] / 3; i++)
+        {
+            if ((colors[i].red != pal[i * 3]) || (colors[i].green != pal[(i * 3) + 1]) || (colors[i].blue != pal[(i * 3) + 2]))
+            {
+                printf("ERROR: %d byte palette, color %d is wrong\n", sizes[s], i);
+                ok = false;
+                break;
+            }
+        }
+
+        ok = ok && CompareIndexedFrames(rgba_core, indexed_core, "loaded palette", 8, frame_buffer, converted, indexed_frame_buffer);
+    }
+
+    if (indexed_core->GetPalette()->LoadFromBuffer(pal, 100))
+    {
+        printf("ERROR: palette of a wrong size loaded\n");
+        ok = false;
+    }
+
+    rgba_core->GetPalette()->LoadDefault();
+    indexed_core->GetPalette()->LoadDefault();
+
+    return ok;
+}
+
+static bool BenchmarkVideoIndexed()
+{
+    bool ok = true;
+
+    const stPPUProgram program = { "emphasis", kProgramPPUEmphasis, sizeof(kProgramPPUEmphasis), 0x1E };
+    u8* rom = new u8[16 + 0x4000 + 0x2000];
+    int size = BuildPPUROM(rom, program);
+
+    Gearnes::NES_Color* frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+    Gearnes::NES_Color* converted = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+    u8* indexed_frame_buffer = new u8[Gearnes::NES_INDEXED_FRAME_SIZE];
+
+    Gearnes::GearnesCore* rgba_core = new Gearnes::GearnesCore();
+    Gearnes::GearnesCore* indexed_core = new Gearnes::GearnesCore();
+    rgba_core->Init();
+    indexed_core->Init();
+
+    if (!rgba_core->LoadROMFromBuffer(rom, size) || !indexed_core->LoadROMFromBuffer(rom, size))
+    {
+        printf("ERROR: Unable to load %s\n", program.name);
+        ok = false;
+    }
+
+    Gearnes::Palette* palette = indexed_core->GetPalette();
+
+    ok = ok && CompareIndexedFrames(rgba_core, indexed_core, program.name, 64, frame_buffer, converted, indexed_frame_buffer);
+    ok = ok && CheckPaletteFiles(rgba_core, indexed_core, frame_buffer, converted, indexed_frame_buffer);
+
+    // Grayscale swaps tables in both paths, they must still agree
+    const stPPUProgram grayscale_program = { "grayscale", kProgramPPUGrayscale, sizeof(kProgramPPUGrayscale), 0x1F };
+    u8* grayscale_rom = new u8[16 + 0x4000 + 0x2000];
+    int grayscale_size = BuildPPUROM(grayscale_rom, grayscale_program);
+    Gearnes::GearnesCore* grayscale_rgba_core = new Gearnes::GearnesCore();
+    Gearnes::GearnesCore* grayscale_indexed_core = new Gearnes::GearnesCore();
+    grayscale_rgba_core->Init();
+    grayscale_indexed_core->Init();
+
+    if (ok && (!grayscale_rgba_core->LoadROMFromBuffer(grayscale_rom, grayscale_size) || !grayscale_indexed_core->LoadROMFromBuffer(grayscale_rom, grayscale_size)))
+    {
+        printf("ERROR: Unable to load %s\n", grayscale_program.name);
+        ok = false;
+    }
+
+    ok = ok && CompareIndexedFrames(grayscale_rgba_core, grayscale_indexed_core, grayscale_program.name, 64, frame_buffer, converted, indexed_frame_buffer);
+
+    SafeDelete(grayscale_indexed_core);
+    SafeDelete(grayscale_rgba_core);
+    SafeDeleteArray(grayscale_rom);
+
+    if (ok)
+    {
+        steady_clock::time_point start = steady_clock::now();
+
+        for (int f = 0; f < kIndexedBenchmarkFrames; f++)
+        {
+            rgba_core->RunToVBlank(frame_buffer);
+        }
+
+        steady_clock::time_point middle = steady_clock::now();
+
+        for (int f = 0; f < kIndexedBenchmarkFrames; f++)
+        {
+            indexed_core->RunToVBlankIndexed(indexed_frame_buffer);
+        }
+
+        steady_clock::time_point end = steady_clock::now();
+
+        printf("%-16s %10s %10s\n", "output", "ms/frame", "KB/frame");
+        printf("%-16s %10.4f %10.1f\n", "rgba frame", duration_cast<duration<double> >(middle - start).count() * 1000.0 / kIndexedBenchmarkFrames,
+                (Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT * sizeof(Gearnes::NES_Color)) / 1024.0);
+        printf("%-16s %10.4f %10.1f\n", "indexed frame", duration_cast<duration<double> >(end - middle).count() * 1000.0 / kIndexedBenchmarkFrames,
+                Gearnes::NES_INDEXED_FRAME_SIZE / 1024.0);
+
+        const Gearnes::NES_Pixel_Format formats[3] = { Gearnes::kPixelFormatRGBA8888, Gearnes::kPixelFormatBGRA8888, Gearnes::kPixelFormatRGB565 };
+        const char* format_names[3] = { "convert RGBA8888", "convert BGRA8888", "convert RGB565" };
+        const int format_bytes[3] = { 4, 4, 2 };
+
+        for (int i = 0; i < 3; i++)
+        {
+            start = steady_clock::now();
+
+            for (int r = 0; r < kConvertRepeat; r++)
+            {
+                palette->ConvertFrame(indexed_frame_buffer, converted, formats[i]);
+            }
+
+            end = steady_clock::now();
+
+            printf("%-16s %10.4f %10.1f\n", format_names[i], duration_cast<duration<double> >(end - start).count() * 1000.0 / kConvertRepeat,
+                    (Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT * format_bytes[i]) / 1024.0);
+        }
+    }
+
+    SafeDelete(indexed_core);
+    SafeDelete(rgba_core);
+    SafeDeleteArray(indexed_frame_buffer);
+    SafeDeleteArray(converted);
+    SafeDeleteArray(frame_buffer);
+    SafeDeleteArray(rom);
+
+    return ok;
+}
+
+#ifdef G6502_JIT_X64
+
+static const int kJITStepInstructions = 500000;
+static const int kJITLockStepFrames = 300;
+
+// OAM DMA in a hot loop, the stall must end the block early
+static const u8 kProgramJITDMA[] = {
+    0xA9, 0x02,             // $805A LDA #$02
+    0x8D, 0x14, 0x40,       // $805C STA $4014
+    0xE6, 0x00,             // $805F INC $00
+    0xA5, 0x00,             // $8061 LDA $00
+    0x8D, 0x05, 0x20,       // $8063 STA $2005
+    0x4C, 0x5A, 0x80        // $8066 JMP $805A
+};
+
+// Switches $8000-$BFFF between the two 16KB banks of a 32KB ROM on any
+// write there, $C000-$FFFF stays on the second
+class JITBankMapper : public Gearnes::NROMMapper
+{
+public:
+    JITBankMapper(Gearnes::Memory* memory, Gearnes::Video* video, Gearnes::Cartridge* cartridge) : Gearnes::NROMMapper(memory, video, cartridge) { }
+    virtual void PerformWrite(u16, u8 value) { memory_->MapPRGROM(0x8000, 0x4000, cartridge_->GetPRGROM(), (value & 0x01) * 0x4000); }
+};
+
+// Bank 0 stores to $8000 and keeps running at $8005, now in bank 1, which
+// switches back from the fixed bank. A block that ran on from the old
+// bank would count in the wrong place: $10 only counts in bank 0, $11
+// only in bank 1. Entry points don't share a block slot, so they get hot.
+static const u8 kProgramJITBank0[] = {
+    0xA9, 0x01,             // $8000 LDA #$01
+    0x8D, 0x00, 0x80,       // $8002 STA $8000
+    0xE6, 0x10,             // $8005 INC $10
+    0x4C, 0x10, 0xC0        // $8007 JMP $C010
+};
+
+static const u8 kProgramJITBank1[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00,
+    0xE6, 0x11,             // $8005 INC $11
+    0x4C, 0x10, 0xC0,       // $8007 JMP $C010
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xA9, 0x00,             // $C010 LDA #$00
+    0x8D, 0x00, 0x80,       // $C012 STA $8000
+    0x4C, 0x00, 0x80        // $C015 JMP $8000
+};
+
+// One NROM system per CPU, so both sides of a comparison own their bus
+struct stJITBus
+{
+    Gearnes::Cartridge* cartridge;
+    Gearnes::Scheduler* scheduler;
+    Gearnes::Video* video;
+    Gearnes::Memory* memory;
+    Gearnes::NROMMapper* mapper;
+    g6502::G6502<Gearnes::Memory>* cpu;
+};
+
+static void CreateJITBus(stJITBus* bus, const u8* rom, int size, bool jit, int max_block_instructions, bool bank_switching = false)
+{
+    bus->cartridge = new Gearnes::Cartridge();
+    bus->scheduler = new Gearnes::Scheduler();
+    bus->video = new Gearnes::Video();
+    bus->memory = new Gearnes::Memory(bus->video);
+
+    if (bank_switching)
+    {
+        bus->mapper = new JITBankMapper(bus->memory, bus->video, bus->cartridge);
+    }
+    else
+    {
+        bus->mapper = new Gearnes::NROMMapper(bus->memory, bus->video, bus->cartridge);
+    }
+
+    bus->cartridge->Init();
+    bus->cartridge->LoadFromBuffer(rom, size);
+    bus->video->Init(bus->cartridge, bus->scheduler, nullptr);
+    bus->memory->Init();
+    bus->memory->SetCurrentMapper(bus->mapper);
+    bus->mapper->Reset();
+
+    bus->cpu = new g6502::G6502<Gearnes::Memory>();
+    bus->cpu->Init(bus->memory);
+    bus->memory->SetProcessor(bus->cpu);
+    bus->cpu->EnableJIT(jit);
+    bus->cpu->SetJITMaxBlockInstructions(max_block_instructions);
+    bus->cpu->Reset();
+
+    bus->memory->Write(0x0040, 0x00);
+    bus->memory->Write(0x0041, 0x05);
+}
+
+static void DestroyJITBus(stJITBus* bus)
+{
+    SafeDelete(bus->cpu);
+    SafeDelete(bus->mapper);
+    SafeDelete(bus->memory);
+    SafeDelete(bus->video);
+    SafeDelete(bus->scheduler);
+    SafeDelete(bus->cartridge);
+}
+
+static u32 JITBusChecksum(stJITBus* bus)
+{
+    u32 checksum = 0;
+    for (int i = 0; i < 0x800; i++)
+        checksum = (checksum * 31) + bus->memory->Read(static_cast<u16>(i));
+    return checksum;
+}
+
+static bool SameState(const g6502::stProcessorState& a, const g6502::stProcessorState& b)
+{
+    return (a.PC == b.PC) && (a.A == b.A) && (a.X == b.X) && (a.Y == b.Y) && (a.S == b.S) && (a.P == b.P);
+}
+
+static void PrintState(const char* name, const g6502::stProcessorState& state)
+{
+    printf("  %-12s PC:%04X A:%02X X:%02X Y:%02X S:%02X P:%02X\n", name, state.PC, state.A, state.X, state.Y, state.S, state.P);
+}
+
+// Single instruction blocks stepped against the interpreter, registers and
+// cycles compared after every instruction
+static bool CheckJITInstructions(const u8* rom, int size, const char* name)
+{
+    bool ok = true;
+    stJITBus reference;
+    stJITBus jit;
+    CreateJITBus(&reference, rom, size, false, 1);
+    CreateJITBus(&jit, rom, size, true, 1);
+
+    for (int i = 0; ok && (i < kJITStepInstructions); i++)
+    {
+        unsigned int reference_cycles = reference.cpu->RunFor(1);
+        unsigned int jit_cycles = jit.cpu->RunFor(1);
+
+        g6502::stProcessorState reference_state;
+        g6502::stProcessorState jit_state;
+        reference.cpu->GetState(&reference_state);
+        jit.cpu->GetState(&jit_state);
+
+        if ((reference_cycles != jit_cycles) || !SameState(reference_state, jit_state))
+        {
+            printf("ERROR: %s instruction %d diverged, %u/%u cycles\n", name, i, reference_cycles, jit_cycles);
+            PrintState("interpreter", reference_state);
+            PrintState("jit", jit_state);
+            ok = false;
+        }
+    }
+
+    if (ok && (JITBusChecksum(&reference) != JITBusChecksum(&jit)))
+    {
+        printf("ERROR: %s RAM diverged in single instruction mode\n", name);
+        ok = false;
+    }
+
+    g6502::stJITStats stats;
+    jit.cpu->GetJITStats(&stats);
+
+    if (ok && (stats.jit_instructions == 0))
+    {
+        printf("ERROR: %s ran no compiled instructions\n", name);
+        ok = false;
+    }
+
+    DestroyJITBus(&jit);
+    DestroyJITBus(&reference);
+
+    return ok;
+}
+
+// Full blocks in frame sized RunFor() slices, like the core runs them
+static double RunJITSlices(stJITBus* bus, unsigned int* cycles)
+{
+    *cycles = 0;
+
+    steady_clock::time_point start = steady_clock::now();
+
+    while (*cycles < kCPUBenchmarkCycles)
+    {
+        *cycles += bus->cpu->RunFor(kFrameCycles);
+    }
+
+    return duration_cast<duration<double> >(steady_clock::now() - start).count();
+}
+
+// Bank switches from inside a block, which must go on in the new bank
+static bool CheckJITBankSwitch()
+{
+    bool ok = true;
+
+    const int size = 16 + 0x8000 + 0x2000;
+    u8* rom = new u8[size];
+    memset(rom, 0, size);
+    const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x02, 0x01, 0x00, 0x00 };
+    const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+    memcpy(rom, header, 8);
+    memcpy(rom + 16, kProgramJITBank0, sizeof(kProgramJITBank0));
+    memcpy(rom + 16 + 0x4000, kProgramJITBank1, sizeof(kProgramJITBank1));
+    memcpy(rom + 16 + 0x7FFA, vectors, 6);
+
+    stJITBus reference;
+    stJITBus jit;
+    CreateJITBus(&reference, rom, size, false, 32, true);
+    CreateJITBus(&jit, rom, size, true, 32, true);
+
+    for (int i = 0; ok && (i < 1000); i++)
+    {
+        unsigned int reference_cycles = reference.cpu->RunFor(1000);
+        unsigned int jit_cycles = jit.cpu->RunFor(1000);
+
+        g6502::stProcessorState reference_state;
+        g6502::stProcessorState jit_state;
+        reference.cpu->GetState(&reference_state);
+        jit.cpu->GetState(&jit_state);
+
+        if ((reference_cycles != jit_cycles) || !SameState(reference_state, jit_state) || (JITBusChecksum(&reference) != JITBusChecksum(&jit)))
+        {
+            printf("ERROR: bank switch diverged in slice %d, %u/%u cycles\n", i, reference_cycles, jit_cycles);
+            PrintState("interpreter", reference_state);
+            PrintState("jit", jit_state);
+            ok = false;
+        }
+    }
+
+    g6502::stJITStats stats;
+    jit.cpu->GetJITStats(&stats);
+
+    if (ok && (stats.jit_instructions == 0))
+    {
+        printf("ERROR: bank switch ran no compiled instructions\n");
+        ok = false;
+    }
+
+    DestroyJITBus(&jit);
+    DestroyJITBus(&reference);
+    SafeDeleteArray(rom);
+
+    return ok;
+}
+
+static bool BenchmarkCPUJIT()
+{
+    bool ok = CheckJITBankSwitch();
+
+    printf("%-10s %-12s %12s %10s %10s\n", "program", "engine", "ns/cycle", "compiled", "speedup");
+
+    for (int i = 0; i < kProgramCount; i++)
+    {
+        const int size = 16 + 0x4000 + 0x2000;
+        u8* rom = new u8[size];
+        memset(rom, 0, size);
+        const u8 header[8] = { 0x4E, 0x45, 0x53, 0x1A, 0x01, 0x01, 0x00, 0x00 };
+        const u8 vectors[6] = { 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 };
+        memcpy(rom, header, 8);
+        memcpy(rom + 16, kPrograms[i].code, kPrograms[i].size);
+        memcpy(rom + 16 + 0x3FFA, vectors, 6);
+
+        ok = CheckJITInstructions(rom, size, kPrograms[i].name) && ok;
+
+        stJITBus reference;
+        stJITBus jit;
+        CreateJITBus(&reference, rom, size, false, 32);
+        CreateJITBus(&jit, rom, size, true, 32);
+
+        unsigned int reference_cycles = 0;
+        unsigned int jit_cycles = 0;
+        double reference_seconds = RunJITSlices(&reference, &reference_cycles);
+        double jit_seconds = RunJITSlices(&jit, &jit_cycles);
+
+        g6502::stProcessorState reference_state;
+        g6502::stProcessorState jit_state;
+        reference.cpu->GetState(&reference_state);
+        jit.cpu->GetState(&jit_state);
+
+        g6502::stJITStats stats;
+        jit.cpu->GetJITStats(&stats);
+        u64 total = stats.jit_instructions + stats.interpreted_instructions;
+
+        printf("%-10s %-12s %12.3f %10s %10s\n", kPrograms[i].name, "interpreter",
+                reference_seconds * 1000000000.0 / reference_cycles, "-", "1.00x");
+        printf("%-10s %-12s %12.3f %9.2f%% %9.2fx\n", kPrograms[i].name, "jit",
+                jit_seconds * 1000000000.0 / jit_cycles, (total > 0) ? (stats.jit_instructions * 100.0 / total) : 0.0,
+                (reference_seconds / reference_cycles) / (jit_seconds / jit_cycles));
+
+        if ((reference_cycles != jit_cycles) || !SameState(reference_state, jit_state) || (JITBusChecksum(&reference) != JITBusChecksum(&jit)))
+        {
+            printf("ERROR: %s diverged with full blocks, %u/%u cycles\n", kPrograms[i].name, reference_cycles, jit_cycles);
+            PrintState("interpreter", reference_state);
+            PrintState("jit", jit_state);
+            ok = false;
+        }
+
+        DestroyJITBus(&jit);
+        DestroyJITBus(&reference);
+        SafeDeleteArray(rom);
+    }
+
+    // Whole system in lock-step: PPU register accesses, OAM DMA stalls and
+    // NMIs in the middle of compiled blocks
+    u8* rom = new u8[16 + 0x4000 + 0x2000];
+    Gearnes::NES_Color* reference_frame = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+    Gearnes::NES_Color* jit_frame = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+
+    const stPPUProgram dma_program = { "dma", kProgramJITDMA, sizeof(kProgramJITDMA), 0x1E };
+
+    for (int i = 0; i <= kPPUProgramCount; i++)
+    {
+        const stPPUProgram& program = (i < kPPUProgramCount) ? kPPUPrograms[i] : dma_program;
+        int size = BuildPPUROM(rom, program);
+
+        Gearnes::GearnesCore* reference_core = new Gearnes::GearnesCore();
+        Gearnes::GearnesCore* jit_core = new Gearnes::GearnesCore();
+        reference_core->Init();
+        jit_core->Init();
+        jit_core->EnableJIT(true);
+
+        if (!reference_core->LoadROMFromBuffer(rom, size) || !jit_core->LoadROMFromBuffer(rom, size))
+        {
+            printf("ERROR: Unable to load %s\n", program.name);
+            ok = false;
+        }
+
+        for (int f = 0; ok && (f < kJITLockStepFrames); f++)
+        {
+            reference_core->RunToVBlank(reference_frame);
+            jit_core->RunToVBlank(jit_frame);
+
+            if ((reference_core->GetClockCycles() != jit_core->GetClockCycles()) ||
+                    (FrameChecksum(reference_frame) != FrameChecksum(jit_frame)))
+            {
+                printf("ERROR: %s frame %d diverged with the JIT\n", program.name, f);
+                ok = false;
+            }
+        }
+
+        g6502::stJITStats stats;
+        jit_core->GetJITStats(&stats);
+        printf("%-10s %-12s %d frames in lock-step, %llu blocks, %llu early exits\n", program.name, "system",
+                kJITLockStepFrames, static_cast<unsigned long long>(stats.blocks_compiled),
+                static_cast<unsigned long long>(stats.early_exits));
+
+        if ((&program == &dma_program) && (stats.early_exits == 0))
+        {
+            printf("ERROR: %s never left a block early\n", program.name);
+            ok = false;
+        }
+
+        SafeDelete(jit_core);
+        SafeDelete(reference_core);
+    }
+
+    SafeDeleteArray(jit_frame);
+    SafeDeleteArray(reference_frame);
+    SafeDeleteArray(rom);
+
+    return ok;
+}
+
+#else
+
+static bool BenchmarkCPUJIT()
+{
+    printf("Built without G6502_JIT on x86-64, rebuild with make JIT=1\n");
+    return true;
+}
+
+#endif
+
+static const int kIdleLockStepFrames = 120;
+
+// Waits for VBlank polling the status register
+static const u8 kProgramIdleVBlank[] = {
+    0x2C, 0x02, 0x20,       // $805A BIT $2002
+    0x10, 0xFB,             // $805D BPL $805A
+    0xE6, 0x00,             // $805F INC $00
+    0x4C, 0x5A, 0x80        // $8061 JMP $805A
+};
+
+// Waits for sprite 0 hit to clear and then to be set again
+static const u8 kProgramIdleSprite0[] = {
+    0x2C, 0x02, 0x20,       // $805A BIT $2002
+    0x70, 0xFB,             // $805D BVS $805A
+    0x2C, 0x02, 0x20,       // $805F BIT $2002
+    0x50, 0xFB,             // $8062 BVC $805F
+    0xE6, 0x01,             // $8064 INC $01
+    0x4C, 0x5A, 0x80        // $8066 JMP $805A
+};
+
+// Waits on a RAM flag set by the NMI handler at $8070
+static const u8 kProgramIdleNMI[] = {
+    0xA9, 0x90,             // $805A LDA #$90
+    0x8D, 0x00, 0x20,       // $805C STA $2000
+    0xA5, 0x10,             // $805F LDA $10
+    0xF0, 0xFC,             // $8061 BEQ $805F
+    0xA9, 0x00,             // $8063 LDA #$00
+    0x85, 0x10,             // $8065 STA $10
+    0xE6, 0x11,             // $8067 INC $11
+    0x4C, 0x5F, 0x80,       // $8069 JMP $805F
+    0xEA, 0xEA, 0xEA, 0xEA, // $806C NOP
+    0xE6, 0x10,             // $8070 INC $10
+    0x40                    // $8072 RTI
+};
+
+static const stPPUProgram kIdlePrograms[] = {
+    { "jmp", kProgramPPUStatic, sizeof(kProgramPPUStatic), 0x1E },
+    { "vblank", kProgramIdleVBlank, sizeof(kProgramIdleVBlank), 0x1E },
+    { "sprite0", kProgramIdleSprite0, sizeof(kProgramIdleSprite0), 0x1E },
+    { "nmi", kProgramIdleNMI, sizeof(kProgramIdleNMI), 0x1E }
+};
+
+static const int kIdleProgramCount = sizeof(kIdlePrograms) / sizeof(kIdlePrograms[0]);
+
+static u32 RAMChecksum(Gearnes::GearnesCore* core)
+{
+    u32 checksum = 0;
+
+    for (int i = 0; i < 0x800; i++)
+    {
+        checksum = (checksum * 31) + core->GetMemory()->Read(i);
+    }
+
+    return checksum;
+}
+
+// Runs both cores a frame at a time for the given number of frames. They
+// must stay in lock-step: same frame lengths and RAM after every frame, and
+// the same pixels on the frames the core renders. renders(frame) says which
+// ones those are, the reference renders them all.
+template <class Renders>
+static bool RunLockStepFrames(const char* name, Gearnes::GearnesCore* reference, Gearnes::GearnesCore* core, int frames,
+        Renders renders, Gearnes::NES_Color* reference_frame_buffer, Gearnes::NES_Color* frame_buffer)
+{
+    for (int f = 0; f < frames; f++)
+    {
+        bool render = renders(f);
+
+        reference->RunToVBlank(reference_frame_buffer);
+        core->RunToVBlank(render ? frame_buffer : nullptr);
+
+        if ((reference->GetClockCycles() != core->GetClockCycles()) || (RAMChecksum(reference) != RAMChecksum(core)) ||
+                (render && (FrameChecksum(reference_frame_buffer) != FrameChecksum(frame_buffer))))
+        {
+            printf("ERROR: %s differs at frame %d, cycles %llu vs %llu\n", name, f,
+                    static_cast<unsigned long long>(reference->GetClockCycles()), static_cast<unsigned long long>(core->GetClockCycles()));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Milliseconds per frame over kPPUBenchmarkFrames, nullptr skips rendering
+static double RunTimedFrames(Gearnes::GearnesCore* core, Gearnes::NES_Color* frame_buffer)
+{
+    steady_clock::time_point start = steady_clock::now();
+
+    for (int f = 0; f < kPPUBenchmarkFrames; f++)
+    {
+        core->RunToVBlank(frame_buffer);
+    }
+
+    steady_clock::time_point end = steady_clock::now();
+
+    return duration_cast<duration<double> >(end - start).count() * 1000.0 / kPPUBenchmarkFrames;
+}
+
+static bool BenchmarkCPUIdle()
+{
+    bool ok = true;
+
+    u8* rom = new u8[16 + 0x4000 + 0x2000];
+    Gearnes::NES_Color* frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+    Gearnes::NES_Color* idle_frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+
+    printf("%-10s %12s %12s %10s %14s %10s\n", "program", "off ms", "on ms", "speedup", "idle cyc/frm", "idle %");
+
+    for (int i = 0; i < kIdleProgramCount; i++)
+    {
+        int size = BuildPPUROM(rom, kIdlePrograms[i]);
+
+        if (kIdlePrograms[i].loop == kProgramIdleNMI)
+        {
+            rom[16 + 0x3FFA] = 0x70;
+        }
+
+        Gearnes::GearnesCore* reference = new Gearnes::GearnesCore();
+        Gearnes::GearnesCore* core = new Gearnes::GearnesCore();
+        reference->Init();
+        core->Init();
+        reference->EnableIdleLoopDetection(false);
+
+        if (!reference->LoadROMFromBuffer(rom, size) || !core->LoadROMFromBuffer(rom, size))
+        {
+            printf("ERROR: Unable to load %s\n", kIdlePrograms[i].name);
+            SafeDelete(core);
+            SafeDelete(reference);
+            ok = false;
+            continue;
+        }
+
+        // Skipping must not change a thing, every frame is rendered
+        bool same = RunLockStepFrames(kIdlePrograms[i].name, reference, core, kIdleLockStepFrames,
+                [](int) { return true; }, frame_buffer, idle_frame_buffer);
+        ok = ok && same;
+
+        if (same)
+        {
+            g6502::stIdleLoopStats start_stats;
+            g6502::stIdleLoopStats end_stats;
+            u64 cycles = core->GetClockCycles();
+            double off_ms = RunTimedFrames(reference, frame_buffer);
+            core->GetIdleLoopStats(&start_stats);
+            double on_ms = RunTimedFrames(core, idle_frame_buffer);
+            core->GetIdleLoopStats(&end_stats);
+            u64 idle = end_stats.skipped_t_states - start_stats.skipped_t_states;
+            double frame_cycles = static_cast<double>(core->GetClockCycles() - cycles) / kPPUBenchmarkFrames;
+
+            printf("%-10s %12.4f %12.4f %9.2fx %14.0f %9.2f%%\n", kIdlePrograms[i].name, off_ms, on_ms, off_ms / on_ms,
+                    static_cast<double>(idle) / kPPUBenchmarkFrames, (idle * 100.0 / kPPUBenchmarkFrames) / frame_cycles);
+        }
+
+        SafeDelete(core);
+        SafeDelete(reference);
+    }
+
+    SafeDeleteArray(idle_frame_buffer);
+    SafeDeleteArray(frame_buffer);
+    SafeDeleteArray(rom);
+
+    return ok;
+}
+
+static const int kSkipLockStepFrames = 240;
+static const int kSkipRenderInterval = 4;
+
+// Piles all 64 sprites on the same lines for sprite overflow, then adds
+// up every status read: a flag set a cycle early or late changes the sum
+static const u8 kProgramSkipStatus[] = {
+    0xA9, 0x00,             // $805A LDA #$00
+    0x8D, 0x03, 0x20,       // $805C STA $2003
+    0xA2, 0x00,             // $805F LDX #$00
+    0xA9, 0x40,             // $8061 LDA #$40
+    0x8D, 0x04, 0x20,       // $8063 STA $2004
+    0xCA,                   // $8066 DEX
+    0xD0, 0xFA,             // $8067 BNE $8063
+    0xAD, 0x02, 0x20,       // $8069 LDA $2002
+    0x29, 0xE0,             // $806C AND #$E0
+    0x65, 0x00,             // $806E ADC $00
+    0x85, 0x00,             // $8070 STA $00
+    0x4C, 0x69, 0x80        // $8072 JMP $8069
+};
+
+static const stPPUProgram kSkipPrograms[] = {
+    { "static", kProgramPPUStatic, sizeof(kProgramPPUStatic), 0x1E },
+    { "segmented", kProgramPPUSegmented, sizeof(kProgramPPUSegmented), 0x1E },
+    { "raster", kProgramPPURaster, sizeof(kProgramPPURaster), 0x1E },
+    { "sprite0", kProgramIdleSprite0, sizeof(kProgramIdleSprite0), 0x1E },
+    { "status", kProgramSkipStatus, sizeof(kProgramSkipStatus), 0x1E }
+};
+
+static const int kSkipProgramCount = sizeof(kSkipPrograms) / sizeof(kSkipPrograms[0]);
+
+static bool BenchmarkVideoSkip()
+{
+    bool ok = true;
+
+    u8* rom = new u8[16 + 0x4000 + 0x2000];
+    Gearnes::NES_Color* frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+    Gearnes::NES_Color* skip_frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+
+    printf("%-10s %12s %12s %10s\n", "program", "render ms", "skip ms", "speedup");
+
+    for (int i = 0; i < kSkipProgramCount; i++)
+    {
+        int size = BuildPPUROM(rom, kSkipPrograms[i]);
+
+        Gearnes::GearnesCore* reference = new Gearnes::GearnesCore();
+        Gearnes::GearnesCore* core = new Gearnes::GearnesCore();
+        reference->Init();
+        core->Init();
+
+        if (!reference->LoadROMFromBuffer(rom, size) || !core->LoadROMFromBuffer(rom, size))
+        {
+            printf("ERROR: Unable to load %s\n", kSkipPrograms[i].name);
+            SafeDelete(core);
+            SafeDelete(reference);
+            ok = false;
+            continue;
+        }
+
+        // Skipped frames must leave the CPU where rendered ones do, and
+        // the frames rendered in between must come out the same
+        bool same = RunLockStepFrames(kSkipPrograms[i].name, reference, core, kSkipLockStepFrames,
+                [](int f) { return (f % kSkipRenderInterval) == 0; }, frame_buffer, skip_frame_buffer);
+        ok = ok && same;
+
+        if (same && (kSkipPrograms[i].loop == kProgramIdleSprite0) && (core->GetMemory()->Read(0x01) == 0))
+        {
+            printf("ERROR: %s never saw a sprite 0 hit\n", kSkipPrograms[i].name);
+            ok = false;
+        }
+
+        if (same)
+        {
+            double render_ms = RunTimedFrames(reference, frame_buffer);
+            double skip_ms = RunTimedFrames(core, nullptr);
+
+            printf("%-10s %12.4f %12.4f %9.2fx\n", kSkipPrograms[i].name, render_ms, skip_ms, render_ms / skip_ms);
+        }
+
+        SafeDelete(core);
+        SafeDelete(reference);
+    }
+
+    SafeDeleteArray(skip_frame_buffer);
+    SafeDeleteArray(frame_buffer);
+    SafeDeleteArray(rom);
+
+    return ok;
+}
+
+static const int kThreadedLockStepFrames = 240;
+static const int kThreadedSkipInterval = 8;
+
+// Everything the render thread has to replay at the right time: OAM DMA,
+// sprites changed between DMAs, scroll writes, and $2007/$2002 reads
+// moving the VRAM address and the write toggle mid-frame
+static const u8 kProgramThreadedMixed[] = {
+    0xA9, 0x02,             // $805A LDA #$02
+    0x8D, 0x14, 0x40,       // $805C STA $4014
+    0xE6, 0x00,             // $805F INC $00
+    0xA5, 0x00,             // $8061 LDA $00
+    0x8D, 0x05, 0x20,       // $8063 STA $2005
+    0x8D, 0x05, 0x20,       // $8066 STA $2005
+    0x8D, 0x05, 0x02,       // $8069 STA $0205
+    0xAD, 0x07, 0x20,       // $806C LDA $2007
+    0xAD, 0x02, 0x20,       // $806F LDA $2002
+    0x4C, 0x5A, 0x80        // $8072 JMP $805A
+};
+
+static const stPPUProgram kThreadedPrograms[] = {
+    { "static", kProgramPPUStatic, sizeof(kProgramPPUStatic), 0x1E },
+    { "segmented", kProgramPPUSegmented, sizeof(kProgramPPUSegmented), 0x1E },
+    { "raster", kProgramPPURaster, sizeof(kProgramPPURaster), 0x1E },
+    { "sprite0", kProgramIdleSprite0, sizeof(kProgramIdleSprite0), 0x1E },
+    { "status", kProgramSkipStatus, sizeof(kProgramSkipStatus), 0x1E },
+    { "mixed", kProgramThreadedMixed, sizeof(kProgramThreadedMixed), 0x1E }
+};
+
+static const int kThreadedProgramCount = sizeof(kThreadedPrograms) / sizeof(kThreadedPrograms[0]);
+
+static bool BenchmarkVideoThreaded()
+{
+    bool ok = true;
+
+    u8* rom = new u8[16 + 0x4000 + 0x2000];
+    Gearnes::NES_Color* frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+    Gearnes::NES_Color* threaded_frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+
+    printf("%-10s %12s %12s %10s\n", "program", "single ms", "threaded ms", "speedup");
+
+    for (int i = 0; i < kThreadedProgramCount; i++)
+    {
+        int size = BuildPPUROM(rom, kThreadedPrograms[i]);
+
+        Gearnes::GearnesCore* reference = new Gearnes::GearnesCore();
+        Gearnes::GearnesCore* core = new Gearnes::GearnesCore();
+        reference->Init();
+        core->Init();
+        core->EnableThreadedRendering(true);
+
+        if (!reference->LoadROMFromBuffer(rom, size) || !core->LoadROMFromBuffer(rom, size) || !core->IsThreadedRendering())
+        {
+            printf("ERROR: Unable to load %s\n", kThreadedPrograms[i].name);
+            SafeDelete(core);
+            SafeDelete(reference);
+            ok = false;
+            continue;
+        }
+
+        // Every frame must match the one rendered on the CPU thread, with
+        // skipped frames in between
+        bool same = RunLockStepFrames(kThreadedPrograms[i].name, reference, core, kThreadedLockStepFrames,
+                [](int f) { return (f % kThreadedSkipInterval) != (kThreadedSkipInterval - 1); }, frame_buffer, threaded_frame_buffer);
+        ok = ok && same;
+
+        if (same)
+        {
+            double single_ms = RunTimedFrames(reference, frame_buffer);
+            double threaded_ms = RunTimedFrames(core, threaded_frame_buffer);
+
+            printf("%-10s %12.4f %12.4f %9.2fx\n", kThreadedPrograms[i].name, single_ms, threaded_ms, single_ms / threaded_ms);
+        }
+
+        SafeDelete(core);
+        SafeDelete(reference);
+    }
+
+    SafeDeleteArray(threaded_frame_buffer);
+    SafeDeleteArray(frame_buffer);
+    SafeDeleteArray(rom);
+
+    return ok;
+}
+
+static const int kNTSCCheckFrames = 4;
+static const int kNTSCBenchmarkFrames = 200;
+static const int kNTSCCheckThreads = 3;
+
+static void FillNTSCFrame(u32* seed, u8* indexed_frame)
+{
+    for (int i = 0; i < Gearnes::NES_INDEXED_FRAME_SIZE; i++)
+    {
+        *seed = (*seed * 1103515245) + 12345;
+        indexed_frame[i] = static_cast<u8>(*seed >> 16) & ((i < (Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT)) ? 0x3F : 0x07);
+    }
+}
+
+// Flat frames of one color must decode to it: no chroma left on gray
+static bool CheckNTSCFlat(Gearnes::NTSCFilter* filter, u8* indexed_frame, Gearnes::NES_Color* output, u8 index, int min, int max)
+{
+    memset(indexed_frame, index, Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT);
+    memset(indexed_frame + (Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT), 0, Gearnes::NES_HEIGHT);
+    filter->Filter(indexed_frame, output);
+
+    // Away from the black borders
+    for (int y = 0; y < Gearnes::NES_HEIGHT; y++)
+    {
+        for (int x = 8; x < Gearnes::NES_NTSC_WIDTH - 8; x++)
+        {
+            const Gearnes::NES_Color& color = output[(y * Gearnes::NES_NTSC_WIDTH) + x];
+
+            if ((color.red < min) || (color.red > max) || (color.green < min) || (color.green > max) || (color.blue < min) || (color.blue > max))
+            {
+                printf("ERROR: flat color %02X decodes to %d,%d,%d at %d,%d\n", index, color.red, color.green, color.blue, x, y);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static double RunNTSCFrames(Gearnes::NTSCFilter* filter, const u8* indexed_frames, Gearnes::NES_Color* output)
+{
+    steady_clock::time_point start = steady_clock::now();
+
+    for (int f = 0; f < kNTSCBenchmarkFrames; f++)
+    {
+        filter->Filter(indexed_frames + ((f % kNTSCCheckFrames) * Gearnes::NES_INDEXED_FRAME_SIZE), output);
+    }
+
+    steady_clock::time_point end = steady_clock::now();
+
+    return duration_cast<duration<double> >(end - start).count() * 1000.0 / kNTSCBenchmarkFrames;
+}
+
+// Emulates and filters each frame, waiting for the filter or, pipelined,
+// filtering one frame while the next is emulated
+static double RunNTSCEmulation(Gearnes::GearnesCore* core, Gearnes::NTSCFilter* filter, u8* indexed_frame, Gearnes::NES_Color* output, bool pipelined)
+{
+    steady_clock::time_point start = steady_clock::now();
+
+    for (int f = 0; f < kNTSCBenchmarkFrames; f++)
+    {
+        core->RunToVBlankIndexed(indexed_frame);
+
+        if (pipelined)
+        {
+            filter->Submit(indexed_frame, output);
+        }
+        else
+        {
+            filter->Filter(indexed_frame, output);
+        }
+    }
+
+    filter->Wait();
+
+    steady_clock::time_point end = steady_clock::now();
+
+    return duration_cast<duration<double> >(end - start).count() * 1000.0 / kNTSCBenchmarkFrames;
+}
+
+static bool BenchmarkVideoNTSC()
+{
+    bool ok = true;
+
+    u8* indexed_frames = new u8[kNTSCCheckFrames * Gearnes::NES_INDEXED_FRAME_SIZE];
+    Gearnes::NES_Color* reference = new Gearnes::NES_Color[kNTSCCheckFrames * Gearnes::NES_NTSC_WIDTH * Gearnes::NES_HEIGHT];
+    Gearnes::NES_Color* output = new Gearnes::NES_Color[Gearnes::NES_NTSC_WIDTH * Gearnes::NES_HEIGHT];
+    const int frame_pixels = Gearnes::NES_NTSC_WIDTH * Gearnes::NES_HEIGHT;
+
+    u32 seed = 0xBEEF;
+
+    for (int f = 0; f < kNTSCCheckFrames; f++)
+    {
+        FillNTSCFrame(&seed, indexed_frames + (f * Gearnes::NES_INDEXED_FRAME_SIZE));
+    }
+
+    // Scalar on the calling thread is the reference
+    Gearnes::NTSCFilter* scalar = new Gearnes::NTSCFilter();
+    scalar->Init(0);
+    scalar->SetPath(Gearnes::kNTSCFilterScalar);
+
+    for (int f = 0; f < kNTSCCheckFrames; f++)
+    {
+        scalar->Filter(indexed_frames + (f * Gearnes::NES_INDEXED_FRAME_SIZE), reference + (f * frame_pixels));
+    }
+
+    ok = CheckNTSCFlat(scalar, indexed_frames, output, 0x30, 0xF0, 0xFF) && ok;
+    ok = CheckNTSCFlat(scalar, indexed_frames, output, 0x0F, 0x00, 0x00) && ok;
+    ok = CheckNTSCFlat(scalar, indexed_frames, output, 0x00, 0x60, 0x6C) && ok;
+
+    // Refill, the flat checks wrote over the first frame
+    seed = 0xBEEF;
+    FillNTSCFrame(&seed, indexed_frames);
+
+    printf("%-8s %8s %12s %10s\n", "path", "threads", "ms/frame", "speedup");
+
+    double scalar_ms = 0.0;
+
+    for (int p = 0; p < Gearnes::kNTSCFilterPathCount; p++)
+    {
+        Gearnes::NTSC_Filter_Path path = static_cast<Gearnes::NTSC_Filter_Path>(p);
+
+        if (!Gearnes::NTSCFilter::IsPathAvailable(path))
+        {
+            printf("%-8s %8s %12s\n", Gearnes::NTSCFilter::GetPathName(path), "", "unsupported");
+            continue;
+        }
+
+        for (int pool = 0; pool < 2; pool++)
+        {
+            Gearnes::NTSCFilter* filter = new Gearnes::NTSCFilter();
+            filter->Init(pool ? kNTSCCheckThreads : 0);
+            filter->SetPath(path);
+
+            // Same frames in the same order, so the same subcarrier phases
+            bool same = true;
+
+            for (int f = 0; same && (f < kNTSCCheckFrames); f++)
+            {
+                filter->Filter(indexed_frames + (f * Gearnes::NES_INDEXED_FRAME_SIZE), output);
+
+                if (memcmp(output, reference + (f * frame_pixels), frame_pixels * sizeof(Gearnes::NES_Color)) != 0)
+                {
+                    printf("ERROR: %s with %d threads differs from scalar at frame %d\n", Gearnes::NTSCFilter::GetPathName(path), filter->GetThreadCount(), f);
+                    same = false;
+                    ok = false;
+                }
+            }
+
+            if (same)
+            {
+                double ms = RunNTSCFrames(filter, indexed_frames, output);
+
+                if ((p == Gearnes::kNTSCFilterScalar) && (pool == 0))
+                {
+                    scalar_ms = ms;
+                }
+
+                printf("%-8s %8d %12.4f %9.2fx\n", Gearnes::NTSCFilter::GetPathName(path), filter->GetThreadCount(), ms, scalar_ms / ms);
+            }
+
+            SafeDelete(filter);
+        }
+    }
+
+    SafeDelete(scalar);
+
+    // Filtering overlapped with emulating the next frame
+    if (ok)
+    {
+        const stPPUProgram program = { "emphasis", kProgramPPUEmphasis, sizeof(kProgramPPUEmphasis), 0x1E };
+        u8* rom = new u8[16 + 0x4000 + 0x2000];
+        int size = BuildPPUROM(rom, program);
+
+        Gearnes::GearnesCore* core = new Gearnes::GearnesCore();
+        core->Init();
+
+        if (!core->LoadROMFromBuffer(rom, size))
+        {
+            printf("ERROR: Unable to load %s\n", program.name);
+            ok = false;
+        }
+        else
+        {
+            Gearnes::NTSCFilter* filter = new Gearnes::NTSCFilter();
+            filter->Init(-1);
+
+            double emulation_ms = RunNTSCEmulation(core, filter, indexed_frames, output, false);
+            double pipelined_ms = RunNTSCEmulation(core, filter, indexed_frames, output, true);
+
+            printf("%-16s %8s %12s %10s\n", "emulate+filter", "threads", "ms/frame", "speedup");
+            printf("%-16s %8d %12.4f\n", "synchronous", filter->GetThreadCount(), emulation_ms);
+            printf("%-16s %8d %12.4f %9.2fx\n", "pipelined", filter->GetThreadCount(), pipelined_ms, emulation_ms / pipelined_ms);
+
+            SafeDelete(filter);
+        }
+
+        SafeDelete(core);
+        SafeDeleteArray(rom);
+    }
+
+    SafeDeleteArray(output);
+    SafeDeleteArray(reference);
+    SafeDeleteArray(indexed_frames);
+
+    return ok;
+}
+
+static const stBenchmark kBenchmarks[] = {
+    { "cpu-dispatch", "Tick() table dispatch vs RunFor() batch dispatch", BenchmarkCPUDispatch },
+    { "cpu-flags", "Status flag evaluation on flag heavy loops, checked against eager flags", BenchmarkCPUFlags },
+    { "cpu-bus", "Virtual MemoryInterface bus vs inlined Gearnes::Memory bus through RunFor()", BenchmarkCPUBus },
+    { "cpu-ram", "Zero page, stack and opcode fetch pointers on vs off on the Gearnes bus", BenchmarkCPURAM },
+    { "cpu-fusion", "Fused instruction pairs on vs off on the Gearnes bus", BenchmarkCPUFusion },
+    { "cpu-profiler", "Guest profiler totals checked against the run, and its cost", BenchmarkCPUProfiler },
+    { "cpu-icache", "Decoded instruction cache on vs off on the Gearnes bus", BenchmarkCPUInstructionCache },
+    { "cpu-jit", "x86-64 JIT checked against the interpreter, and its speedup", BenchmarkCPUJIT },
+    { "cpu-idle", "Idle loop skipping checked against running every loop, and its speedup", BenchmarkCPUIdle },
+    { "video-render", "Scanline renderer frame time, whole-line vs segmented lines", BenchmarkVideoRender },
+    { "video-compose", "Pixel compositor paths, checked bit-exact against scalar", BenchmarkVideoCompose },
+    { "video-indexed", "Indexed frame output and palette conversion", BenchmarkVideoIndexed },
+    { "video-skip", "Render-skip frames checked against rendered ones, and their speedup", BenchmarkVideoSkip },
+    { "video-threaded", "Frames rendered on a second thread checked against one thread, and their speedup", BenchmarkVideoThreaded },
+    { "video-ntsc", "NTSC filter paths and worker pool checked against scalar, and the pipelined stage", BenchmarkVideoNTSC }
+};
+
+static const int kBenchmarkCount = sizeof(kBenchmarks) / sizeof(kBenchmarks[0]);
+
+bool RunBenchmark(const char* name)
+{
+    bool all = (strcmp(name, "all") == 0);
+    bool found = false;
+    bool ok = true;
+
+    for (int i = 0; i < kBenchmarkCount; i++)
+    {
+        if (all || (strcmp(name, kBenchmarks[i].name) == 0))
+        {
+            found = true;
+            printf("== %s: %s\n", kBenchmarks[i].name, kBenchmarks[i].description);
+            ok = kBenchmarks[i].function() && ok;
+            printf("\n");
+        }
+    }
+
+    if (!found)
+    {
+        printf("ERROR: Unknown benchmark %s\n", name);
+        PrintBenchmarks();
+        return false;
+    }
+
+    return ok;
+}
+
+void PrintBenchmarks()
+{
+    printf("Benchmarks:\n");
+    printf("  %-16s %s\n", "all", "Run every benchmark");
+
+    for (int i = 0; i < kBenchmarkCount; i++)
+    {
+        printf("  %-16s %s\n", kBenchmarks[i].name, kBenchmarks[i].description);
+    }
+}
@@ -0,0 +1,300 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include "../../src/gearnes.h"
+#include "../../src/palette.h"
+#include "../../src/trace_file.h"
+#include "benchmark.h"
+
+static const double kNTSCFrameRate = 60.0988;
+
+static void PrintUsage(const char* program)
+{
+    printf("Usage: %s [options] <rom>\n", program);
+    printf("Options:\n");
+    printf("  -f <frames>   Number of frames to emulate (default 3600)\n");
+    printf("  -i            Emit indexed frames instead of RGBA\n");
+    printf("  -k <n>        Render one frame in n, the rest only keep the PPU timing\n");
+    printf("  -r            Render on a second thread\n");
+    printf("  -c            Enable the instruction cache (make ICACHE=1)\n");
+    printf("  -j            Enable the JIT (make JIT=1)\n");
+    printf("  -n            Don't skip idle loops\n");
+    printf("  -u            Don't fuse instruction pairs\n");
+    printf("  -t <file>     Write a CPU trace to file, render it with gearnes-trace\n");
+    printf("  -p <file>     Profile the guest code, write collapsed stacks to file (make PROFILE=1)\n");
+    printf("  -b <name>     Run a benchmark instead of a ROM\n");
+    printf("  -h            Show this help\n");
+    printf("\n");
+    PrintBenchmarks();
+}
+
+int main(int argc, char* argv[])
+{
+    setbuf(stdout, nullptr);
+
+    const char* rom_path = nullptr;
+    int frames = 3600;
+    int render_interval = 1;
+    bool indexed = false;
+    bool threaded_rendering = false;
+    bool instruction_cache = false;
+    bool jit = false;
+    bool idle_loops = true;
+    bool fusion = true;
+    const char* profile_path = nullptr;
+    const char* trace_path = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc))
+        {
+            frames = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-k") == 0) && (i + 1 < argc))
+        {
+            render_interval = atoi(argv[++i]);
+            render_interval = (render_interval < 1) ? 1 : render_interval;
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            threaded_rendering = true;
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            instruction_cache = true;
+        }
+        else if (strcmp(argv[i], "-j") == 0)
+        {
+            jit = true;
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+        {
+            idle_loops = false;
+        }
+        else if (strcmp(argv[i], "-u") == 0)
+        {
+            fusion = false;
+        }
+        else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+        {
+            trace_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+        {
+            profile_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-i") == 0)
+        {
+            indexed = true;
+        }
+        else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc))
+        {
+            return RunBenchmark(argv[++i]) ? 0 : 1;
+        }
+        else if (strcmp(argv[i], "-h") == 0)
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            rom_path = argv[i];
+        }
+    }
+
+    if (!IsValidPointer(rom_path) || (frames <= 0))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Gearnes::GearnesCore* core = new Gearnes::GearnesCore();
+    core->Init();
+    core->EnableInstructionCache(instruction_cache);
+    core->EnableIdleLoopDetection(idle_loops);
+    core->EnableInstructionFusion(fusion);
+    core->EnableThreadedRendering(threaded_rendering);
+
+    if (jit && !core->EnableJIT(true))
+    {
+        printf("ERROR: JIT not available in this build\n");
+        SafeDelete(core);
+        return 1;
+    }
+
+    if (IsValidPointer(profile_path) && !core->EnableProfiler(true))
+    {
+        printf("ERROR: Profiler not available in this build\n");
+        SafeDelete(core);
+        return 1;
+    }
+
+    if (!core->LoadROM(rom_path))
+    {
+        printf("ERROR: Unable to load ROM %s\n", rom_path);
+        SafeDelete(core);
+        return 1;
+    }
+
+    if (IsValidPointer(trace_path) && !core->StartTrace(trace_path))
+    {
+        printf("ERROR: Unable to write trace %s\n", trace_path);
+        SafeDelete(core);
+        return 1;
+    }
+
+    Gearnes::NES_Color* frame_buffer = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
+    u8* indexed_frame_buffer = new u8[Gearnes::NES_INDEXED_FRAME_SIZE];
+
+    using namespace std::chrono;
+
+    unsigned int max_idle_cycles = 0;
+
+    steady_clock::time_point start = steady_clock::now();
+
+    int rendered_frames = 0;
+
+    for (int i = 0; i < frames; i++)
+    {
+        // Counted from the end, the last frame is always rendered
+        bool render = ((frames - 1 - i) % render_interval) == 0;
+        rendered_frames += render ? 1 : 0;
+
+        if (indexed)
+        {
+            core->RunToVBlankIndexed(render ? indexed_frame_buffer : nullptr);
+        }
+        else
+        {
+            core->RunToVBlank(render ? frame_buffer : nullptr);
+        }
+
+        if (core->GetFrameIdleCycles() > max_idle_cycles)
+        {
+            max_idle_cycles = core->GetFrameIdleCycles();
+        }
+    }
+
+    // The rest of the trace is still being compressed
+    core->StopTrace();
+
+    steady_clock::time_point end = steady_clock::now();
+
+#if GEARNES_LOG_LEVEL > GEARNES_LOG_NONE
+    // Keep the log out of the results
+    Gearnes::Logger::Flush();
+#endif
+
+    double seconds = duration_cast<duration<double> >(end - start).count();
+    u64 cycles = core->GetClockCycles();
+
+    printf("ROM:           %s\n", core->GetCartridge()->GetFileName());
+    printf("Frames:        %d%s, %d rendered\n", frames, indexed ? " (indexed)" : "", rendered_frames);
+    printf("Wall time:     %.3f s\n", seconds);
+    printf("Frames/sec:    %.2f (%.2fx real time)\n", frames / seconds, (frames / seconds) / kNTSCFrameRate);
+    printf("Cycles:        %llu\n", static_cast<unsigned long long>(cycles));
+    printf("Cycles/sec:    %.0f\n", cycles / seconds);
+
+    if (instruction_cache)
+    {
+        g6502::stInstructionCacheStats stats;
+        core->GetInstructionCacheStats(&stats);
+        u64 total = stats.hits + stats.misses + stats.uncached;
+        printf("I-cache:       %llu hits, %llu misses, %llu uncached (%.2f%% hit rate)\n",
+                static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                static_cast<unsigned long long>(stats.uncached), (total > 0) ? (stats.hits * 100.0 / total) : 0.0);
+    }
+
+    if (jit)
+    {
+        g6502::stJITStats stats;
+        core->GetJITStats(&stats);
+        u64 total = stats.jit_instructions + stats.interpreted_instructions;
+        printf("JIT:           %llu blocks, %llu runs, %llu early exits, %llu flushes (%.2f%% instructions compiled)\n",
+                static_cast<unsigned long long>(stats.blocks_compiled), static_cast<unsigned long long>(stats.block_runs),
+                static_cast<unsigned long long>(stats.early_exits), static_cast<unsigned long long>(stats.flushes),
+                (total > 0) ? (stats.jit_instructions * 100.0 / total) : 0.0);
+    }
+
+    if (idle_loops)
+    {
+        g6502::stIdleLoopStats stats;
+        core->GetIdleLoopStats(&stats);
+        printf("Idle loops:    %llu skips, %llu cycles skipped (%.2f%% of cycles, %.0f per frame, max %u)\n",
+                static_cast<unsigned long long>(stats.skips), static_cast<unsigned long long>(stats.skipped_t_states),
+                (cycles > 0) ? (stats.skipped_t_states * 100.0 / cycles) : 0.0,
+                static_cast<double>(stats.skipped_t_states) / frames, max_idle_cycles);
+    }
+
+    if (fusion)
+    {
+        g6502::stFusionStats stats;
+        core->GetFusionStats(&stats);
+        printf("Fused pairs:  ");
+        for (int i = 0; i < g6502::kFusedPairCount; i++)
+        {
+            printf(" %s %llu%s", g6502::kFusedPairNames[i], static_cast<unsigned long long>(stats.pairs[i]),
+                    (i + 1 < g6502::kFusedPairCount) ? "," : "\n");
+        }
+    }
+
+    if (IsValidPointer(trace_path))
+    {
+        Gearnes::TraceFileWriter* trace = core->GetTrace();
+        printf("Trace:         %llu instructions, %llu bytes (%.2f bytes per instruction), %llu waits for the writer\n",
+                static_cast<unsigned long long>(trace->GetRecords()), static_cast<unsigned long long>(trace->GetCompressedBytes()),
+                (trace->GetRecords() > 0) ? (static_cast<double>(trace->GetCompressedBytes()) / trace->GetRecords()) : 0.0,
+                static_cast<unsigned long long>(trace->GetFullWaits()));
+    }
+
+#ifdef G6502_PROFILER
+    if (IsValidPointer(profile_path))
+    {
+        g6502::Profiler* profiler = core->GetProfiler();
+
+        printf("\nHot spots:\n");
+        profiler->PrintHotSpots(stdout, 20);
+        printf("\nCall graph:\n");
+        profiler->PrintCallGraph(stdout, 20);
+
+        FILE* file = fopen(profile_path, "w");
+
+        if (IsValidPointer(file))
+        {
+            profiler->PrintCollapsedStacks(file);
+            fclose(file);
+            printf("\nCollapsed stacks written to %s\n", profile_path);
+        }
+        else
+        {
+            printf("ERROR: Unable to write %s\n", profile_path);
+        }
+    }
+#endif
+
+    SafeDeleteArray(indexed_frame_buffer);
+    SafeDeleteArray(frame_buffer);
+    SafeDelete(core);
+
+    return 0;
+}
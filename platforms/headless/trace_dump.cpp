@@ -0,0 +1,137 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+// gearnes-trace: renders a CPU trace written by gearnes-headless -t as
+// nestest.log style text
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../../src/common.h"
+#include "../../src/trace_file.h"
+#include "../../src/G6502/g6502_opcode_names.h"
+#include "../../src/G6502/g6502_opcode_table.h"
+
+DISABLE_WARNING(misleading-indentation,misleading-indentation,0)
+#include "../../src/miniz/miniz.c"
+ENABLE_WARNING(misleading-indentation,misleading-indentation,0)
+
+static void PrintUsage(const char* program)
+{
+    printf("Usage: %s [options] <trace file>\n", program);
+    printf("Options:\n");
+    printf("  -s <count>    Skip the first count instructions\n");
+    printf("  -n <count>    Print at most count instructions\n");
+    printf("  -h            Show this help\n");
+}
+
+// C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD CYC:7
+static void PrintRecord(const g6502::stTraceRecord& record)
+{
+    bool valid = (record.flags & g6502::kTraceOperandsValid) != 0;
+    int size = g6502::kOPCodeInfo[record.opcode].size;
+    char bytes[16];
+    char instruction[32];
+    int length = snprintf(bytes, sizeof(bytes), "%02X", record.opcode);
+
+    for (int i = 1; i < size; i++)
+    {
+        if (valid)
+            length += snprintf(bytes + length, sizeof(bytes) - length, " %02X", record.operand[i - 1]);
+        else
+            length += snprintf(bytes + length, sizeof(bytes) - length, " ??");
+    }
+
+    g6502::FormatOPCode(instruction, sizeof(instruction), record.pc, record.opcode, valid ? record.operand : nullptr);
+
+    printf("%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu\n", record.pc, bytes, instruction,
+            record.a, record.x, record.y, record.p, record.s, static_cast<unsigned long long>(record.cycles));
+}
+
+int main(int argc, char* argv[])
+{
+    const char* trace_path = nullptr;
+    u64 skip = 0;
+    u64 count = 0;
+    bool limited = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+        {
+            skip = strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+        {
+            count = strtoull(argv[++i], nullptr, 10);
+            limited = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0)
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            trace_path = argv[i];
+        }
+    }
+
+    if (!IsValidPointer(trace_path))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Gearnes::TraceFileReader reader;
+
+    if (!reader.Open(trace_path))
+    {
+        fprintf(stderr, "ERROR: Unable to read trace %s\n", trace_path);
+        return 1;
+    }
+
+    g6502::stTraceRecord* records = new g6502::stTraceRecord[Gearnes::kTraceBlockRecords];
+    u64 index = 0;
+    int read = 0;
+
+    while ((!limited || (count > 0)) && ((read = reader.ReadBlock(records)) > 0))
+    {
+        for (int i = 0; (i < read) && (!limited || (count > 0)); i++, index++)
+        {
+            if (index < skip)
+                continue;
+
+            PrintRecord(records[i]);
+
+            if (limited)
+                count--;
+        }
+    }
+
+    SafeDeleteArray(records);
+
+    if (read < 0)
+    {
+        fprintf(stderr, "ERROR: Trace %s is corrupt after %llu instructions\n", trace_path, static_cast<unsigned long long>(index));
+        return 1;
+    }
+
+    return 0;
+}
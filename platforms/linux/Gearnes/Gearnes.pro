@@ -14,10 +14,20 @@ LIBS += -L/usr/local/lib -lSDL2 -lGLEW -lGLU -lGL
 
 QMAKE_CXXFLAGS += -std=c++11
 
+# Release builds leave out the debugger hooks, which keep RunFor() on the
+# Tick() path instead of the fast dispatch (and the instruction cache and
+# JIT when those are built in)
+CONFIG(release, debug|release) {
+    DEFINES += G6502_DISABLE_DEBUG GEARNES_DISABLE_DEBUG
+    # Errors and warnings only, debug messages sit in hot paths
+    DEFINES += GEARNES_LOG_LEVEL=GEARNES_LOG_WARNING
+}
+
 SOURCES += \
     ../../../src/mappers/nrom.cpp \
     ../../qt-shared/about.cpp \
     ../../qt-shared/emulator.cpp \
+    ../../qt-shared/frame_skip.cpp \
     ../../qt-shared/gl_frame.cpp \
     ../../qt-shared/input_settings.cpp \
     ../../qt-shared/main_window.cpp \
@@ -27,14 +37,23 @@ SOURCES += \
     ../../qt-shared/video_settings.cpp \
     ../../../src/audio.cpp \
     ../../../src/cartridge.cpp \
+    ../../../src/chr_cache.cpp \
+    ../../../src/compositor.cpp \
     ../../../src/input.cpp \
+    ../../../src/log.cpp \
     ../../../src/video.cpp \
+    ../../../src/video_pipeline.cpp \
+    ../../../src/ntsc_filter.cpp \
     ../../../src/miniz/miniz.c \
     ../../../src/gearnes_core.cpp \
     ../../../src/G6502/g6502_core.cpp \
-    ../../../src/G6502/g6502_opcodes.cpp \
+    ../../../src/G6502/g6502_jit_x64.cpp \
+    ../../../src/G6502/g6502_profiler.cpp \
     ../../../src/mapper.cpp \
-    ../../../src/memory.cpp
+    ../../../src/memory.cpp \
+    ../../../src/palette.cpp \
+    ../../../src/scheduler.cpp \
+    ../../../src/trace_file.cpp
 
 HEADERS  += \
     ../../../src/G6502/g6502_types.h \
@@ -44,6 +63,7 @@ HEADERS  += \
     ../../../src/mappers/nrom.h \
     ../../qt-shared/about.h \
     ../../qt-shared/emulator.h \
+    ../../qt-shared/frame_skip.h \
     ../../qt-shared/gl_frame.h \
     ../../qt-shared/input_settings.h \
     ../../qt-shared/main_window.h \
@@ -52,19 +72,35 @@ HEADERS  += \
     ../../qt-shared/video_settings.h \
     ../../../src/audio.h \
     ../../../src/cartridge.h \
+    ../../../src/chr_cache.h \
+    ../../../src/compositor.h \
     ../../../src/input.h \
     ../../../src/video.h \
+    ../../../src/video_pipeline.h \
+    ../../../src/ntsc_filter.h \
     ../../../src/gearnes.h \
     ../../../src/gearnes_core.h \
     ../../../src/G6502/g6502_core.h \
+    ../../../src/G6502/g6502_core_inl.h \
     ../../../src/G6502/g6502_definitions.h \
     ../../../src/G6502/g6502_eight_bit_register.h \
+    ../../../src/G6502/g6502_jit_inl.h \
+    ../../../src/G6502/g6502_idle_loop_inl.h \
+    ../../../src/G6502/g6502_profiler_inl.h \
+    ../../../src/G6502/g6502_trace_inl.h \
+    ../../../src/G6502/g6502_jit_x64.h \
+    ../../../src/G6502/g6502_profiler.h \
+    ../../../src/G6502/g6502_trace.h \
     ../../../src/G6502/g6502_memory_interface.h \
     ../../../src/G6502/g6502_sixteen_bit_register.h \
     ../../../src/G6502/g6502_opcode_names.h \
-    ../../../src/G6502/g6502_opcode_timing.h \
+    ../../../src/G6502/g6502_opcode_table.h \
+    ../../../src/G6502/g6502_opcodes_inl.h \
     ../../../src/mapper.h \
-    ../../../src/memory.h
+    ../../../src/memory.h \
+    ../../../src/palette.h \
+    ../../../src/scheduler.h \
+    ../../../src/trace_file.h
 
 FORMS += \
     ../../qt-shared/About.ui \
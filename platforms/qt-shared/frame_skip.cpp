@@ -0,0 +1,88 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "frame_skip.h"
+
+static const double kNTSCFramePeriod = 1.0 / 60.0988;
+
+// 59.94 Hz displays are 0.27% slower than the NES, and vsync paces
+// rendered frames to them, give or take the swap jitter
+static const double kDisplayTolerance = 0.01;
+
+FrameSkip::FrameSkip()
+{
+    Reset();
+}
+
+// Restarts the real time reference, call it after a pause or a ROM load
+void FrameSkip::Reset()
+{
+    last_frame_ = Clock::now();
+    lag_ = 0.0;
+    skipped_in_row_ = 0;
+    skipped_frames_ = 0;
+    render_ = true;
+}
+
+// Whether the next frame has to be rendered
+bool FrameSkip::ShouldRender()
+{
+    return render_;
+}
+
+// Call it when a frame is done, presented or not
+void FrameSkip::FrameDone()
+{
+    Clock::time_point now = Clock::now();
+    double frames = std::chrono::duration<double>(now - last_frame_).count() / kNTSCFramePeriod;
+    last_frame_ = now;
+
+    if (!render_)
+    {
+        skipped_in_row_++;
+        skipped_frames_++;
+    }
+    else
+    {
+        skipped_in_row_ = 0;
+
+        // A late vsync is not lag up to the tolerance, and is made up
+        // for by the early one after it
+        if (frames > 1.0)
+        {
+            frames = (frames > (1.0 + kDisplayTolerance)) ? (frames - kDisplayTolerance) : 1.0;
+        }
+    }
+
+    // Skipped frames run faster than real time and pay the lag back
+    lag_ += frames - 1.0;
+
+    if ((lag_ < 0.0) || (lag_ > kMaxLagFrames))
+    {
+        lag_ = 0.0;
+    }
+
+    render_ = (lag_ < 1.0) || (skipped_in_row_ >= kMaxSkippedFrames);
+}
+
+// Frames run without rendering since Reset()
+int FrameSkip::GetSkippedFrames() const
+{
+    return skipped_frames_;
+}
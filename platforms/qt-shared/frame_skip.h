@@ -0,0 +1,56 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef FRAMESKIP_H_
+#define FRAMESKIP_H_
+
+#include <chrono>
+
+// Decides which frames get rendered to keep emulation at real time. While
+// the host keeps up every frame is rendered; once it falls a frame behind,
+// frames run without rendering (GearnesCore::RunToVBlank(nullptr)) until it
+// catches up, never more than kMaxSkippedFrames in a row. Rendered frames
+// are paced by vsync, so one that takes about a frame is on time even when
+// the display runs a little slower than the NES.
+class FrameSkip
+{
+public:
+    FrameSkip();
+    void Reset();
+    bool ShouldRender();
+    void FrameDone();
+    int GetSkippedFrames() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static const int kMaxSkippedFrames = 4;
+    // Further behind than this the debt is dropped, after a pause or a
+    // stall there is no point running headless to catch up
+    static const int kMaxLagFrames = 30;
+
+    Clock::time_point last_frame_;
+    // Frames behind real time
+    double lag_;
+    int skipped_in_row_;
+    int skipped_frames_;
+    bool render_;
+};
+
+#endif // FRAMESKIP_H_
@@ -55,6 +55,11 @@ void GLFrame::ResumeRenderThread()
     render_thread_.Resume();
 }
 
+void GLFrame::ResetFrameSkip()
+{
+    render_thread_.ResetFrameSkip();
+}
+
 bool GLFrame::IsRunningRenderThread()
 {
     return render_thread_.IsRunningEmulator();
@@ -40,6 +40,7 @@ public:
     void StopRenderThread();
     void PauseRenderThread();
     void ResumeRenderThread();
+    void ResetFrameSkip();
     bool IsRunningRenderThread();
     void SetBilinearFiletering(bool enabled);
 
@@ -139,15 +139,21 @@ void MainWindow::MenuLoadROM()
 void MainWindow::MenuPause()
 {
     if (emulator_->IsPaused())
+    {
         emulator_->Resume();
+        gl_frame_->ResetFrameSkip();
+    }
     else
+    {
         emulator_->Pause();
+    }
 }
 
 void MainWindow::MenuReset()
 {
     ui_->actionPause->setChecked(false);
     emulator_->Reset();
+    gl_frame_->ResetFrameSkip();
 }
 
 void MainWindow::MenuSelectStateSlot()
@@ -25,6 +25,7 @@
 RenderThread::RenderThread(GLFrame* gl_frame) : QThread(), gl_frame_(gl_frame)
 {
     paused_ = false;
+    frame_skip_reset_.store(false);
     do_actual_rendering_ = true;
     frame_buffer_ = new Gearnes::NES_Color[Gearnes::NES_WIDTH * Gearnes::NES_HEIGHT];
     width_ = 0;
@@ -58,9 +59,16 @@ void RenderThread::Pause()
 
 void RenderThread::Resume()
 {
+    ResetFrameSkip();
     paused_ = false;
 }
 
+// Time spent paused or loading is not lag to catch up on
+void RenderThread::ResetFrameSkip()
+{
+    frame_skip_reset_.store(true);
+}
+
 bool RenderThread::IsRunningEmulator()
 {
     return do_actual_rendering_;
@@ -81,16 +89,31 @@ void RenderThread::run()
     {
         if (!paused_)
         {
-            emulator_->RunToVBlank(frame_buffer_);
-
-            if (resize_event_)
+            if (frame_skip_reset_.exchange(false))
             {
-                resize_event_ = false;
+                frame_skip_.Reset();
             }
 
-            RenderFrame();
+            // Frames the host has no time for run without rendering
+            if (frame_skip_.ShouldRender())
+            {
+                emulator_->RunToVBlank(frame_buffer_);
+
+                if (resize_event_)
+                {
+                    resize_event_ = false;
+                }
+
+                RenderFrame();
+
+                gl_frame_->swapBuffers();
+            }
+            else
+            {
+                emulator_->RunToVBlank(nullptr);
+            }
 
-            gl_frame_->swapBuffers();
+            frame_skip_.FrameDone();
         }
     }
     
@@ -116,9 +139,9 @@ void RenderThread::Init()
     if (GLEW_OK != err)
     {
         /* Problem: glewInit failed, something is seriously wrong. */
-        Log("GLEW Error: %s\n", glewGetErrorString(err));
+        LogError(Gearnes::kLogVideo, "GLEW Error: %s", reinterpret_cast<const char*>(glewGetErrorString(err)));
     }
-    Log("Status: Using GLEW %s\n", glewGetString(GLEW_VERSION));
+    LogInfo(Gearnes::kLogVideo, "Status: Using GLEW %s", reinterpret_cast<const char*>(glewGetString(GLEW_VERSION)));
 #endif
 
     glGenTextures(1, &texture_);
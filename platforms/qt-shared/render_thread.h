@@ -26,8 +26,10 @@
 #else
 #include <GL/glew.h>
 #endif
+#include <atomic>
 #include <QThread>
 #include "../../src/gearnes.h"
+#include "frame_skip.h"
 
 class Emulator;
 class GLFrame;
@@ -45,6 +47,7 @@ public:
     void Stop();
     void Pause();
     void Resume();
+    void ResetFrameSkip();
     void SetEmulator(Emulator* emulator);
     bool IsRunningEmulator();
     void SetBilinearFiletering(bool enabled);
@@ -63,6 +66,9 @@ private:
     GLFrame* gl_frame_;
     Emulator* emulator_;
     Gearnes::NES_Color* frame_buffer_;
+    FrameSkip frame_skip_;
+    // Set from the GUI thread, the render thread resets frame_skip_
+    std::atomic<bool> frame_skip_reset_;
     bool filtering_;
     bool resize_event_;
     GLuint texture_;
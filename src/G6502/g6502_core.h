@@ -25,44 +25,246 @@
 #include "g6502_sixteen_bit_register.h"
 #include "g6502_memory_interface.h"
 #include "g6502_opcode_names.h"
+#include "g6502_opcode_table.h"
+#include "g6502_jit_x64.h"
+#include "g6502_profiler.h"
+#include "g6502_trace.h"
 
 namespace g6502
 {
-   
+
+struct stInstructionCacheStats
+{
+    u64 hits;
+    u64 misses;
+    // Instructions outside cacheable banks (RAM) or crossing a page
+    u64 uncached;
+};
+
+struct stIdleLoopStats
+{
+    u64 skips;
+    // Already included in the T-states returned by RunFor()
+    u64 skipped_t_states;
+};
+
+struct stFusionStats
+{
+    // Times each G6502_FUSED_PAIR_TABLE pair ran in one dispatch
+    u64 pairs[kFusedPairCount];
+};
+
+// Registers as seen between instructions
+struct stProcessorState
+{
+    u16 PC;
+    u8 A;
+    u8 X;
+    u8 Y;
+    u8 S;
+    u8 P;
+};
+
+// MemoryImpl is the bus type. When it is a concrete final class (like
+// Gearnes::Memory) its Read/Write are inlined into the opcode bodies. Use
+// G6502<MemoryInterface> when the bus must be chosen at runtime.
+template <class MemoryImpl>
 class G6502
 {
 public:
     G6502();
     ~G6502();
-    void Init(MemoryInterface* memory_impl);
+    void Init(MemoryImpl* memory_impl);
     void Reset();
     unsigned int RunFor(unsigned int t_states);
+    unsigned int GetElapsedTStates() const;
+    void StopRunFor();
+    void AddTStates(unsigned int t_states);
     unsigned int Tick();
     void AssertIRQ(bool asserted);
     void RequestNMI();
+    void EnableInstructionCache(bool enabled);
+    void InvalidateInstructionCache();
+    void GetInstructionCacheStats(stInstructionCacheStats* stats) const;
+    void ResetInstructionCacheStats();
+    bool EnableJIT(bool enabled);
+    void SetJITMaxBlockInstructions(int instructions);
+    void GetJITStats(stJITStats* stats) const;
+    void ResetJITStats();
+    void EnableIdleLoopDetection(bool enabled);
+    void GetIdleLoopStats(stIdleLoopStats* stats) const;
+    void ResetIdleLoopStats();
+    void EnableDirectMemory(bool enabled);
+    void EnableInstructionFusion(bool enabled);
+    void GetFusionStats(stFusionStats* stats) const;
+    void ResetFusionStats();
+    void InvalidateFetchPage();
+    bool EnableProfiler(bool enabled);
+    Profiler* GetProfiler() const;
+    void SetTraceBuffer(TraceBuffer* buffer, u64 cycles);
+    void GetState(stProcessorState* state) const;
 
 private:
     typedef void (G6502::*OPCptr) (void);
-    OPCptr opcodes_[256];
+
+    // One instruction decoded from a code bank, keyed by (bank, address).
+    // The opcode selects the handler in the dispatch switch.
+    struct stDecodedInstruction
+    {
+        int bank;
+        u16 address;
+        u8 opcode;
+        u8 operand[2];
+        u8 t_states;
+        u8 page_cross_t_states;
+    };
+
+    static const int kInstructionCacheSize = 0x2000;
+
+    enum JIT_Block_State
+    {
+        kJITBlockCounting,
+        kJITBlockCompiled,
+        kJITBlockFailed
+    };
+
+    // Block entry point in a code bank, keyed by (bank, address)
+    struct stJITBlock
+    {
+        JITBlockFunction function;
+        int bank;
+        u16 address;
+        // T-states of every instruction but the last; the block only runs
+        // when the interpreter would have run all of it
+        u16 prefix_t_states;
+        u16 visits;
+        u8 state;
+    };
+
+    static const int kJITBlockCount = 0x1000;
+    static const int kJITHotThreshold = 8;
+    static const int kJITMaxBlockInstructions = 32;
+    static const int kJITCodeBufferSize = 4 * 1024 * 1024;
+    static const int kJITMaxBlockBytes = 8 * 1024;
+
+    static const unsigned int kNoFetchPage = 0x100;
+
+    static const int kIdleLoopMaxBytes = 16;
+    static const int kIdleLoopMaxReads = 4;
+
+    // Loop closed by the last backward branch or JMP taken, and the
+    // registers at that point. Going round it again with the same
+    // registers, while nothing it reads can change, means it will keep
+    // doing so: the rounds up to the next event can be skipped.
+    struct stIdleLoop
+    {
+        bool valid;
+        bool analyzed;
+        bool safe;
+        u16 start;
+        u16 end;
+        // A, X, Y, S and P packed
+        u64 registers;
+        unsigned int t_states;
+        // run_t_states_ until which the reads stay unchanged
+        unsigned int stable_t_states;
+        // Reads with a limit from GetIdleReadLimit(), like PPU status
+        int read_count;
+        u16 reads[kIdleLoopMaxReads];
+    };
+
+    // Instruction<>() instantiations indexed by opcode, for Tick()
+    static const OPCptr kOPCodeHandlers[256];
+
+private:
     SixteenBitRegister PC_;
     EightBitRegister A_;
     EightBitRegister X_;
     EightBitRegister Y_;
     EightBitRegister S_;
     EightBitRegister P_;
-    MemoryInterface* memory_impl_;
+#ifndef G6502_EAGER_FLAGS
+    // N, Z and C are kept out of P_ and only folded into it by GetP():
+    // the last results that set N and Z, and the carry as 0 or 1
+    u8 negative_result_;
+    u8 zero_result_;
+    u8 carry_;
+#endif
+    MemoryImpl* memory_impl_;
     unsigned int t_states_;
+    unsigned int run_t_states_;
+    unsigned int run_target_;
     bool interrupt_asserted_;
     bool nmi_interrupt_requested_;
     bool page_crossed_;
     bool branch_taken_;
+    stDecodedInstruction* instruction_cache_;
+    stInstructionCacheStats instruction_cache_stats_;
+    // Operand bytes of the cached instruction in progress, Fetch8() and
+    // Fetch16() read them instead of the bus. PC already points past them.
+    const u8* cached_operand_;
+    stJITBlock* jit_blocks_;
+    stJITContext jit_context_;
+    stJITStats jit_stats_;
+    unsigned int jit_run_start_;
+    unsigned int jit_extra_t_states_;
+    unsigned int jit_run_target_;
+    // The bus remapped code pages while a block ran
+    bool jit_map_changed_;
+    int jit_max_block_instructions_;
+    u8 jit_nz_flags_[256];
+#ifdef G6502_JIT_X64
+    JITCodeBuffer* jit_code_;
+#endif
+    bool idle_loop_detection_;
+    stIdleLoop idle_loop_;
+    stIdleLoopStats idle_loop_stats_;
+    bool direct_memory_;
+    // $0000-$01FF when the bus says it is plain RAM, nullptr otherwise
+    u8* ram_;
+    // Page the opcodes are being fetched from, fetch_page_number_ is
+    // kNoFetchPage when there is none
+    const u8* fetch_page_;
+    unsigned int fetch_page_number_;
+    bool instruction_fusion_;
+    stFusionStats fusion_stats_;
+#ifdef G6502_PROFILER
+    Profiler* profiler_;
+#endif
+    TraceBuffer* trace_buffer_;
+    // CPU cycles at the start of the next instruction, for the trace
+    u64 trace_cycles_;
 
 private:
     u8 Fetch8();
     u16 Fetch16();
+    u8 FetchFromBus(u16 address);
+    template <int Opcode> void FuseNext();
+    template <int Opcode> bool FusePair(int pair);
     u16 Address16(u8 high, u8 low);
+    bool InterruptPending();
+    unsigned int ServeInterrupt();
+    unsigned int RunForCached();
+    void DecodeInstruction(stDecodedInstruction* entry, u16 address, int bank);
+    unsigned int RunForJIT();
+    void RunJITBlock(stJITBlock* block);
+    void IdleLoop(u16 start, u16 end);
+    void IdleLoopRound(u16 start, u16 end, u64 registers);
+    bool AnalyzeIdleLoop();
+    bool AddIdleLoopRead(u16 address);
+    unsigned int GetIdleLoopReadLimit();
+    void ProfileInstruction(u16 address, u8 opcode);
+    void TraceInstruction(u16 address, u8 opcode);
+    void FlushJIT();
+    void CompileJITBlock(stJITBlock* block);
+    void JITBeginAccess(u32 t_states);
+    void JITEndAccess(u32 t_states);
+    static u32 JITRead(G6502* processor, u32 address, u32 unused, u32 t_states);
+    static void JITWrite(G6502* processor, u32 address, u32 value, u32 t_states);
     bool PageCrossed(u16 old_address, u16 new_address);
 
+    u8 GetP() const;
+    void SetP(u8 value);
     void SetZeroFlagFromResult(u8 result);
     void SetOverflowFlagFromResult(u8 result);
     void SetNegativeFlagFromResult(u8 result);
@@ -77,6 +279,8 @@ private:
 
     u8 Read(u16 address);
     void Write(u16 address, u8 value);
+    u8 ReadRAM(u16 address);
+    void WriteRAM(u16 address, u8 value);
 
     u8 ImmediateAddressing();
     u16 ZeroPageAddressing();
@@ -88,238 +292,442 @@ private:
     u16 IndexedIndirectAddressing();
     u16 IndirectIndexedAddressing();
 
-    void UnofficialOPCode();
+    u16 Address(ModeZeroPage);
+    u16 Address(ModeZeroPageX);
+    u16 Address(ModeZeroPageY);
+    u16 Address(ModeAbsolute);
+    u16 Address(ModeAbsoluteX);
+    u16 Address(ModeAbsoluteY);
+    u16 Address(ModeIndirect);
+    u16 Address(ModeIndexedIndirect);
+    u16 Address(ModeIndirectIndexed);
+    template <class Mode> u8 Operand(Mode mode);
+    u8 Operand(ModeImmediate);
+    template <class Mode> u8 Load(Mode mode, u16 address);
+    u8 Load(ModeZeroPage, u16 address);
+    u8 Load(ModeZeroPageX, u16 address);
+    u8 Load(ModeZeroPageY, u16 address);
+    template <class Mode> void Store(Mode mode, u16 address, u8 value);
+    void Store(ModeZeroPage, u16 address, u8 value);
+    void Store(ModeZeroPageX, u16 address, u8 value);
+    void Store(ModeZeroPageY, u16 address, u8 value);
+
     void OPCodes_ADC(u8 value);
     void OPCodes_AND(u8 value);
     void OPCodes_ASL_Accumulator();
-    void OPCodes_ASL_Memory(u16 address);
+    template <class Mode> u8 OPCodes_ASL_Memory(Mode mode);
     void OPcodes_Branch(bool condition);
-    void OPCodes_BIT(u16 address);
+    void OPCodes_BIT(u8 value);
     void OPCodes_BRK();
     void OPCodes_ClearFlag(u8 flag);
     void OPCodes_SetFlag(u8 flag);
     void OPCodes_CMP(EightBitRegister* reg, u8 value);
-    void OPCodes_DEC_Mem(u16 address);
+    template <class Mode> u8 OPCodes_DEC_Mem(Mode mode);
     void OPCodes_DEC_Reg(EightBitRegister* reg);
     void OPCodes_EOR(u8 value);
-    void OPCodes_INC_Mem(u16 address);
+    template <class Mode> u8 OPCodes_INC_Mem(Mode mode);
     void OPCodes_INC_Reg(EightBitRegister* reg);
     void OPCodes_LD(EightBitRegister* reg, u8 value);
     void OPCodes_LSR_Accumulator();
-    void OPCodes_LSR_Memory(u16 address);
+    template <class Mode> u8 OPCodes_LSR_Memory(Mode mode);
     void OPCodes_ORA(u8 value);
     void OPCodes_ROL_Accumulator();
-    void OPCodes_ROL_Memory(u16 address);
+    template <class Mode> u8 OPCodes_ROL_Memory(Mode mode);
     void OPCodes_ROR_Accumulator();
-    void OPCodes_ROR_Memory(u16 address);
+    template <class Mode> u8 OPCodes_ROR_Memory(Mode mode);
     void OPCodes_SBC(u8 value);
-    void OPCodes_Store(EightBitRegister* reg, u16 address);
+    template <class Mode> void OPCodes_Store(EightBitRegister* reg, Mode mode);
+    void OPCodes_StoreHighAnd(u16 address, u8 index, u8 value);
     void OPCodes_Transfer(EightBitRegister* reg, EightBitRegister* target);
 
-    void InitOPCodeFunctors();
-
-    void OPCode0x00(); void OPCode0x01(); void OPCode0x02(); void OPCode0x03();
-    void OPCode0x04(); void OPCode0x05(); void OPCode0x06(); void OPCode0x07();
-    void OPCode0x08(); void OPCode0x09(); void OPCode0x0A(); void OPCode0x0B();
-    void OPCode0x0C(); void OPCode0x0D(); void OPCode0x0E(); void OPCode0x0F();
-    void OPCode0x10(); void OPCode0x11(); void OPCode0x12(); void OPCode0x13();
-    void OPCode0x14(); void OPCode0x15(); void OPCode0x16(); void OPCode0x17();
-    void OPCode0x18(); void OPCode0x19(); void OPCode0x1A(); void OPCode0x1B();
-    void OPCode0x1C(); void OPCode0x1D(); void OPCode0x1E(); void OPCode0x1F();
-    void OPCode0x20(); void OPCode0x21(); void OPCode0x22(); void OPCode0x23();
-    void OPCode0x24(); void OPCode0x25(); void OPCode0x26(); void OPCode0x27();
-    void OPCode0x28(); void OPCode0x29(); void OPCode0x2A(); void OPCode0x2B();
-    void OPCode0x2C(); void OPCode0x2D(); void OPCode0x2E(); void OPCode0x2F();
-    void OPCode0x30(); void OPCode0x31(); void OPCode0x32(); void OPCode0x33();
-    void OPCode0x34(); void OPCode0x35(); void OPCode0x36(); void OPCode0x37();
-    void OPCode0x38(); void OPCode0x39(); void OPCode0x3A(); void OPCode0x3B();
-    void OPCode0x3C(); void OPCode0x3D(); void OPCode0x3E(); void OPCode0x3F();
-    void OPCode0x40(); void OPCode0x41(); void OPCode0x42(); void OPCode0x43();
-    void OPCode0x44(); void OPCode0x45(); void OPCode0x46(); void OPCode0x47();
-    void OPCode0x48(); void OPCode0x49(); void OPCode0x4A(); void OPCode0x4B();
-    void OPCode0x4C(); void OPCode0x4D(); void OPCode0x4E(); void OPCode0x4F();
-    void OPCode0x50(); void OPCode0x51(); void OPCode0x52(); void OPCode0x53();
-    void OPCode0x54(); void OPCode0x55(); void OPCode0x56(); void OPCode0x57();
-    void OPCode0x58(); void OPCode0x59(); void OPCode0x5A(); void OPCode0x5B();
-    void OPCode0x5C(); void OPCode0x5D(); void OPCode0x5E(); void OPCode0x5F();
-    void OPCode0x60(); void OPCode0x61(); void OPCode0x62(); void OPCode0x63();
-    void OPCode0x64(); void OPCode0x65(); void OPCode0x66(); void OPCode0x67();
-    void OPCode0x68(); void OPCode0x69(); void OPCode0x6A(); void OPCode0x6B();
-    void OPCode0x6C(); void OPCode0x6D(); void OPCode0x6E(); void OPCode0x6F();
-    void OPCode0x70(); void OPCode0x71(); void OPCode0x72(); void OPCode0x73();
-    void OPCode0x74(); void OPCode0x75(); void OPCode0x76(); void OPCode0x77();
-    void OPCode0x78(); void OPCode0x79(); void OPCode0x7A(); void OPCode0x7B();
-    void OPCode0x7C(); void OPCode0x7D(); void OPCode0x7E(); void OPCode0x7F();
-    void OPCode0x80(); void OPCode0x81(); void OPCode0x82(); void OPCode0x83();
-    void OPCode0x84(); void OPCode0x85(); void OPCode0x86(); void OPCode0x87();
-    void OPCode0x88(); void OPCode0x89(); void OPCode0x8A(); void OPCode0x8B();
-    void OPCode0x8C(); void OPCode0x8D(); void OPCode0x8E(); void OPCode0x8F();
-    void OPCode0x90(); void OPCode0x91(); void OPCode0x92(); void OPCode0x93();
-    void OPCode0x94(); void OPCode0x95(); void OPCode0x96(); void OPCode0x97();
-    void OPCode0x98(); void OPCode0x99(); void OPCode0x9A(); void OPCode0x9B();
-    void OPCode0x9C(); void OPCode0x9D(); void OPCode0x9E(); void OPCode0x9F();
-    void OPCode0xA0(); void OPCode0xA1(); void OPCode0xA2(); void OPCode0xA3();
-    void OPCode0xA4(); void OPCode0xA5(); void OPCode0xA6(); void OPCode0xA7();
-    void OPCode0xA8(); void OPCode0xA9(); void OPCode0xAA(); void OPCode0xAB();
-    void OPCode0xAC(); void OPCode0xAD(); void OPCode0xAE(); void OPCode0xAF();
-    void OPCode0xB0(); void OPCode0xB1(); void OPCode0xB2(); void OPCode0xB3();
-    void OPCode0xB4(); void OPCode0xB5(); void OPCode0xB6(); void OPCode0xB7();
-    void OPCode0xB8(); void OPCode0xB9(); void OPCode0xBA(); void OPCode0xBB();
-    void OPCode0xBC(); void OPCode0xBD(); void OPCode0xBE(); void OPCode0xBF();
-    void OPCode0xC0(); void OPCode0xC1(); void OPCode0xC2(); void OPCode0xC3();
-    void OPCode0xC4(); void OPCode0xC5(); void OPCode0xC6(); void OPCode0xC7();
-    void OPCode0xC8(); void OPCode0xC9(); void OPCode0xCA(); void OPCode0xCB();
-    void OPCode0xCC(); void OPCode0xCD(); void OPCode0xCE(); void OPCode0xCF();
-    void OPCode0xD0(); void OPCode0xD1(); void OPCode0xD2(); void OPCode0xD3();
-    void OPCode0xD4(); void OPCode0xD5(); void OPCode0xD6(); void OPCode0xD7();
-    void OPCode0xD8(); void OPCode0xD9(); void OPCode0xDA(); void OPCode0xDB();
-    void OPCode0xDC(); void OPCode0xDD(); void OPCode0xDE(); void OPCode0xDF();
-    void OPCode0xE0(); void OPCode0xE1(); void OPCode0xE2(); void OPCode0xE3();
-    void OPCode0xE4(); void OPCode0xE5(); void OPCode0xE6(); void OPCode0xE7();
-    void OPCode0xE8(); void OPCode0xE9(); void OPCode0xEA(); void OPCode0xEB();
-    void OPCode0xEC(); void OPCode0xED(); void OPCode0xEE(); void OPCode0xEF();
-    void OPCode0xF0(); void OPCode0xF1(); void OPCode0xF2(); void OPCode0xF3();
-    void OPCode0xF4(); void OPCode0xF5(); void OPCode0xF6(); void OPCode0xF7();
-    void OPCode0xF8(); void OPCode0xF9(); void OPCode0xFA(); void OPCode0xFB();
-    void OPCode0xFC(); void OPCode0xFD(); void OPCode0xFE(); void OPCode0xFF();
+    // One instantiation per row of G6502_OPCODE_TABLE, bodies in
+    // g6502_opcodes_inl.h
+    template <class Operation, class Mode> void Instruction();
+
+    template <class Mode> void Execute(OpADC, Mode mode);
+    template <class Mode> void Execute(OpAND, Mode mode);
+    template <class Mode> void Execute(OpASL, Mode mode);
+    void Execute(OpASL, ModeAccumulator);
+    void Execute(OpBCC, ModeRelative);
+    void Execute(OpBCS, ModeRelative);
+    void Execute(OpBEQ, ModeRelative);
+    template <class Mode> void Execute(OpBIT, Mode mode);
+    void Execute(OpBMI, ModeRelative);
+    void Execute(OpBNE, ModeRelative);
+    void Execute(OpBPL, ModeRelative);
+    void Execute(OpBRK, ModeImplied);
+    void Execute(OpBVC, ModeRelative);
+    void Execute(OpBVS, ModeRelative);
+    void Execute(OpCLC, ModeImplied);
+    void Execute(OpCLD, ModeImplied);
+    void Execute(OpCLI, ModeImplied);
+    void Execute(OpCLV, ModeImplied);
+    template <class Mode> void Execute(OpCMP, Mode mode);
+    template <class Mode> void Execute(OpCPX, Mode mode);
+    template <class Mode> void Execute(OpCPY, Mode mode);
+    template <class Mode> void Execute(OpDEC, Mode mode);
+    void Execute(OpDEX, ModeImplied);
+    void Execute(OpDEY, ModeImplied);
+    template <class Mode> void Execute(OpEOR, Mode mode);
+    template <class Mode> void Execute(OpINC, Mode mode);
+    void Execute(OpINX, ModeImplied);
+    void Execute(OpINY, ModeImplied);
+    void Execute(OpJMP, ModeAbsolute);
+    template <class Mode> void Execute(OpJMP, Mode mode);
+    void Execute(OpJSR, ModeAbsolute);
+    template <class Mode> void Execute(OpLDA, Mode mode);
+    template <class Mode> void Execute(OpLDX, Mode mode);
+    template <class Mode> void Execute(OpLDY, Mode mode);
+    template <class Mode> void Execute(OpLSR, Mode mode);
+    void Execute(OpLSR, ModeAccumulator);
+    template <class Mode> void Execute(OpNOP, Mode mode);
+    void Execute(OpNOP, ModeImplied);
+    template <class Mode> void Execute(OpORA, Mode mode);
+    void Execute(OpPHA, ModeImplied);
+    void Execute(OpPHP, ModeImplied);
+    void Execute(OpPLA, ModeImplied);
+    void Execute(OpPLP, ModeImplied);
+    template <class Mode> void Execute(OpROL, Mode mode);
+    void Execute(OpROL, ModeAccumulator);
+    template <class Mode> void Execute(OpROR, Mode mode);
+    void Execute(OpROR, ModeAccumulator);
+    void Execute(OpRTI, ModeImplied);
+    void Execute(OpRTS, ModeImplied);
+    template <class Mode> void Execute(OpSBC, Mode mode);
+    void Execute(OpSEC, ModeImplied);
+    void Execute(OpSED, ModeImplied);
+    void Execute(OpSEI, ModeImplied);
+    template <class Mode> void Execute(OpSTA, Mode mode);
+    template <class Mode> void Execute(OpSTX, Mode mode);
+    template <class Mode> void Execute(OpSTY, Mode mode);
+    void Execute(OpTAX, ModeImplied);
+    void Execute(OpTAY, ModeImplied);
+    void Execute(OpTSX, ModeImplied);
+    void Execute(OpTXA, ModeImplied);
+    void Execute(OpTXS, ModeImplied);
+    void Execute(OpTYA, ModeImplied);
+
+    template <class Mode> void Execute(OpAHX, Mode mode);
+    void Execute(OpALR, ModeImmediate);
+    void Execute(OpANC, ModeImmediate);
+    void Execute(OpARR, ModeImmediate);
+    void Execute(OpAXS, ModeImmediate);
+    template <class Mode> void Execute(OpDCP, Mode mode);
+    template <class Mode> void Execute(OpISC, Mode mode);
+    void Execute(OpKIL, ModeImplied);
+    void Execute(OpLAS, ModeAbsoluteY);
+    template <class Mode> void Execute(OpLAX, Mode mode);
+    void Execute(OpLAX, ModeImmediate);
+    template <class Mode> void Execute(OpRLA, Mode mode);
+    template <class Mode> void Execute(OpRRA, Mode mode);
+    template <class Mode> void Execute(OpSAX, Mode mode);
+    void Execute(OpSHX, ModeAbsoluteY);
+    void Execute(OpSHY, ModeAbsoluteX);
+    template <class Mode> void Execute(OpSLO, Mode mode);
+    template <class Mode> void Execute(OpSRE, Mode mode);
+    void Execute(OpTAS, ModeAbsoluteY);
+    void Execute(OpXAA, ModeImmediate);
 };
 
 
-inline void G6502::AssertIRQ(bool asserted)
+// T-states executed so far by the RunFor() call in progress
+template <class MemoryImpl>
+inline unsigned int G6502<MemoryImpl>::GetElapsedTStates() const
+{
+    return run_t_states_;
+}
+
+// Drops the page pointer used for opcode fetches, for buses that remap
+// the page under it (bank switches). A compiled block running may come
+// from that page too, it stops after the access.
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::InvalidateFetchPage()
+{
+    fetch_page_number_ = kNoFetchPage;
+    jit_map_changed_ = true;
+}
+
+// Makes the RunFor() call in progress return after the current instruction
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::StopRunFor()
+{
+    run_target_ = 0;
+}
+
+// Charges extra T-states to the instruction in progress (DMA stalls)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::AddTStates(unsigned int t_states)
+{
+    t_states_ += t_states;
+    run_t_states_ += t_states;
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::AssertIRQ(bool asserted)
 {
     interrupt_asserted_ = asserted;
 }
 
-inline void G6502::RequestNMI()
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::RequestNMI()
 {
     nmi_interrupt_requested_ = true;
 }
 
-inline u8 G6502::Fetch8()
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::Fetch8()
 {
-    u8 value = Read(PC_.GetValue());
-    PC_.Increment();
-    return value;
+#ifdef G6502_INSTRUCTION_CACHE
+    if (cached_operand_ != nullptr)
+    {
+        return *cached_operand_++;
+    }
+#endif
+
+    u16 pc = PC_.GetValue();
+    PC_.SetValue(pc + 1);
+
+    if ((pc >> 8) == fetch_page_number_)
+    {
+        return fetch_page_[pc & 0xFF];
+    }
+
+    return FetchFromBus(pc);
 }
 
-inline u16 G6502::Fetch16()
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Fetch16()
 {
+#ifdef G6502_INSTRUCTION_CACHE
+    if (cached_operand_ != nullptr)
+    {
+        const u8* operand = cached_operand_;
+        cached_operand_ += 2;
+        return Address16(operand[1], operand[0]);
+    }
+#endif
+
     u16 pc = PC_.GetValue();
-    u8 l = Read(pc);
-    u8 h = Read(pc + 1);
     PC_.SetValue(pc + 2);
+
+    if (((pc >> 8) == fetch_page_number_) && ((pc & 0xFF) != 0xFF))
+    {
+        return Address16(fetch_page_[(pc & 0xFF) + 1], fetch_page_[pc & 0xFF]);
+    }
+
+    u8 l = FetchFromBus(pc);
+    u8 h = FetchFromBus(pc + 1);
     return Address16(h , l);
 }
 
-inline u16 G6502::Address16(u8 high, u8 low)
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address16(u8 high, u8 low)
 {
     return static_cast<u16>(high << 8 ) | low;
 }
 
-inline bool G6502::PageCrossed(u16 old_address, u16 new_address)
+template <class MemoryImpl>
+inline bool G6502<MemoryImpl>::InterruptPending()
+{
+    return nmi_interrupt_requested_ || (interrupt_asserted_ && !IsSetFlag(FLAG_IRQ));
+}
+
+template <class MemoryImpl>
+inline bool G6502<MemoryImpl>::PageCrossed(u16 old_address, u16 new_address)
 {
     return (old_address ^ new_address) > 0x00FF;
 }
 
-inline void G6502::SetZeroFlagFromResult(u8 result)
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::GetP() const
+{
+#ifdef G6502_EAGER_FLAGS
+    return P_.GetValue();
+#else
+    return (P_.GetValue() & 0x7C) | (negative_result_ & FLAG_NEGATIVE) | ((zero_result_ == 0) ? FLAG_ZERO : 0) | carry_;
+#endif
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::SetP(u8 value)
 {
+    P_.SetValue(value);
+#ifndef G6502_EAGER_FLAGS
+    negative_result_ = value;
+    zero_result_ = (value & FLAG_ZERO) ? 0 : 1;
+    carry_ = value & FLAG_CARRY;
+#endif
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::SetZeroFlagFromResult(u8 result)
+{
+#ifdef G6502_EAGER_FLAGS
     if (result == 0)
         SetFlag(FLAG_ZERO);
     else
         ClearFlag(FLAG_ZERO);
+#else
+    zero_result_ = result;
+#endif
 }
 
-inline void G6502::SetOverflowFlagFromResult(u8 result)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::SetOverflowFlagFromResult(u8 result)
 {
     P_.SetValue((P_.GetValue() & 0xBF) | (result & 0x40));
 }
 
-inline void G6502::SetNegativeFlagFromResult(u8 result)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::SetNegativeFlagFromResult(u8 result)
 {
+#ifdef G6502_EAGER_FLAGS
     P_.SetValue((P_.GetValue() & 0x7F) | (result & 0x80));
+#else
+    negative_result_ = result;
+#endif
 }
 
-inline void G6502::SetFlag(u8 flag)
+// flag is always a constant, so only one branch survives inlining
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::SetFlag(u8 flag)
 {
-    P_.SetValue(P_.GetValue() | flag);
+#ifndef G6502_EAGER_FLAGS
+    if (flag == FLAG_CARRY)
+        carry_ = 1;
+    else if (flag == FLAG_ZERO)
+        zero_result_ = 0;
+    else if (flag == FLAG_NEGATIVE)
+        negative_result_ = FLAG_NEGATIVE;
+    else
+#endif
+        P_.SetValue(P_.GetValue() | flag);
 }
 
-inline void G6502::ClearFlag(u8 flag)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::ClearFlag(u8 flag)
 {
-    P_.SetValue(P_.GetValue() & (~flag));
+#ifndef G6502_EAGER_FLAGS
+    if (flag == FLAG_CARRY)
+        carry_ = 0;
+    else if (flag == FLAG_ZERO)
+        zero_result_ = 1;
+    else if (flag == FLAG_NEGATIVE)
+        negative_result_ = 0;
+    else
+#endif
+        P_.SetValue(P_.GetValue() & (~flag));
 }
 
-inline bool G6502::IsSetFlag(u8 flag)
+template <class MemoryImpl>
+inline bool G6502<MemoryImpl>::IsSetFlag(u8 flag)
 {
+#ifndef G6502_EAGER_FLAGS
+    if (flag == FLAG_CARRY)
+        return carry_ != 0;
+    else if (flag == FLAG_ZERO)
+        return zero_result_ == 0;
+    else if (flag == FLAG_NEGATIVE)
+        return (negative_result_ & FLAG_NEGATIVE) != 0;
+#endif
     return (P_.GetValue() & flag) != 0;
 }
 
-inline void G6502::StackPush16(u16 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::StackPush16(u16 value)
 {
-    Write(0x0100 | S_.GetValue(), static_cast<u8>((value >> 8) & 0x00FF));
+    WriteRAM(0x0100 | S_.GetValue(), static_cast<u8>((value >> 8) & 0x00FF));
     S_.Decrement();
-    Write(0x0100 | S_.GetValue(), static_cast<u8>(value & 0x00FF));
+    WriteRAM(0x0100 | S_.GetValue(), static_cast<u8>(value & 0x00FF));
     S_.Decrement();
 }
 
-inline void G6502::StackPush8(u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::StackPush8(u8 value)
 {
-    Write(0x0100 | S_.GetValue(), value);
+    WriteRAM(0x0100 | S_.GetValue(), value);
     S_.Decrement();
 }
 
-inline u16 G6502::StackPop16()
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::StackPop16()
 {
     S_.Increment();
-    u8 l = Read(0x0100 | S_.GetValue());
+    u8 l = ReadRAM(0x0100 | S_.GetValue());
     S_.Increment();
-    u8 h = Read(0x0100 | S_.GetValue());
+    u8 h = ReadRAM(0x0100 | S_.GetValue());
     return Address16(h , l);
 }
 
-inline u8 G6502::StackPop8()
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::StackPop8()
 {
     S_.Increment();
-    u8 result = Read(0x0100 | S_.GetValue());
+    u8 result = ReadRAM(0x0100 | S_.GetValue());
     return result;
 }
 
-inline u8 G6502::Read(u16 address)
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::Read(u16 address)
 {
     return memory_impl_->Read(address);
 }
 
-inline void G6502::Write(u16 address, u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Write(u16 address, u8 value)
 {
     memory_impl_->Write(address, value);
 }
 
-inline u8 G6502::ImmediateAddressing()
+// Zero page and stack, address is in $0000-$01FF
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::ReadRAM(u16 address)
+{
+    return (ram_ != nullptr) ? ram_[address] : Read(address);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::WriteRAM(u16 address, u8 value)
+{
+    if (ram_ != nullptr)
+        ram_[address] = value;
+    else
+        Write(address, value);
+}
+
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::ImmediateAddressing()
 {
     return Fetch8();
 }
 
-inline u16 G6502::ZeroPageAddressing()
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::ZeroPageAddressing()
 {
     return 0x00FF & Fetch8();
 }
 
-inline u16 G6502::ZeroPageAddressing(EightBitRegister* reg)
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::ZeroPageAddressing(EightBitRegister* reg)
 {
     return 0x00FF & (Fetch8() + reg->GetValue());
 }
 
-inline s8 G6502::RelativeAddressing()
+template <class MemoryImpl>
+inline s8 G6502<MemoryImpl>::RelativeAddressing()
 {
     return static_cast<s8>(Fetch8());
 }
 
-inline u16 G6502::AbsoluteAddressing()
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::AbsoluteAddressing()
 {
     return Fetch16();
 }
 
-inline u16 G6502::AbsoluteAddressing(EightBitRegister* reg)
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::AbsoluteAddressing(EightBitRegister* reg)
 {
     u16 address = Fetch16();
     u16 result = address + reg->GetValue();
@@ -327,7 +735,8 @@ inline u16 G6502::AbsoluteAddressing(EightBitRegister* reg)
     return result;
 }
 
-inline u16 G6502::IndirectAddressing()
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::IndirectAddressing()
 {
     u16 address = Fetch16();
     u8 l = Read(address);
@@ -335,26 +744,146 @@ inline u16 G6502::IndirectAddressing()
     return Address16(h, l);
 }
 
-inline u16 G6502::IndexedIndirectAddressing()
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::IndexedIndirectAddressing()
 {
     u16 address = Fetch8() + X_.GetValue();
-    u8 l = Read(address & 0x00FF);
-    u8 h = Read((address + 1) & 0x00FF);
+    u8 l = ReadRAM(address & 0x00FF);
+    u8 h = ReadRAM((address + 1) & 0x00FF);
     return Address16(h, l);
 }
 
-inline u16 G6502::IndirectIndexedAddressing()
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::IndirectIndexedAddressing()
 {
     u16 address = Fetch8();
-    u8 l = Read(address);
-    u8 h = Read(address+1);
+    u8 l = ReadRAM(address);
+    u8 h = ReadRAM((address + 1) & 0x00FF);
     address = Address16(h, l);
     u16 result = address + Y_.GetValue();
     page_crossed_ = PageCrossed(address, result);
     return result;
 }
 
-inline void G6502::OPCodes_ADC(u8 value)
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeZeroPage)
+{
+    return ZeroPageAddressing();
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeZeroPageX)
+{
+    return ZeroPageAddressing(&X_);
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeZeroPageY)
+{
+    return ZeroPageAddressing(&Y_);
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeAbsolute)
+{
+    return AbsoluteAddressing();
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeAbsoluteX)
+{
+    return AbsoluteAddressing(&X_);
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeAbsoluteY)
+{
+    return AbsoluteAddressing(&Y_);
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeIndirect)
+{
+    return IndirectAddressing();
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeIndexedIndirect)
+{
+    return IndexedIndirectAddressing();
+}
+
+template <class MemoryImpl>
+inline u16 G6502<MemoryImpl>::Address(ModeIndirectIndexed)
+{
+    return IndirectIndexedAddressing();
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::Operand(Mode mode)
+{
+    return Load(mode, Address(mode));
+}
+
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::Operand(ModeImmediate)
+{
+    return ImmediateAddressing();
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::Load(Mode, u16 address)
+{
+    return Read(address);
+}
+
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::Load(ModeZeroPage, u16 address)
+{
+    return ReadRAM(address);
+}
+
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::Load(ModeZeroPageX, u16 address)
+{
+    return ReadRAM(address);
+}
+
+template <class MemoryImpl>
+inline u8 G6502<MemoryImpl>::Load(ModeZeroPageY, u16 address)
+{
+    return ReadRAM(address);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Store(Mode, u16 address, u8 value)
+{
+    Write(address, value);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Store(ModeZeroPage, u16 address, u8 value)
+{
+    WriteRAM(address, value);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Store(ModeZeroPageX, u16 address, u8 value)
+{
+    WriteRAM(address, value);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Store(ModeZeroPageY, u16 address, u8 value)
+{
+    WriteRAM(address, value);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_ADC(u8 value)
 {
     int result = A_.GetValue() + value + (IsSetFlag(FLAG_CARRY) ? 1 : 0);
     u8 final_result = static_cast<u8> (result & 0xFF);
@@ -371,7 +900,8 @@ inline void G6502::OPCodes_ADC(u8 value)
     A_.SetValue(final_result);
 }
 
-inline void G6502::OPCodes_AND(u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_AND(u8 value)
 {
     u8 result = A_.GetValue() & value;
     A_.SetValue(result);
@@ -379,7 +909,8 @@ inline void G6502::OPCodes_AND(u8 value)
     SetNegativeFlagFromResult(result);
 }
 
-inline void G6502::OPCodes_ASL_Accumulator()
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_ASL_Accumulator()
 {
     u8 value = A_.GetValue();
     u8 result = static_cast<u8>(value << 1);
@@ -392,20 +923,25 @@ inline void G6502::OPCodes_ASL_Accumulator()
         ClearFlag(FLAG_CARRY);
 }
 
-inline void G6502::OPCodes_ASL_Memory(u16 address)
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::OPCodes_ASL_Memory(Mode mode)
 {
-    u8 value = Read(address);
+    u16 address = Address(mode);
+    u8 value = Load(mode, address);
     u8 result = static_cast<u8>(value << 1);
-    Write(address, result);
+    Store(mode, address, result);
     SetZeroFlagFromResult(result);
     SetNegativeFlagFromResult(result);
     if ((value & 0x80) != 0)
         SetFlag(FLAG_CARRY);
     else
         ClearFlag(FLAG_CARRY);
+    return result;
 }
 
-inline void G6502::OPcodes_Branch(bool condition)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPcodes_Branch(bool condition)
 {
     if (condition)
     {
@@ -415,41 +951,59 @@ inline void G6502::OPcodes_Branch(bool condition)
         PC_.SetValue(result);
         branch_taken_ = true;
         page_crossed_ = PageCrossed(address, result);
+
+        if ((displacement < 0) && idle_loop_detection_)
+        {
+            IdleLoop(result, address);
+        }
     }
     else
-        PC_.Increment();
+    {
+        // The displacement is fetched and dropped, as on the real CPU
+        Fetch8();
+
+        // Falling out of the loop, coming back later is not a repeat
+        if (PC_.GetValue() == idle_loop_.end)
+        {
+            idle_loop_.valid = false;
+        }
+    }
 }
 
-inline void G6502::OPCodes_BIT(u16 address)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_BIT(u8 value)
 {
-    u8 value = Read(address);
     u8 result = A_.GetValue() & value;
     SetZeroFlagFromResult(result);
     SetOverflowFlagFromResult(value);
     SetNegativeFlagFromResult(value);
 }
 
-inline void G6502::OPCodes_BRK()
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_BRK()
 {
     StackPush16(PC_.GetValue());
     SetFlag(FLAG_BRK);
-    StackPush8(P_.GetValue());
+    StackPush8(GetP());
     SetFlag(FLAG_IRQ);
     PC_.SetLow(Read(0xFFFE));
     PC_.SetHigh(Read(0xFFFF));
 }
 
-inline void G6502::OPCodes_ClearFlag(u8 flag)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_ClearFlag(u8 flag)
 {
     ClearFlag(flag);
 }
 
-inline void G6502::OPCodes_SetFlag(u8 flag)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_SetFlag(u8 flag)
 {
     SetFlag(flag);
 }
 
-inline void G6502::OPCodes_CMP(EightBitRegister* reg, u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_CMP(EightBitRegister* reg, u8 value)
 {
     u8 reg_value = reg->GetValue();
     u8 result = reg_value - value;
@@ -461,16 +1015,21 @@ inline void G6502::OPCodes_CMP(EightBitRegister* reg, u8 value)
         ClearFlag(FLAG_CARRY);
 }
 
-inline void G6502::OPCodes_DEC_Mem(u16 address)
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::OPCodes_DEC_Mem(Mode mode)
 {
-    u8 value = Read(address);
+    u16 address = Address(mode);
+    u8 value = Load(mode, address);
     u8 result = value - 1;
-    Write(address, result);
+    Store(mode, address, result);
     SetZeroFlagFromResult(result);
     SetNegativeFlagFromResult(result);
+    return result;
 }
 
-inline void G6502::OPCodes_DEC_Reg(EightBitRegister* reg)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_DEC_Reg(EightBitRegister* reg)
 {
     u8 value = reg->GetValue();
     u8 result = value - 1;
@@ -479,7 +1038,8 @@ inline void G6502::OPCodes_DEC_Reg(EightBitRegister* reg)
     SetNegativeFlagFromResult(result);
 }
 
-inline void G6502::OPCodes_EOR(u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_EOR(u8 value)
 {
     u8 result = A_.GetValue() ^ value;
     A_.SetValue(result);
@@ -487,16 +1047,21 @@ inline void G6502::OPCodes_EOR(u8 value)
     SetNegativeFlagFromResult(result);
 }
 
-inline void G6502::OPCodes_INC_Mem(u16 address)
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::OPCodes_INC_Mem(Mode mode)
 {
-    u8 value = Read(address);
+    u16 address = Address(mode);
+    u8 value = Load(mode, address);
     u8 result = value + 1;
-    Write(address, result);
+    Store(mode, address, result);
     SetZeroFlagFromResult(result);
     SetNegativeFlagFromResult(result);
+    return result;
 }
 
-inline void G6502::OPCodes_INC_Reg(EightBitRegister* reg)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_INC_Reg(EightBitRegister* reg)
 {
     u8 value = reg->GetValue();
     u8 result = value + 1;
@@ -505,14 +1070,16 @@ inline void G6502::OPCodes_INC_Reg(EightBitRegister* reg)
     SetNegativeFlagFromResult(result);
 }
 
-inline void G6502::OPCodes_LD(EightBitRegister* reg, u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_LD(EightBitRegister* reg, u8 value)
 {
     reg->SetValue(value);
     SetZeroFlagFromResult(value);
     SetNegativeFlagFromResult(value);
 }
 
-inline void G6502::OPCodes_LSR_Accumulator()
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_LSR_Accumulator()
 {
     u8 value = A_.GetValue();
     u8 result = value >> 1;
@@ -525,20 +1092,25 @@ inline void G6502::OPCodes_LSR_Accumulator()
         ClearFlag(FLAG_CARRY);
 }
 
-inline void G6502::OPCodes_LSR_Memory(u16 address)
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::OPCodes_LSR_Memory(Mode mode)
 {
-    u8 value = Read(address);
+    u16 address = Address(mode);
+    u8 value = Load(mode, address);
     u8 result = value >> 1;
-    Write(address, result);
+    Store(mode, address, result);
     SetZeroFlagFromResult(result);
     SetNegativeFlagFromResult(result);
     if ((value & 0x01) != 0)
         SetFlag(FLAG_CARRY);
     else
         ClearFlag(FLAG_CARRY);
+    return result;
 }
 
-inline void G6502::OPCodes_ORA(u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_ORA(u8 value)
 {
     u8 result = A_.GetValue() | value;
     A_.SetValue(result);
@@ -546,7 +1118,8 @@ inline void G6502::OPCodes_ORA(u8 value)
     SetNegativeFlagFromResult(result);
 }
 
-inline void G6502::OPCodes_ROL_Accumulator()
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_ROL_Accumulator()
 {
     u8 value = A_.GetValue();
     u8 result = static_cast<u8>(value << 1);
@@ -560,21 +1133,26 @@ inline void G6502::OPCodes_ROL_Accumulator()
         ClearFlag(FLAG_CARRY);
 }
 
-inline void G6502::OPCodes_ROL_Memory(u16 address)
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::OPCodes_ROL_Memory(Mode mode)
 {
-    u8 value = Read(address);
+    u16 address = Address(mode);
+    u8 value = Load(mode, address);
     u8 result = static_cast<u8>(value << 1);
     result |= IsSetFlag(FLAG_CARRY) ? 0x01 : 0x00;
-    Write(address, result);
+    Store(mode, address, result);
     SetZeroFlagFromResult(result);
     SetNegativeFlagFromResult(result);
     if ((value & 0x80) != 0)
         SetFlag(FLAG_CARRY);
     else
         ClearFlag(FLAG_CARRY);
+    return result;
 }
 
-inline void G6502::OPCodes_ROR_Accumulator()
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_ROR_Accumulator()
 {
     u8 value = A_.GetValue();
     u8 result = value >> 1;
@@ -588,21 +1166,26 @@ inline void G6502::OPCodes_ROR_Accumulator()
         ClearFlag(FLAG_CARRY);
 }
 
-inline void G6502::OPCodes_ROR_Memory(u16 address)
+template <class MemoryImpl>
+template <class Mode>
+inline u8 G6502<MemoryImpl>::OPCodes_ROR_Memory(Mode mode)
 {
-    u8 value = Read(address);
+    u16 address = Address(mode);
+    u8 value = Load(mode, address);
     u8 result = value >> 1;
     result |= IsSetFlag(FLAG_CARRY) ? 0x80 : 0x00;
-    Write(address, result);
+    Store(mode, address, result);
     SetZeroFlagFromResult(result);
     SetNegativeFlagFromResult(result);
     if ((value & 0x01) != 0)
         SetFlag(FLAG_CARRY);
     else
         ClearFlag(FLAG_CARRY);
+    return result;
 }
 
-inline void G6502::OPCodes_SBC(u8 value)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_SBC(u8 value)
 {
     int result = A_.GetValue() - value - (IsSetFlag(FLAG_CARRY) ? 0x00 : 0x01);
     u8 final_result = static_cast<u8> (result & 0xFF);
@@ -619,13 +1202,27 @@ inline void G6502::OPCodes_SBC(u8 value)
     A_.SetValue(final_result);
 }
 
-inline void G6502::OPCodes_Store(EightBitRegister* reg, u16 address)
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::OPCodes_Store(EightBitRegister* reg, Mode mode)
 {
-    u8 value = reg->GetValue();
-    Write(address, value);
+    Store(mode, Address(mode), reg->GetValue());
+}
+
+// SHX, SHY, AHX and TAS store value & (high byte of the base address + 1),
+// and when indexing crosses a page that result also replaces the high byte
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_StoreHighAnd(u16 address, u8 index, u8 value)
+{
+    u16 base = address - index;
+    u8 result = value & static_cast<u8>((base >> 8) + 1);
+    if (PageCrossed(base, address))
+        address = Address16(result, address & 0x00FF);
+    Write(address, result);
 }
 
-inline void G6502::OPCodes_Transfer(EightBitRegister* reg, EightBitRegister* target)
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::OPCodes_Transfer(EightBitRegister* reg, EightBitRegister* target)
 {
     u8 value = reg->GetValue();
     target->SetValue(value);
@@ -0,0 +1,578 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/ 
+ * 
+ */
+
+#ifndef G6502_CORE_INL_H_
+#define	G6502_CORE_INL_H_
+
+#include <cstdio>
+#include "g6502_core.h"
+#include "g6502_definitions.h"
+#include "g6502_eight_bit_register.h"
+#include "g6502_sixteen_bit_register.h"
+#include "g6502_opcode_names.h"
+#include "g6502_opcode_table.h"
+#include "g6502_opcodes_inl.h"
+
+namespace g6502
+{
+
+#define G6502_OPCODE_HANDLER(opcode, operation, mode, t_states, page_cross) \
+    &G6502::Instruction<Op##operation, Mode##mode>,
+
+template <class MemoryImpl>
+const typename G6502<MemoryImpl>::OPCptr G6502<MemoryImpl>::kOPCodeHandlers[256] = { G6502_OPCODE_TABLE(G6502_OPCODE_HANDLER) };
+
+#undef G6502_OPCODE_HANDLER
+
+template <class MemoryImpl>
+G6502<MemoryImpl>::G6502()
+{
+    memory_impl_ = nullptr;
+    t_states_ = 0;
+    run_t_states_ = 0;
+    run_target_ = 0;
+    interrupt_asserted_ = false;
+    nmi_interrupt_requested_ = false;
+    page_crossed_ = false;
+    branch_taken_ = false;
+#ifndef G6502_EAGER_FLAGS
+    negative_result_ = 0;
+    zero_result_ = 1;
+    carry_ = 0;
+#endif
+    instruction_cache_ = nullptr;
+    cached_operand_ = nullptr;
+    ResetInstructionCacheStats();
+    jit_blocks_ = nullptr;
+    jit_run_start_ = 0;
+    jit_extra_t_states_ = 0;
+    jit_run_target_ = 0;
+    jit_map_changed_ = false;
+    jit_max_block_instructions_ = kJITMaxBlockInstructions;
+#ifdef G6502_JIT_X64
+    jit_code_ = nullptr;
+#endif
+    ResetJITStats();
+    idle_loop_detection_ = false;
+    idle_loop_.valid = false;
+    idle_loop_.end = 0;
+    ResetIdleLoopStats();
+    direct_memory_ = true;
+    ram_ = nullptr;
+    fetch_page_ = nullptr;
+    fetch_page_number_ = kNoFetchPage;
+    instruction_fusion_ = true;
+    ResetFusionStats();
+#ifdef G6502_PROFILER
+    profiler_ = nullptr;
+#endif
+    trace_buffer_ = nullptr;
+    trace_cycles_ = 0;
+}
+
+template <class MemoryImpl>
+G6502<MemoryImpl>::~G6502()
+{
+    delete [] instruction_cache_;
+    EnableJIT(false);
+    EnableProfiler(false);
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::Init(MemoryImpl* memory_impl)
+{
+    memory_impl_ = memory_impl;
+    EnableDirectMemory(direct_memory_);
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::Reset()
+{
+    PC_.SetLow(memory_impl_->Read(0xFFFC));
+    PC_.SetHigh(memory_impl_->Read(0xFFFD));
+    A_.SetValue(0x00);
+    X_.SetValue(0x00);
+    Y_.SetValue(0x00);
+    S_.SetValue(0xFD);
+    SetP(0x34);
+    t_states_ = 0;
+    run_t_states_ = 0;
+    run_target_ = 0;
+    interrupt_asserted_ = false;
+    nmi_interrupt_requested_ = false;
+    page_crossed_ = false;
+    branch_taken_ = false;
+    cached_operand_ = nullptr;
+    // A new cartridge may reuse the same bank numbers
+    InvalidateInstructionCache();
+    FlushJIT();
+    idle_loop_.valid = false;
+    InvalidateFetchPage();
+#ifdef G6502_PROFILER
+    if (profiler_ != nullptr)
+    {
+        profiler_->ClearCallStack();
+    }
+#endif
+}
+
+// Only available in G6502_INSTRUCTION_CACHE builds
+template <class MemoryImpl>
+void G6502<MemoryImpl>::EnableInstructionCache(bool enabled)
+{
+#ifdef G6502_INSTRUCTION_CACHE
+    if (enabled && (instruction_cache_ == nullptr))
+    {
+        instruction_cache_ = new stDecodedInstruction[kInstructionCacheSize];
+        InvalidateInstructionCache();
+    }
+    else if (!enabled)
+    {
+        delete [] instruction_cache_;
+        instruction_cache_ = nullptr;
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+// Bank switches need no call here, the bank is part of the key. This is
+// for code banks whose contents change.
+template <class MemoryImpl>
+void G6502<MemoryImpl>::InvalidateInstructionCache()
+{
+    if (instruction_cache_ != nullptr)
+    {
+        for (int i = 0; i < kInstructionCacheSize; i++)
+        {
+            instruction_cache_[i].bank = -1;
+        }
+    }
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::GetInstructionCacheStats(stInstructionCacheStats* stats) const
+{
+    *stats = instruction_cache_stats_;
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::ResetInstructionCacheStats()
+{
+    instruction_cache_stats_.hits = 0;
+    instruction_cache_stats_.misses = 0;
+    instruction_cache_stats_.uncached = 0;
+}
+
+// Zero page and stack accesses straight to RAM, and opcode fetches from a
+// pointer to the current page, when the bus provides them. On by default.
+template <class MemoryImpl>
+void G6502<MemoryImpl>::EnableDirectMemory(bool enabled)
+{
+    direct_memory_ = enabled;
+    ram_ = (enabled && (memory_impl_ != nullptr)) ? memory_impl_->GetRAMPages() : nullptr;
+    InvalidateFetchPage();
+}
+
+// Fetches outside the current page, which becomes the new fetch page when
+// the bus has a pointer for it
+template <class MemoryImpl>
+u8 G6502<MemoryImpl>::FetchFromBus(u16 address)
+{
+    if (direct_memory_)
+    {
+        const u8* page = memory_impl_->GetReadPage(address);
+
+        if (page != nullptr)
+        {
+            fetch_page_ = page;
+            fetch_page_number_ = address >> 8;
+            return page[address & 0xFF];
+        }
+    }
+
+    return Read(address);
+}
+
+// Pairs from G6502_FUSED_PAIR_TABLE run in one dispatch in the threaded
+// and switch RunFor() loops. On by default, timing is unchanged.
+template <class MemoryImpl>
+void G6502<MemoryImpl>::EnableInstructionFusion(bool enabled)
+{
+    instruction_fusion_ = enabled;
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::GetFusionStats(stFusionStats* stats) const
+{
+    *stats = fusion_stats_;
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::ResetFusionStats()
+{
+    for (int i = 0; i < kFusedPairCount; i++)
+    {
+        fusion_stats_.pairs[i] = 0;
+    }
+}
+
+// Called after each instruction with its opcode, nothing is left of it
+// unless the opcode starts a pair
+template <class MemoryImpl>
+template <int Opcode>
+inline void G6502<MemoryImpl>::FuseNext()
+{
+    #define G6502_FUSE_PAIR(pair, first, second, name) \
+        if ((Opcode == first) && FusePair<second>(pair)) \
+            return;
+
+    G6502_FUSED_PAIR_TABLE(G6502_FUSE_PAIR)
+
+    #undef G6502_FUSE_PAIR
+}
+
+// Runs the next instruction when it is Opcode, exactly as its own
+// dispatch would: only if the run goes on and no interrupt is due. The
+// opcode is only peeked at in the fetch page, anywhere else reading it
+// could have side effects.
+template <class MemoryImpl>
+template <int Opcode>
+inline bool G6502<MemoryImpl>::FusePair(int pair)
+{
+    u16 pc = PC_.GetValue();
+
+    if (!instruction_fusion_ || (run_t_states_ >= run_target_) || InterruptPending() ||
+            ((pc >> 8) != fetch_page_number_) || (fetch_page_[pc & 0xFF] != Opcode))
+    {
+        return false;
+    }
+
+    PC_.SetValue(pc + 1);
+    page_crossed_ = false;
+    branch_taken_ = false;
+
+    Instruction<typename OPCodeTraits<Opcode>::Operation, typename OPCodeTraits<Opcode>::Mode>();
+
+    run_t_states_ += kOPCodeInfo[Opcode].t_states;
+    run_t_states_ += page_crossed_ ? kOPCodeInfo[Opcode].page_cross_t_states : 0;
+    run_t_states_ += branch_taken_ ? 1 : 0;
+    fusion_stats_.pairs[pair]++;
+
+    return true;
+}
+
+template <class MemoryImpl>
+unsigned int G6502<MemoryImpl>::RunFor(unsigned int t_states)
+{
+    run_t_states_ = 0;
+    run_target_ = t_states;
+    // Snapshots are timed from the start of the run
+    idle_loop_.valid = false;
+
+#ifdef G6502_PROFILER
+    bool tick_only = (trace_buffer_ != nullptr) || (profiler_ != nullptr);
+#else
+    bool tick_only = (trace_buffer_ != nullptr);
+#endif
+
+    // Only Tick() reports to the trace and the profiler
+    if (tick_only)
+    {
+        while (run_t_states_ < run_target_)
+        {
+            unsigned int start = run_t_states_;
+            run_t_states_ = start + Tick();
+        }
+
+        return run_t_states_;
+    }
+
+#ifdef G6502_JIT_X64
+    if (jit_blocks_ != nullptr)
+    {
+        return RunForJIT();
+    }
+#endif
+
+#ifdef G6502_INSTRUCTION_CACHE
+    if (instruction_cache_ != nullptr)
+    {
+        return RunForCached();
+    }
+#endif
+
+#if defined(G6502_DISPATCH_TABLE) || defined(G6502_DISASM) || defined(G6502_DEBUG)
+
+    while (run_t_states_ < run_target_)
+    {
+        // Tick() already counts the T-states added by AddTStates()
+        unsigned int start = run_t_states_;
+        run_t_states_ = start + Tick();
+    }
+
+    return run_t_states_;
+
+#elif defined(G6502_DISPATCH_THREADED)
+
+    #define G6502_THREADED_LABEL(opcode, operation, mode, t_states, page_cross) &&label_##opcode,
+
+    #define G6502_THREADED_NEXT() \
+        while (true) \
+        { \
+            if (run_t_states_ >= run_target_) \
+                return run_t_states_; \
+            if (!InterruptPending()) \
+                break; \
+            run_t_states_ += ServeInterrupt(); \
+        } \
+        page_crossed_ = false; \
+        branch_taken_ = false; \
+        goto *kDispatchTable[Fetch8()]
+
+    #define G6502_THREADED_HANDLER(opcode, operation, mode, t_states, page_cross) \
+        label_##opcode: \
+            Instruction<Op##operation, Mode##mode>(); \
+            run_t_states_ += t_states; \
+            run_t_states_ += page_crossed_ ? page_cross : 0; \
+            run_t_states_ += branch_taken_ ? 1 : 0; \
+            FuseNext<opcode>(); \
+            G6502_THREADED_NEXT();
+
+    static const void* const kDispatchTable[256] = { G6502_OPCODE_TABLE(G6502_THREADED_LABEL) };
+
+    G6502_THREADED_NEXT();
+
+    G6502_OPCODE_TABLE(G6502_THREADED_HANDLER)
+
+    #undef G6502_THREADED_HANDLER
+    #undef G6502_THREADED_NEXT
+    #undef G6502_THREADED_LABEL
+
+#else
+
+    #define G6502_SWITCH_CASE(opcode, operation, mode, t_states, page_cross) \
+        case opcode: \
+            Instruction<Op##operation, Mode##mode>(); \
+            run_t_states_ += t_states; \
+            run_t_states_ += page_crossed_ ? page_cross : 0; \
+            run_t_states_ += branch_taken_ ? 1 : 0; \
+            FuseNext<opcode>(); \
+            break;
+
+    while (run_t_states_ < run_target_)
+    {
+        if (InterruptPending())
+        {
+            run_t_states_ += ServeInterrupt();
+            continue;
+        }
+
+        page_crossed_ = false;
+        branch_taken_ = false;
+
+        switch (Fetch8())
+        {
+            G6502_OPCODE_TABLE(G6502_SWITCH_CASE)
+        }
+    }
+
+    return run_t_states_;
+
+    #undef G6502_SWITCH_CASE
+
+#endif
+}
+
+// Same loop as the table dispatch, with opcode and operands taken from the
+// decoded instruction when the code comes from a cacheable bank
+template <class MemoryImpl>
+unsigned int G6502<MemoryImpl>::RunForCached()
+{
+    #define G6502_CACHED_CASE(opcode, operation, mode, t_states, page_cross) \
+        case opcode: \
+            PC_.SetValue(pc + Mode##mode::kSize); \
+            Instruction<Op##operation, Mode##mode>(); \
+            break;
+
+    while (run_t_states_ < run_target_)
+    {
+        if (InterruptPending())
+        {
+            run_t_states_ += ServeInterrupt();
+            continue;
+        }
+
+        page_crossed_ = false;
+        branch_taken_ = false;
+
+        u16 pc = PC_.GetValue();
+        int bank = memory_impl_->GetCodeBank(pc);
+        stDecodedInstruction* entry = &instruction_cache_[pc & (kInstructionCacheSize - 1)];
+
+        if ((entry->bank == bank) && (entry->address == pc) && (bank >= 0))
+        {
+            instruction_cache_stats_.hits++;
+        }
+        else
+        {
+            // The operands must come from the same bank as the opcode
+            if ((bank < 0) || (((pc & 0xFF) + kOPCodeInfo[memory_impl_->Read(pc)].size) > 0x100))
+            {
+                instruction_cache_stats_.uncached++;
+
+                u8 opcode = Fetch8();
+                (this->*kOPCodeHandlers[opcode])();
+
+                run_t_states_ += kOPCodeInfo[opcode].t_states;
+                run_t_states_ += page_crossed_ ? kOPCodeInfo[opcode].page_cross_t_states : 0;
+                run_t_states_ += branch_taken_ ? 1 : 0;
+                continue;
+            }
+
+            instruction_cache_stats_.misses++;
+            DecodeInstruction(entry, pc, bank);
+        }
+
+        cached_operand_ = entry->operand;
+
+        // Handler bodies inlined, as in the switch dispatch
+        switch (entry->opcode)
+        {
+            G6502_OPCODE_TABLE(G6502_CACHED_CASE)
+        }
+
+        cached_operand_ = nullptr;
+
+        run_t_states_ += entry->t_states;
+        run_t_states_ += page_crossed_ ? entry->page_cross_t_states : 0;
+        run_t_states_ += branch_taken_ ? 1 : 0;
+    }
+
+    return run_t_states_;
+
+    #undef G6502_CACHED_CASE
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::DecodeInstruction(stDecodedInstruction* entry, u16 address, int bank)
+{
+    u8 opcode = memory_impl_->Read(address);
+    u8 size = kOPCodeInfo[opcode].size;
+
+    entry->opcode = opcode;
+    entry->bank = bank;
+    entry->address = address;
+    entry->operand[0] = (size > 1) ? memory_impl_->Read(address + 1) : 0;
+    entry->operand[1] = (size > 2) ? memory_impl_->Read(address + 2) : 0;
+    entry->t_states = kOPCodeInfo[opcode].t_states;
+    entry->page_cross_t_states = kOPCodeInfo[opcode].page_cross_t_states;
+}
+
+template <class MemoryImpl>
+unsigned int G6502<MemoryImpl>::Tick()
+{
+    t_states_ = 0;
+    page_crossed_ = false;
+    branch_taken_ = false;
+
+    if (InterruptPending())
+    {
+        t_states_ = ServeInterrupt();
+        trace_cycles_ += t_states_;
+        return t_states_;
+    }
+
+    u16 opcode_address = PC_.GetValue();
+    u8 opcode = Fetch8();
+
+#ifdef G6502_DISASM
+    if (!memory_impl_->IsDisassembled(opcode_address))
+    {
+        memory_impl_->Disassemble(opcode_address, kOPCodeNames[opcode]);
+    }
+#endif
+
+    if (trace_buffer_ != nullptr)
+    {
+        TraceInstruction(opcode_address, opcode);
+    }
+
+    (this->*kOPCodeHandlers[opcode])();
+
+    t_states_ += kOPCodeInfo[opcode].t_states;
+    t_states_ += page_crossed_ ? kOPCodeInfo[opcode].page_cross_t_states : 0;
+    t_states_ += branch_taken_ ? 1 : 0;
+
+#ifdef G6502_PROFILER
+    if (profiler_ != nullptr)
+    {
+        ProfileInstruction(opcode_address, opcode);
+    }
+#endif
+
+    trace_cycles_ += t_states_;
+
+    return t_states_;
+}
+
+template <class MemoryImpl>
+unsigned int G6502<MemoryImpl>::ServeInterrupt()
+{
+    idle_loop_.valid = false;
+
+    StackPush16(PC_.GetValue());
+    ClearFlag(FLAG_BRK);
+    StackPush8(GetP());
+    SetFlag(FLAG_IRQ);
+
+    bool nmi = nmi_interrupt_requested_;
+
+    if (nmi)
+    {
+        nmi_interrupt_requested_ = false;
+        PC_.SetLow(memory_impl_->Read(0xFFFA));
+        PC_.SetHigh(memory_impl_->Read(0xFFFB));
+    }
+    else
+    {
+        PC_.SetLow(memory_impl_->Read(0xFFFE));
+        PC_.SetHigh(memory_impl_->Read(0xFFFF));
+    }
+
+#ifdef G6502_PROFILER
+    if (profiler_ != nullptr)
+    {
+        profiler_->Enter(PC_.GetValue(), nmi ? kProfilerNMI : kProfilerIRQ, S_.GetValue() + 3);
+        profiler_->AddTStates(7);
+    }
+#endif
+
+    return 7;
+}
+
+} // namespace g6502
+
+// Uses G6502_OPCODE_TABLE
+#include "g6502_jit_inl.h"
+#include "g6502_idle_loop_inl.h"
+#include "g6502_profiler_inl.h"
+#include "g6502_trace_inl.h"
+
+#endif // G6502_CORE_INL_H_
@@ -25,11 +25,41 @@
 namespace g6502
 {
 
-#define G6502_DEBUG 1
+#ifndef G6502_DISABLE_DEBUG
+    #define G6502_DEBUG 1
+#endif
 
 #ifdef G6502_DEBUG
     #define G6502_DISASM 1
 #endif
+
+// Instruction dispatch used by G6502::RunFor(), selectable at build time:
+//   G6502_DISPATCH_TABLE:    pointer-to-member table, same path as Tick()
+//   G6502_DISPATCH_SWITCH:   one big switch with the opcode bodies inlined
+//   G6502_DISPATCH_THREADED: computed-goto threaded code (GCC and Clang)
+#if !defined(G6502_DISPATCH_TABLE) && !defined(G6502_DISPATCH_SWITCH) && !defined(G6502_DISPATCH_THREADED)
+    #if defined(__GNUC__)
+        #define G6502_DISPATCH_THREADED 1
+    #else
+        #define G6502_DISPATCH_SWITCH 1
+    #endif
+#endif
+
+// G6502_INSTRUCTION_CACHE builds in the decoded instruction cache for code
+// banks (see G6502::EnableInstructionCache()). It costs a branch on every
+// operand fetch, so it is left out by default.
+
+// N, Z and C are evaluated lazily (see G6502::GetP()). G6502_EAGER_FLAGS
+// keeps every flag in P as it is computed, for comparison.
+
+// G6502_JIT builds in the dynamic recompiler (see G6502::EnableJIT()). Only
+// x86-64 with the System V calling convention is supported.
+#if defined(G6502_JIT) && defined(__x86_64__) && !defined(_WIN32)
+    #define G6502_JIT_X64 1
+#endif
+
+// G6502_PROFILER builds in the guest code profiler (see
+// G6502::EnableProfiler()). Without it the hooks are compiled out.
     
 #define FLAG_CARRY 0x01
 #define FLAG_ZERO 0x02
@@ -0,0 +1,279 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_IDLE_LOOP_INL_H_
+#define	G6502_IDLE_LOOP_INL_H_
+
+#include "g6502_core.h"
+
+namespace g6502
+{
+
+// Skipping is exact: a loop is only fast-forwarded while going round it
+// can't change anything but the clock. Off by default, the memory must
+// report read limits (see MemoryInterface::GetIdleReadLimit()).
+template <class MemoryImpl>
+void G6502<MemoryImpl>::EnableIdleLoopDetection(bool enabled)
+{
+    idle_loop_detection_ = enabled;
+    idle_loop_.valid = false;
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::GetIdleLoopStats(stIdleLoopStats* stats) const
+{
+    *stats = idle_loop_stats_;
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::ResetIdleLoopStats()
+{
+    idle_loop_stats_.skips = 0;
+    idle_loop_stats_.skipped_t_states = 0;
+}
+
+// Called by taken backward branches and JMPs, with PC_ already at start
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::IdleLoop(u16 start, u16 end)
+{
+    stIdleLoop* loop = &idle_loop_;
+    u64 registers = A_.GetValue() | (X_.GetValue() << 8) | (Y_.GetValue() << 16) |
+            (static_cast<u64>(S_.GetValue()) << 24) | (static_cast<u64>(GetP()) << 32);
+
+    // Counting loops take this path on every round
+    if (loop->valid && !loop->analyzed && (loop->start == start) && (loop->end == end) && (loop->registers != registers))
+    {
+        loop->registers = registers;
+        loop->t_states = run_t_states_;
+        return;
+    }
+
+    IdleLoopRound(start, end, registers);
+}
+
+// The first repeat with the same registers analyzes the loop, the next
+// ones skip every round that ends before the run does
+template <class MemoryImpl>
+void G6502<MemoryImpl>::IdleLoopRound(u16 start, u16 end, u64 registers)
+{
+    stIdleLoop* loop = &idle_loop_;
+
+    // Compiled blocks go round loops without coming here
+    if ((jit_blocks_ != nullptr) || ((end - start) > kIdleLoopMaxBytes))
+    {
+        loop->valid = false;
+        return;
+    }
+
+    unsigned int now = run_t_states_;
+    bool same_loop = loop->valid && (loop->start == start) && (loop->end == end);
+    bool same_state = same_loop && (loop->registers == registers);
+
+    if (same_state && loop->analyzed && loop->safe && (now > loop->t_states) &&
+            (now < loop->stable_t_states) && !InterruptPending())
+    {
+        // Rounds whose branch would still start before the run ends,
+        // reading nothing past its limit
+        unsigned int period = now - loop->t_states;
+        unsigned int limit = GetIdleLoopReadLimit();
+        unsigned int rounds = (run_target_ > now) ? ((run_target_ - now - 1) / period) : 0;
+
+        if (rounds > (limit / period))
+        {
+            rounds = limit / period;
+        }
+
+        unsigned int skipped = rounds * period;
+
+        if (skipped > 0)
+        {
+            t_states_ += skipped;
+            run_t_states_ += skipped;
+            idle_loop_stats_.skips++;
+            idle_loop_stats_.skipped_t_states += skipped;
+        }
+
+        loop->t_states = run_t_states_;
+        loop->stable_t_states = (limit > (kIdleReadUnlimited - now)) ? kIdleReadUnlimited : now + limit;
+        return;
+    }
+
+    if (!same_loop)
+    {
+        loop->valid = true;
+        loop->analyzed = false;
+        loop->start = start;
+        loop->end = end;
+    }
+    else if (same_state && !loop->analyzed)
+    {
+        loop->safe = AnalyzeIdleLoop();
+        loop->analyzed = true;
+    }
+
+    loop->registers = registers;
+    loop->t_states = now;
+    loop->stable_t_states = 0;
+
+    if (loop->analyzed && loop->safe)
+    {
+        unsigned int limit = GetIdleLoopReadLimit();
+        loop->stable_t_states = (limit > (kIdleReadUnlimited - now)) ? kIdleReadUnlimited : now + limit;
+    }
+}
+
+// The body may only read memory and change registers, and every branch or
+// JMP in it must land on one of its instructions
+template <class MemoryImpl>
+bool G6502<MemoryImpl>::AnalyzeIdleLoop()
+{
+    u16 start = idle_loop_.start;
+    int length = idle_loop_.end - start;
+    int offset = 0;
+    u32 instructions = 0;
+    u32 targets = 0;
+
+    idle_loop_.read_count = 0;
+
+    while (offset < length)
+    {
+        u16 pc = start + offset;
+
+        if (memory_impl_->GetIdleReadLimit(pc) != kIdleReadUnlimited)
+        {
+            return false;
+        }
+
+        const stOPCodeInfo& info = kOPCodeInfo[memory_impl_->Read(pc)];
+
+        if (!info.read_only)
+        {
+            return false;
+        }
+
+        for (int i = 1; i < info.size; i++)
+        {
+            if (memory_impl_->GetIdleReadLimit(pc + i) != kIdleReadUnlimited)
+            {
+                return false;
+            }
+        }
+
+        u8 low = (info.size > 1) ? memory_impl_->Read(pc + 1) : 0;
+        u8 high = (info.size > 2) ? memory_impl_->Read(pc + 2) : 0;
+        u16 address = Address16(high, low);
+
+        switch (info.addressing)
+        {
+            case kAddressingImplied:
+            case kAddressingAccumulator:
+            case kAddressingImmediate:
+                break;
+            case kAddressingRelative:
+                address = static_cast<u16>(pc + 2 + static_cast<s8>(low));
+                if (static_cast<u16>(address - start) >= length)
+                    return false;
+                targets |= 1 << (address - start);
+                break;
+            case kAddressingZeroPage:
+                if (!AddIdleLoopRead(low))
+                    return false;
+                break;
+            case kAddressingZeroPageX:
+            case kAddressingZeroPageY:
+                if (memory_impl_->GetIdleReadLimit(0x0000) != kIdleReadUnlimited)
+                    return false;
+                break;
+            case kAddressingAbsolute:
+                // JMP
+                if (info.opcode == 0x4C)
+                {
+                    if (static_cast<u16>(address - start) >= length)
+                        return false;
+                    targets |= 1 << (address - start);
+                }
+                else if (!AddIdleLoopRead(address))
+                    return false;
+                break;
+            case kAddressingAbsoluteX:
+            case kAddressingAbsoluteY:
+                // Limits hold for whole pages, check both the index can reach
+                if ((memory_impl_->GetIdleReadLimit(address) != kIdleReadUnlimited) ||
+                        (memory_impl_->GetIdleReadLimit(address + 0xFF) != kIdleReadUnlimited))
+                    return false;
+                break;
+            default:
+                return false;
+        }
+
+        instructions |= 1 << offset;
+        offset += info.size;
+    }
+
+    return (offset == length) && ((targets & ~instructions) == 0);
+}
+
+// Keeps reads that are only stable for a while, to ask for their limit on
+// every round
+template <class MemoryImpl>
+bool G6502<MemoryImpl>::AddIdleLoopRead(u16 address)
+{
+    if (memory_impl_->GetIdleReadLimit(address) == kIdleReadUnlimited)
+    {
+        return true;
+    }
+
+    for (int i = 0; i < idle_loop_.read_count; i++)
+    {
+        if (idle_loop_.reads[i] == address)
+        {
+            return true;
+        }
+    }
+
+    if (idle_loop_.read_count == kIdleLoopMaxReads)
+    {
+        return false;
+    }
+
+    idle_loop_.reads[idle_loop_.read_count++] = address;
+    return true;
+}
+
+template <class MemoryImpl>
+unsigned int G6502<MemoryImpl>::GetIdleLoopReadLimit()
+{
+    unsigned int limit = kIdleReadUnlimited;
+
+    for (int i = 0; i < idle_loop_.read_count; i++)
+    {
+        unsigned int read_limit = memory_impl_->GetIdleReadLimit(idle_loop_.reads[i]);
+
+        if (read_limit < limit)
+        {
+            limit = read_limit;
+        }
+    }
+
+    return limit;
+}
+
+} // namespace g6502
+
+#endif // G6502_IDLE_LOOP_INL_H_
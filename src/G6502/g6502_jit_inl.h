@@ -0,0 +1,433 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_JIT_INL_H_
+#define	G6502_JIT_INL_H_
+
+#include "g6502_core.h"
+
+namespace g6502
+{
+
+// Returns false when the JIT is not built in (see G6502_JIT in
+// g6502_definitions.h) or executable memory is not available
+template <class MemoryImpl>
+bool G6502<MemoryImpl>::EnableJIT(bool enabled)
+{
+#ifdef G6502_JIT_X64
+    if (enabled && (jit_blocks_ == nullptr))
+    {
+        jit_code_ = new JITCodeBuffer();
+
+        if (!jit_code_->Init(kJITCodeBufferSize))
+        {
+            delete jit_code_;
+            jit_code_ = nullptr;
+            return false;
+        }
+
+        for (int i = 0; i < 256; i++)
+        {
+            jit_nz_flags_[i] = (i & FLAG_NEGATIVE) | ((i == 0) ? FLAG_ZERO : 0);
+        }
+
+        jit_blocks_ = new stJITBlock[kJITBlockCount];
+        FlushJIT();
+        jit_stats_.flushes = 0;
+    }
+    else if (!enabled)
+    {
+        delete [] jit_blocks_;
+        jit_blocks_ = nullptr;
+        delete jit_code_;
+        jit_code_ = nullptr;
+    }
+
+    return true;
+#else
+    return !enabled;
+#endif
+}
+
+// Mostly for testing: with 1 every instruction is checked on its own
+template <class MemoryImpl>
+void G6502<MemoryImpl>::SetJITMaxBlockInstructions(int instructions)
+{
+    if (instructions < 1)
+        instructions = 1;
+    else if (instructions > kJITMaxBlockInstructions)
+        instructions = kJITMaxBlockInstructions;
+
+    jit_max_block_instructions_ = instructions;
+    FlushJIT();
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::GetJITStats(stJITStats* stats) const
+{
+    *stats = jit_stats_;
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::GetState(stProcessorState* state) const
+{
+    state->PC = PC_.GetValue();
+    state->A = A_.GetValue();
+    state->X = X_.GetValue();
+    state->Y = Y_.GetValue();
+    state->S = S_.GetValue();
+    state->P = GetP();
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::FlushJIT()
+{
+#ifdef G6502_JIT_X64
+    if (jit_blocks_ == nullptr)
+        return;
+
+    jit_code_->Flush();
+
+    for (int i = 0; i < kJITBlockCount; i++)
+    {
+        jit_blocks_[i].function = nullptr;
+        jit_blocks_[i].bank = -1;
+        jit_blocks_[i].address = 0;
+        jit_blocks_[i].prefix_t_states = 0;
+        jit_blocks_[i].visits = 0;
+        jit_blocks_[i].state = kJITBlockCounting;
+    }
+
+    jit_stats_.flushes++;
+#endif
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::ResetJITStats()
+{
+    jit_stats_.blocks_compiled = 0;
+    jit_stats_.block_runs = 0;
+    jit_stats_.early_exits = 0;
+    jit_stats_.jit_instructions = 0;
+    jit_stats_.interpreted_instructions = 0;
+    jit_stats_.flushes = 0;
+}
+
+#ifdef G6502_JIT_X64
+
+// Same loop as the threaded dispatch. Code from a PRG-ROM bank is counted
+// per (bank, address) and compiled once hot; RAM code is always
+// interpreted, so self-modifying code needs no invalidation. Blocks are only
+// looked up at entries: where the run starts, branch and jump targets,
+// interrupt vectors, the exits of compiled blocks and the end of fused
+// pairs. Straight-line code goes from handler to handler, and an entry that failed to compile keeps
+// its failed state, so it is never counted or compiled again.
+template <class MemoryImpl>
+unsigned int G6502<MemoryImpl>::RunForJIT()
+{
+    #define G6502_JIT_LABEL(opcode, operation, mode, t_states, page_cross) &&label_##opcode,
+
+    #define G6502_JIT_HANDLER(opcode, operation, mode, t_states, page_cross) \
+        label_##opcode: \
+            Instruction<Op##operation, Mode##mode>(); \
+            run_t_states_ += t_states; \
+            run_t_states_ += page_crossed_ ? page_cross : 0; \
+            run_t_states_ += branch_taken_ ? 1 : 0; \
+            FuseNext<opcode>(); \
+            if (PC_.GetValue() != static_cast<u16>(pc + Mode##mode::kSize)) \
+                goto entry; \
+            goto next;
+
+    static const void* const kDispatchTable[256] = { G6502_OPCODE_TABLE(G6502_JIT_LABEL) };
+
+    u16 pc;
+
+entry:
+    while (true)
+    {
+        if (run_t_states_ >= run_target_)
+            return run_t_states_;
+
+        if (InterruptPending())
+        {
+            run_t_states_ += ServeInterrupt();
+            continue;
+        }
+
+        pc = PC_.GetValue();
+        int bank = memory_impl_->GetCodeBank(pc);
+
+        if (bank < 0)
+            break;
+
+        stJITBlock* block = &jit_blocks_[pc & (kJITBlockCount - 1)];
+
+        if ((block->bank != bank) || (block->address != pc))
+        {
+            block->function = nullptr;
+            block->bank = bank;
+            block->address = pc;
+            block->visits = 0;
+            block->state = kJITBlockCounting;
+        }
+
+        if ((block->state == kJITBlockCounting) && (++block->visits >= kJITHotThreshold))
+        {
+            CompileJITBlock(block);
+        }
+
+        // The interpreter checks the target before each instruction, so
+        // a block must not start an instruction it would not have run
+        if ((block->state != kJITBlockCompiled) || ((run_t_states_ + block->prefix_t_states) >= run_target_))
+            break;
+
+        RunJITBlock(block);
+    }
+
+    goto dispatch;
+
+next:
+    if (run_t_states_ >= run_target_)
+        return run_t_states_;
+
+    if (InterruptPending())
+    {
+        run_t_states_ += ServeInterrupt();
+        goto entry;
+    }
+
+    pc = PC_.GetValue();
+
+dispatch:
+    page_crossed_ = false;
+    branch_taken_ = false;
+    jit_stats_.interpreted_instructions++;
+    goto *kDispatchTable[Fetch8()];
+
+    G6502_OPCODE_TABLE(G6502_JIT_HANDLER)
+
+    #undef G6502_JIT_HANDLER
+    #undef G6502_JIT_LABEL
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::RunJITBlock(stJITBlock* block)
+{
+    jit_context_.a = A_.GetValue();
+    jit_context_.x = X_.GetValue();
+    jit_context_.y = Y_.GetValue();
+    jit_context_.s = S_.GetValue();
+    jit_context_.p = GetP();
+    jit_context_.exit = 0;
+    jit_context_.base_t_states = 0;
+    jit_context_.base_instructions = 0;
+    jit_context_.budget = run_target_ - run_t_states_;
+    jit_run_start_ = run_t_states_;
+    jit_extra_t_states_ = 0;
+    jit_run_target_ = run_target_;
+    jit_map_changed_ = false;
+
+    block->function(&jit_context_, this);
+
+    A_.SetValue(jit_context_.a);
+    X_.SetValue(jit_context_.x);
+    Y_.SetValue(jit_context_.y);
+    S_.SetValue(jit_context_.s);
+    SetP(jit_context_.p);
+    PC_.SetValue(jit_context_.pc);
+    run_t_states_ = jit_run_start_ + jit_extra_t_states_ + jit_context_.base_t_states + jit_context_.t_states;
+
+    jit_stats_.block_runs++;
+    jit_stats_.jit_instructions += jit_context_.base_instructions + jit_context_.instructions;
+    jit_stats_.early_exits += jit_context_.exit ? 1 : 0;
+}
+
+// A block is straight-line code within one 256-byte page, ending at the
+// first branch or JMP, at the first instruction the translator does not
+// handle, or at the page end
+template <class MemoryImpl>
+void G6502<MemoryImpl>::CompileJITBlock(stJITBlock* block)
+{
+    if (jit_code_->GetFree() < kJITMaxBlockBytes)
+    {
+        int bank = block->bank;
+        u16 address = block->address;
+        FlushJIT();
+        block->bank = bank;
+        block->address = address;
+    }
+
+    if (!jit_code_->BeginWrite())
+    {
+        block->state = kJITBlockFailed;
+        return;
+    }
+
+    const void* read = reinterpret_cast<const void*>(&G6502::JITRead);
+    const void* write = reinterpret_cast<const void*>(&G6502::JITWrite);
+
+    u8* start = jit_code_->GetCursor();
+    JITAssembler assembler(start);
+
+    u8* exit_jumps[kJITMaxBlockInstructions];
+    u16 exit_pc[kJITMaxBlockInstructions];
+    u32 exit_t_states[kJITMaxBlockInstructions];
+    u8 exit_instructions[kJITMaxBlockInstructions];
+    int exit_count = 0;
+
+    assembler.Prologue(jit_nz_flags_);
+    u8* loop_start = assembler.GetCursor();
+
+    u16 page = block->address & 0xFF00;
+    u16 address = block->address;
+    u32 t_states = 0;
+    u32 last_t_states = 0;
+    int count = 0;
+    bool terminated = false;
+
+    while ((count < jit_max_block_instructions_) && ((address & 0xFF00) == page))
+    {
+        u8 opcode = memory_impl_->Read(address);
+        u8 size = kOPCodeInfo[opcode].size;
+
+        if (((address & 0xFF) + size) > 0x100)
+            break;
+
+        u16 operand = (size > 1) ? memory_impl_->Read(address + 1) : 0;
+        operand |= (size > 2) ? (memory_impl_->Read(address + 2) << 8) : 0;
+        u16 next = address + size;
+
+        if (JITIsTerminator(opcode))
+        {
+            count++;
+            JITEmitTerminator(&assembler, opcode, operand, next, t_states, count, block->address, loop_start);
+            terminated = true;
+            break;
+        }
+
+        bool access = false;
+
+        if (!JITEmitInstruction(&assembler, opcode, operand, t_states, read, write, &access))
+            break;
+
+        count++;
+        last_t_states = kOPCodeInfo[opcode].t_states;
+        t_states += last_t_states;
+        address = next;
+
+        if (access)
+        {
+            assembler.CompareZero8(kJITContextExit);
+            exit_jumps[exit_count] = assembler.EmitJumpNotZero32();
+            exit_pc[exit_count] = next;
+            exit_t_states[exit_count] = t_states;
+            exit_instructions[exit_count] = count;
+            exit_count++;
+        }
+    }
+
+    // A lone instruction costs more through a block than interpreted,
+    // unless single instruction blocks were asked for
+    if ((count == 0) || ((count < 2) && !terminated && (jit_max_block_instructions_ > 1)))
+    {
+        jit_code_->EndWrite();
+        block->state = kJITBlockFailed;
+        return;
+    }
+
+    if (terminated)
+    {
+        block->prefix_t_states = t_states;
+    }
+    else
+    {
+        JITEmitExit(&assembler, address, t_states, count);
+        block->prefix_t_states = t_states - last_t_states;
+    }
+
+    // The exit after the last instruction is the same as the end of the
+    // block, but a separate stub keeps the translation simple
+    for (int i = 0; i < exit_count; i++)
+    {
+        assembler.Patch32(exit_jumps[i], assembler.GetCursor());
+        JITEmitExit(&assembler, exit_pc[i], exit_t_states[i], exit_instructions[i]);
+    }
+
+    jit_code_->Commit(assembler.GetCursor());
+
+    if (!jit_code_->EndWrite())
+    {
+        block->state = kJITBlockFailed;
+        return;
+    }
+
+    block->function = reinterpret_cast<JITBlockFunction>(start);
+    block->state = kJITBlockCompiled;
+    jit_stats_.blocks_compiled++;
+}
+
+#endif // G6502_JIT_X64
+
+// Keeps GetElapsedTStates() exact for the bus while a block runs
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::JITBeginAccess(u32 t_states)
+{
+    run_t_states_ = jit_run_start_ + jit_extra_t_states_ + jit_context_.base_t_states + t_states;
+}
+
+// The block stops after this instruction when the access stalled the CPU
+// (DMA), changed the run target, raised an interrupt or switched the bank
+// the block was compiled from
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::JITEndAccess(u32 t_states)
+{
+    unsigned int expected = jit_run_start_ + jit_extra_t_states_ + jit_context_.base_t_states + t_states;
+
+    if (run_t_states_ != expected)
+    {
+        jit_extra_t_states_ += run_t_states_ - expected;
+        jit_context_.exit = 1;
+    }
+
+    if ((run_target_ != jit_run_target_) || jit_map_changed_ || nmi_interrupt_requested_ || (interrupt_asserted_ && ((jit_context_.p & FLAG_IRQ) == 0)))
+    {
+        jit_context_.exit = 1;
+    }
+}
+
+template <class MemoryImpl>
+u32 G6502<MemoryImpl>::JITRead(G6502* processor, u32 address, u32, u32 t_states)
+{
+    processor->JITBeginAccess(t_states);
+    u8 value = processor->Read(static_cast<u16>(address));
+    processor->JITEndAccess(t_states);
+    return value;
+}
+
+template <class MemoryImpl>
+void G6502<MemoryImpl>::JITWrite(G6502* processor, u32 address, u32 value, u32 t_states)
+{
+    processor->JITBeginAccess(t_states);
+    processor->Write(static_cast<u16>(address), static_cast<u8>(value));
+    processor->JITEndAccess(t_states);
+}
+
+} // namespace g6502
+
+#endif // G6502_JIT_INL_H_
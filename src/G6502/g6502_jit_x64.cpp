@@ -0,0 +1,376 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "g6502_jit_x64.h"
+#include "g6502_opcode_table.h"
+
+#ifdef G6502_JIT_X64
+
+#include <sys/mman.h>
+
+namespace g6502
+{
+
+JITCodeBuffer::JITCodeBuffer()
+{
+    memory_ = nullptr;
+    size_ = 0;
+    used_ = 0;
+}
+
+JITCodeBuffer::~JITCodeBuffer()
+{
+    if (memory_ != nullptr)
+    {
+        munmap(memory_, size_);
+    }
+}
+
+bool JITCodeBuffer::Init(int size)
+{
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+
+    memory_ = static_cast<u8*>(memory);
+    size_ = size;
+    used_ = 0;
+
+    return EndWrite();
+}
+
+void JITCodeBuffer::Flush()
+{
+    used_ = 0;
+}
+
+bool JITCodeBuffer::BeginWrite()
+{
+    return mprotect(memory_, size_, PROT_READ | PROT_WRITE) == 0;
+}
+
+bool JITCodeBuffer::EndWrite()
+{
+    return mprotect(memory_, size_, PROT_READ | PROT_EXEC) == 0;
+}
+
+static void EmitRead(JITAssembler* assembler, const void* read, u16 address, u32 t_states, bool* access)
+{
+    assembler->Call(read, address, false, 0, 0, t_states);
+    *access = true;
+}
+
+static void EmitWrite(JITAssembler* assembler, const void* write, u16 address, int field, u32 t_states, bool* access)
+{
+    assembler->Call(write, address, true, field, 0, t_states);
+    *access = true;
+}
+
+// Zero page indexed wraps in the zero page; absolute indexed stores take
+// no extra cycle on a page cross, so both have fixed timing
+
+static void EmitIndexedRead(JITAssembler* assembler, const void* read, int index, u16 base, u32 mask, u32 t_states, bool* access)
+{
+    assembler->IndexedAddress(index, base, mask);
+    assembler->CallWithAddress(read, false, 0, 0, t_states);
+    *access = true;
+}
+
+static void EmitIndexedWrite(JITAssembler* assembler, const void* write, int index, u16 base, u32 mask, int field, u32 t_states, bool* access)
+{
+    assembler->IndexedAddress(index, base, mask);
+    assembler->CallWithAddress(write, true, field, 0, t_states);
+    *access = true;
+}
+
+// Value in al for all of these
+
+static void EmitLoad(JITAssembler* assembler, int field)
+{
+    assembler->StoreAL(field);
+    assembler->UpdateNZ();
+}
+
+static void EmitLogic(JITAssembler* assembler, u8 operation)
+{
+    // and / or / xor al, [rbx+A]
+    assembler->Emit8(operation);
+    assembler->Emit8(0x43);
+    assembler->Emit8(kJITContextA);
+    EmitLoad(assembler, kJITContextA);
+}
+
+static void EmitCompare(JITAssembler* assembler, int field)
+{
+    assembler->Emit8(0x88); assembler->Emit8(0xC2);                     // mov dl, al
+    assembler->LoadAL(field);
+    assembler->Emit8(0x28); assembler->Emit8(0xD0);                     // sub al, dl
+    assembler->UpdateCarryFromCF(true);
+    assembler->UpdateNZ();
+}
+
+static void EmitAddWithCarry(JITAssembler* assembler, bool subtract)
+{
+    assembler->Emit8(0x88); assembler->Emit8(0xC2);                     // mov dl, al
+    if (subtract)
+    {
+        // A - v - borrow is A + ~v + carry
+        assembler->Emit8(0x80); assembler->Emit8(0xF2); assembler->Emit8(0xFF); // xor dl, 0xFF
+    }
+    assembler->Emit8(0x0F); assembler->Emit8(0xB6); assembler->Emit8(0xD2);   // movzx edx, dl
+    assembler->Emit8(0x0F); assembler->Emit8(0xB6); assembler->Emit8(0x43); assembler->Emit8(kJITContextA); // movzx eax, A
+    assembler->Emit8(0x0F); assembler->Emit8(0xB6); assembler->Emit8(0x4B); assembler->Emit8(kJITContextP); // movzx ecx, P
+    assembler->Emit8(0x83); assembler->Emit8(0xE1); assembler->Emit8(0x01);   // and ecx, 1
+    assembler->Emit8(0x01); assembler->Emit8(0xC1);                     // add ecx, eax
+    assembler->Emit8(0x01); assembler->Emit8(0xD1);                     // add ecx, edx
+    // V = ~(A ^ v) & (A ^ sum) & 0x80, moved to bit 6
+    assembler->Emit8(0x31); assembler->Emit8(0xC2);                     // xor edx, eax
+    assembler->Emit8(0xF7); assembler->Emit8(0xD2);                     // not edx
+    assembler->Emit8(0x31); assembler->Emit8(0xC8);                     // xor eax, ecx
+    assembler->Emit8(0x21); assembler->Emit8(0xC2);                     // and edx, eax
+    assembler->Emit8(0x81); assembler->Emit8(0xE2); assembler->Emit32(0x80); // and edx, 0x80
+    assembler->Emit8(0xD1); assembler->Emit8(0xEA);                     // shr edx, 1
+    // C = bit 8 of the sum
+    assembler->Emit8(0x89); assembler->Emit8(0xC8);                     // mov eax, ecx
+    assembler->Emit8(0xC1); assembler->Emit8(0xE8); assembler->Emit8(0x08);   // shr eax, 8
+    assembler->Emit8(0x09); assembler->Emit8(0xC2);                     // or edx, eax
+    assembler->Emit8(0x88); assembler->Emit8(0x4B); assembler->Emit8(kJITContextA); // mov [A], cl
+    assembler->AndImmediate8(kJITContextP, 0xBE);
+    assembler->OrDL(kJITContextP);
+    assembler->Emit8(0x88); assembler->Emit8(0xC8);                     // mov al, cl
+    assembler->UpdateNZ();
+}
+
+static void EmitBit(JITAssembler* assembler)
+{
+    assembler->Emit8(0x88); assembler->Emit8(0xC2);                     // mov dl, al
+    assembler->Emit8(0x80); assembler->Emit8(0xE2); assembler->Emit8(0xC0);   // and dl, 0xC0
+    assembler->Emit8(0x22); assembler->Emit8(0x43); assembler->Emit8(kJITContextA); // and al, [A]
+    assembler->Emit8(0x0F); assembler->Emit8(0x94); assembler->Emit8(0xC1);   // setz cl
+    assembler->Emit8(0xD0); assembler->Emit8(0xE1);                     // shl cl, 1
+    assembler->Emit8(0x08); assembler->Emit8(0xCA);                     // or dl, cl
+    assembler->AndImmediate8(kJITContextP, 0x3D);
+    assembler->OrDL(kJITContextP);
+}
+
+static void EmitIncrement(JITAssembler* assembler, int field, bool decrement)
+{
+    assembler->LoadAL(field);
+    assembler->Emit8(0xFE); assembler->Emit8(decrement ? 0xC8 : 0xC0);  // dec / inc al
+    EmitLoad(assembler, field);
+}
+
+static void EmitTransfer(JITAssembler* assembler, int from, int to)
+{
+    assembler->LoadAL(from);
+    EmitLoad(assembler, to);
+}
+
+static void EmitShift(JITAssembler* assembler, u8 operation, bool rotate)
+{
+    if (rotate)
+    {
+        assembler->LoadDL(kJITContextP);
+        assembler->Emit8(0xD0); assembler->Emit8(0xEA);                 // shr dl, 1 (carry to CF)
+    }
+    assembler->LoadAL(kJITContextA);
+    assembler->Emit8(0xD0); assembler->Emit8(operation);                // shl / shr / rcl / rcr al, 1
+    assembler->UpdateCarryFromCF(false);
+    EmitLoad(assembler, kJITContextA);
+}
+
+// index < 0 for plain zero page and absolute
+static void EmitReadModifyWrite(JITAssembler* assembler, const void* read, const void* write, int index, u16 address, u32 t_states, bool decrement, bool* access)
+{
+    if (index < 0)
+        EmitRead(assembler, read, address, t_states, access);
+    else
+        EmitIndexedRead(assembler, read, index, address, 0xFF, t_states, access);
+
+    assembler->Emit8(0xFE); assembler->Emit8(decrement ? 0xC8 : 0xC0);  // dec / inc al
+    assembler->StoreAL(kJITContextTemp);
+
+    // esi did not survive the read
+    if (index < 0)
+        EmitWrite(assembler, write, address, kJITContextTemp, t_states, access);
+    else
+        EmitIndexedWrite(assembler, write, index, address, 0xFF, kJITContextTemp, t_states, access);
+
+    assembler->LoadAL(kJITContextTemp);
+    assembler->UpdateNZ();
+}
+
+bool JITEmitInstruction(JITAssembler* assembler, u8 opcode, u16 operand, u32 t_states, const void* read, const void* write, bool* access)
+{
+    u8 immediate = operand & 0xFF;
+    // Zero page operands are one byte, so operand already is the address
+    u16 address = operand;
+
+    switch (opcode)
+    {
+        // Implied
+        case 0xAA: EmitTransfer(assembler, kJITContextA, kJITContextX); break;
+        case 0xA8: EmitTransfer(assembler, kJITContextA, kJITContextY); break;
+        case 0x8A: EmitTransfer(assembler, kJITContextX, kJITContextA); break;
+        case 0x98: EmitTransfer(assembler, kJITContextY, kJITContextA); break;
+        case 0xBA: EmitTransfer(assembler, kJITContextS, kJITContextX); break;
+        // Same flags as the interpreter's TXS
+        case 0x9A: EmitTransfer(assembler, kJITContextX, kJITContextS); break;
+        case 0xE8: EmitIncrement(assembler, kJITContextX, false); break;
+        case 0xC8: EmitIncrement(assembler, kJITContextY, false); break;
+        case 0xCA: EmitIncrement(assembler, kJITContextX, true); break;
+        case 0x88: EmitIncrement(assembler, kJITContextY, true); break;
+        case 0x18: assembler->AndImmediate8(kJITContextP, static_cast<u8>(~FLAG_CARRY)); break;
+        case 0x38: assembler->OrImmediate8(kJITContextP, FLAG_CARRY); break;
+        case 0xD8: assembler->AndImmediate8(kJITContextP, static_cast<u8>(~FLAG_DECIMAL)); break;
+        case 0xF8: assembler->OrImmediate8(kJITContextP, FLAG_DECIMAL); break;
+        case 0xB8: assembler->AndImmediate8(kJITContextP, static_cast<u8>(~FLAG_OVERFLOW)); break;
+        case 0xEA: break;
+        case 0x0A: EmitShift(assembler, 0xE0, false); break;
+        case 0x4A: EmitShift(assembler, 0xE8, false); break;
+        case 0x2A: EmitShift(assembler, 0xD0, true); break;
+        case 0x6A: EmitShift(assembler, 0xD8, true); break;
+
+        // Immediate
+        case 0xA9: assembler->MoveALImmediate(immediate); EmitLoad(assembler, kJITContextA); break;
+        case 0xA2: assembler->MoveALImmediate(immediate); EmitLoad(assembler, kJITContextX); break;
+        case 0xA0: assembler->MoveALImmediate(immediate); EmitLoad(assembler, kJITContextY); break;
+        case 0x29: assembler->MoveALImmediate(immediate); EmitLogic(assembler, 0x22); break;
+        case 0x09: assembler->MoveALImmediate(immediate); EmitLogic(assembler, 0x0A); break;
+        case 0x49: assembler->MoveALImmediate(immediate); EmitLogic(assembler, 0x32); break;
+        case 0xC9: assembler->MoveALImmediate(immediate); EmitCompare(assembler, kJITContextA); break;
+        case 0xE0: assembler->MoveALImmediate(immediate); EmitCompare(assembler, kJITContextX); break;
+        case 0xC0: assembler->MoveALImmediate(immediate); EmitCompare(assembler, kJITContextY); break;
+        case 0x69: assembler->MoveALImmediate(immediate); EmitAddWithCarry(assembler, false); break;
+        case 0xE9: assembler->MoveALImmediate(immediate); EmitAddWithCarry(assembler, true); break;
+
+        // Zero page and absolute reads
+        case 0xA5: case 0xAD: EmitRead(assembler, read, address, t_states, access); EmitLoad(assembler, kJITContextA); break;
+        case 0xA6: case 0xAE: EmitRead(assembler, read, address, t_states, access); EmitLoad(assembler, kJITContextX); break;
+        case 0xA4: case 0xAC: EmitRead(assembler, read, address, t_states, access); EmitLoad(assembler, kJITContextY); break;
+        case 0x25: case 0x2D: EmitRead(assembler, read, address, t_states, access); EmitLogic(assembler, 0x22); break;
+        case 0x05: case 0x0D: EmitRead(assembler, read, address, t_states, access); EmitLogic(assembler, 0x0A); break;
+        case 0x45: case 0x4D: EmitRead(assembler, read, address, t_states, access); EmitLogic(assembler, 0x32); break;
+        case 0xC5: case 0xCD: EmitRead(assembler, read, address, t_states, access); EmitCompare(assembler, kJITContextA); break;
+        case 0xE4: case 0xEC: EmitRead(assembler, read, address, t_states, access); EmitCompare(assembler, kJITContextX); break;
+        case 0xC4: case 0xCC: EmitRead(assembler, read, address, t_states, access); EmitCompare(assembler, kJITContextY); break;
+        case 0x65: case 0x6D: EmitRead(assembler, read, address, t_states, access); EmitAddWithCarry(assembler, false); break;
+        case 0xE5: case 0xED: EmitRead(assembler, read, address, t_states, access); EmitAddWithCarry(assembler, true); break;
+        case 0x24: case 0x2C: EmitRead(assembler, read, address, t_states, access); EmitBit(assembler); break;
+
+        // Zero page and absolute writes
+        case 0x85: case 0x8D: EmitWrite(assembler, write, address, kJITContextA, t_states, access); break;
+        case 0x86: case 0x8E: EmitWrite(assembler, write, address, kJITContextX, t_states, access); break;
+        case 0x84: case 0x8C: EmitWrite(assembler, write, address, kJITContextY, t_states, access); break;
+        case 0xE6: case 0xEE: EmitReadModifyWrite(assembler, read, write, -1, address, t_states, false, access); break;
+        case 0xC6: case 0xCE: EmitReadModifyWrite(assembler, read, write, -1, address, t_states, true, access); break;
+
+        // Zero page indexed reads
+        case 0xB5: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitLoad(assembler, kJITContextA); break;
+        case 0xB6: EmitIndexedRead(assembler, read, kJITContextY, address, 0xFF, t_states, access); EmitLoad(assembler, kJITContextX); break;
+        case 0xB4: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitLoad(assembler, kJITContextY); break;
+        case 0x35: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitLogic(assembler, 0x22); break;
+        case 0x15: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitLogic(assembler, 0x0A); break;
+        case 0x55: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitLogic(assembler, 0x32); break;
+        case 0xD5: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitCompare(assembler, kJITContextA); break;
+        case 0x75: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitAddWithCarry(assembler, false); break;
+        case 0xF5: EmitIndexedRead(assembler, read, kJITContextX, address, 0xFF, t_states, access); EmitAddWithCarry(assembler, true); break;
+
+        // Indexed writes
+        case 0x95: EmitIndexedWrite(assembler, write, kJITContextX, address, 0xFF, kJITContextA, t_states, access); break;
+        case 0x96: EmitIndexedWrite(assembler, write, kJITContextY, address, 0xFF, kJITContextX, t_states, access); break;
+        case 0x94: EmitIndexedWrite(assembler, write, kJITContextX, address, 0xFF, kJITContextY, t_states, access); break;
+        case 0x9D: EmitIndexedWrite(assembler, write, kJITContextX, address, 0xFFFF, kJITContextA, t_states, access); break;
+        case 0x99: EmitIndexedWrite(assembler, write, kJITContextY, address, 0xFFFF, kJITContextA, t_states, access); break;
+        case 0xF6: EmitReadModifyWrite(assembler, read, write, kJITContextX, address, t_states, false, access); break;
+        case 0xD6: EmitReadModifyWrite(assembler, read, write, kJITContextX, address, t_states, true, access); break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+bool JITIsTerminator(u8 opcode)
+{
+    return ((opcode & 0x1F) == 0x10) || (opcode == 0x4C);
+}
+
+void JITEmitExit(JITAssembler* assembler, u16 pc, u32 t_states, u8 instructions)
+{
+    assembler->StoreImmediate16(kJITContextPC, pc);
+    assembler->StoreImmediate32(kJITContextTStates, t_states);
+    assembler->StoreImmediate8(kJITContextInstructions, instructions);
+    assembler->Epilogue();
+}
+
+// Exit or loop to the start of the block
+static void EmitJump(JITAssembler* assembler, u16 target, u32 t_states, u8 instructions, u16 block_address, u8* loop_start, u32 prefix_t_states)
+{
+    if (target == block_address)
+    {
+        assembler->AddImmediate32(kJITContextBaseTStates, t_states);
+        assembler->AddImmediate32(kJITContextBaseInstructions, instructions);
+        // Same check the dispatcher makes before entering the block
+        assembler->LoadEAX(kJITContextBaseTStates);
+        assembler->AddEAXImmediate(prefix_t_states);
+        assembler->CompareEAX(kJITContextBudget);
+        assembler->EmitJumpBelow32(loop_start);
+        JITEmitExit(assembler, target, 0, 0);
+    }
+    else
+    {
+        JITEmitExit(assembler, target, t_states, instructions);
+    }
+}
+
+void JITEmitTerminator(JITAssembler* assembler, u8 opcode, u16 operand, u16 next, u32 t_states, u8 instructions, u16 block_address, u8* loop_start)
+{
+    u32 cycles = kOPCodeInfo[opcode].t_states;
+
+    if (opcode == 0x4C)
+    {
+        EmitJump(assembler, operand, t_states + cycles, instructions, block_address, loop_start, t_states);
+        return;
+    }
+
+    // Bits 7-6 pick the flag (N, V, C, Z), bit 5 the value that branches
+    static const u8 kBranchFlags[4] = { FLAG_NEGATIVE, FLAG_OVERFLOW, FLAG_CARRY, FLAG_ZERO };
+    u8 flag = kBranchFlags[opcode >> 6];
+    bool branch_if_set = (opcode & 0x20) != 0;
+    u16 target = static_cast<u16>(next + static_cast<s8>(operand & 0xFF));
+    u32 taken_cycles = cycles + 1 + (((next ^ target) > 0x00FF) ? kOPCodeInfo[opcode].page_cross_t_states : 0);
+
+    assembler->TestImmediate8(kJITContextP, flag);
+    assembler->Emit8(branch_if_set ? 0x75 : 0x74);                      // jnz / jz taken
+    u8* rel = assembler->GetCursor();
+    assembler->Emit8(0);
+
+    JITEmitExit(assembler, next, t_states + cycles, instructions);
+    *rel = static_cast<u8>(assembler->GetCursor() - (rel + 1));
+    EmitJump(assembler, target, t_states + taken_cycles, instructions, block_address, loop_start, t_states);
+}
+
+} // namespace g6502
+
+#endif // G6502_JIT_X64
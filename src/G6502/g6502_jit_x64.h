@@ -0,0 +1,260 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_JIT_X64_H_
+#define	G6502_JIT_X64_H_
+
+#include <cstddef>
+#include "g6502_definitions.h"
+
+namespace g6502
+{
+
+// CPU state seen by translated blocks, which address it through rbx
+struct stJITContext
+{
+    u8 a;
+    u8 x;
+    u8 y;
+    u8 s;
+    u8 p;
+    u8 temp;
+    u16 pc;
+    u32 t_states;
+    // Set by memory accesses that need the block to stop after the
+    // current instruction
+    u8 exit;
+    u8 instructions;
+    // Blocks that branch back to their own start loop natively while the
+    // iterations fit in budget, and add each one to the base counters
+    u32 base_t_states;
+    u32 base_instructions;
+    u32 budget;
+};
+
+const int kJITContextA = offsetof(stJITContext, a);
+const int kJITContextX = offsetof(stJITContext, x);
+const int kJITContextY = offsetof(stJITContext, y);
+const int kJITContextS = offsetof(stJITContext, s);
+const int kJITContextP = offsetof(stJITContext, p);
+const int kJITContextTemp = offsetof(stJITContext, temp);
+const int kJITContextPC = offsetof(stJITContext, pc);
+const int kJITContextTStates = offsetof(stJITContext, t_states);
+const int kJITContextExit = offsetof(stJITContext, exit);
+const int kJITContextInstructions = offsetof(stJITContext, instructions);
+const int kJITContextBaseTStates = offsetof(stJITContext, base_t_states);
+const int kJITContextBaseInstructions = offsetof(stJITContext, base_instructions);
+const int kJITContextBudget = offsetof(stJITContext, budget);
+
+typedef void (*JITBlockFunction)(stJITContext* context, void* processor);
+
+struct stJITStats
+{
+    u64 blocks_compiled;
+    u64 block_runs;
+    // Blocks that stopped early after a memory access with side effects
+    u64 early_exits;
+    u64 jit_instructions;
+    u64 interpreted_instructions;
+    u64 flushes;
+};
+
+#ifdef G6502_JIT_X64
+
+// Executable memory the blocks are written to, one bump allocation per
+// block and a full flush when it runs out. It is never writable and
+// executable at once: blocks are emitted between BeginWrite() and
+// EndWrite().
+class JITCodeBuffer
+{
+public:
+    JITCodeBuffer();
+    ~JITCodeBuffer();
+    bool Init(int size);
+    void Flush();
+    bool BeginWrite();
+    bool EndWrite();
+    u8* GetCursor() const;
+    int GetFree() const;
+    void Commit(u8* end);
+
+private:
+    u8* memory_;
+    int size_;
+    int used_;
+};
+
+inline u8* JITCodeBuffer::GetCursor() const
+{
+    return memory_ + used_;
+}
+
+inline int JITCodeBuffer::GetFree() const
+{
+    return size_ - used_;
+}
+
+inline void JITCodeBuffer::Commit(u8* end)
+{
+    used_ = static_cast<int>(end - memory_);
+}
+
+// Raw x86-64 encoder with the handful of forms the translator needs.
+// Context fields are byte operands at [rbx + disp8].
+class JITAssembler
+{
+public:
+    JITAssembler(u8* code) : start_(code), cursor_(code) { }
+    u8* GetCursor() const { return cursor_; }
+    int GetSize() const { return static_cast<int>(cursor_ - start_); }
+
+    void Emit8(u8 value) { *cursor_++ = value; }
+    void Emit16(u16 value) { Emit8(value & 0xFF); Emit8(value >> 8); }
+    void Emit32(u32 value) { Emit16(value & 0xFFFF); Emit16(value >> 16); }
+    void Emit64(u64 value) { Emit32(value & 0xFFFFFFFF); Emit32(value >> 32); }
+
+    // Returns the position of a rel32 to patch
+    u8* EmitJumpNotZero32() { Emit8(0x0F); Emit8(0x85); u8* rel = cursor_; Emit32(0); return rel; }
+    void EmitJumpBelow32(u8* target) { Emit8(0x0F); Emit8(0x82); u8* rel = cursor_; Emit32(0); Patch32(rel, target); }
+    void Patch32(u8* rel, u8* target) { s32 offset = static_cast<s32>(target - (rel + 4)); for (int i = 0; i < 4; i++) rel[i] = static_cast<u8>(offset >> (i * 8)); }
+
+    // add dword [rbx+d], imm32 / mov eax, [rbx+d] / add eax, imm32 / cmp eax, [rbx+d]
+    void AddImmediate32(int field, u32 value) { Emit8(0x81); Emit8(0x43); Emit8(field); Emit32(value); }
+    void LoadEAX(int field) { Emit8(0x8B); Emit8(0x43); Emit8(field); }
+    void AddEAXImmediate(u32 value) { Emit8(0x05); Emit32(value); }
+    void CompareEAX(int field) { Emit8(0x3B); Emit8(0x43); Emit8(field); }
+
+    // mov al, [rbx+d] / mov [rbx+d], al
+    void LoadAL(int field) { Emit8(0x8A); Emit8(0x43); Emit8(field); }
+    void StoreAL(int field) { Emit8(0x88); Emit8(0x43); Emit8(field); }
+    // mov dl, [rbx+d] / mov [rbx+d], dl
+    void LoadDL(int field) { Emit8(0x8A); Emit8(0x53); Emit8(field); }
+    // mov al, imm8
+    void MoveALImmediate(u8 value) { Emit8(0xB0); Emit8(value); }
+    // mov byte [rbx+d], imm8
+    void StoreImmediate8(int field, u8 value) { Emit8(0xC6); Emit8(0x43); Emit8(field); Emit8(value); }
+    // mov word [rbx+d], imm16
+    void StoreImmediate16(int field, u16 value) { Emit8(0x66); Emit8(0xC7); Emit8(0x43); Emit8(field); Emit16(value); }
+    // mov dword [rbx+d], imm32
+    void StoreImmediate32(int field, u32 value) { Emit8(0xC7); Emit8(0x43); Emit8(field); Emit32(value); }
+    // and / or byte [rbx+d], imm8
+    void AndImmediate8(int field, u8 value) { Emit8(0x80); Emit8(0x63); Emit8(field); Emit8(value); }
+    void OrImmediate8(int field, u8 value) { Emit8(0x80); Emit8(0x4B); Emit8(field); Emit8(value); }
+    // or [rbx+d], dl
+    void OrDL(int field) { Emit8(0x08); Emit8(0x53); Emit8(field); }
+    // test byte [rbx+d], imm8
+    void TestImmediate8(int field, u8 value) { Emit8(0xF6); Emit8(0x43); Emit8(field); Emit8(value); }
+    // cmp byte [rbx+d], 0
+    void CompareZero8(int field) { Emit8(0x80); Emit8(0x7B); Emit8(field); Emit8(0x00); }
+
+    // Sets N and Z in the context P from al, through the table in r13.
+    // Leaves al alone, clobbers ecx.
+    void UpdateNZ()
+    {
+        Emit8(0x0F); Emit8(0xB6); Emit8(0xC8);                          // movzx ecx, al
+        Emit8(0x41); Emit8(0x8A); Emit8(0x4C); Emit8(0x0D); Emit8(0x00); // mov cl, [r13+rcx]
+        AndImmediate8(kJITContextP, 0x7D);
+        Emit8(0x08); Emit8(0x4B); Emit8(kJITContextP);                  // or [rbx+P], cl
+    }
+
+    // Stores CF, inverted for the 6502 borrow when requested, as the carry
+    void UpdateCarryFromCF(bool borrow)
+    {
+        Emit8(0x0F); Emit8(borrow ? 0x93 : 0x92); Emit8(0xC2);          // setae / setc dl
+        AndImmediate8(kJITContextP, 0xFE);
+        OrDL(kJITContextP);
+    }
+
+    // push rbx, r12, r13; rbx = context, r12 = processor, r13 = NZ table
+    void Prologue(const u8* nz_table)
+    {
+        Emit8(0x53);
+        Emit8(0x41); Emit8(0x54);
+        Emit8(0x41); Emit8(0x55);
+        Emit8(0x48); Emit8(0x89); Emit8(0xFB);                          // mov rbx, rdi
+        Emit8(0x49); Emit8(0x89); Emit8(0xF4);                          // mov r12, rsi
+        Emit8(0x49); Emit8(0xBD); Emit64(reinterpret_cast<u64>(nz_table)); // mov r13, imm64
+    }
+
+    void Epilogue()
+    {
+        Emit8(0x41); Emit8(0x5D);
+        Emit8(0x41); Emit8(0x5C);
+        Emit8(0x5B);
+        Emit8(0xC3);
+    }
+
+    // esi = (index register + base) & mask, the effective address of the
+    // indexed modes
+    void IndexedAddress(int field, u16 base, u32 mask)
+    {
+        Emit8(0x0F); Emit8(0xB6); Emit8(0x73); Emit8(field);            // movzx esi, byte [rbx+d]
+        Emit8(0x81); Emit8(0xC6); Emit32(base);                         // add esi, imm32
+        Emit8(0x81); Emit8(0xE6); Emit32(mask);                         // and esi, imm32
+    }
+
+    // function(processor, esi, edx, ecx)
+    void Call(const void* function, u32 esi, bool edx_from_context, int edx_field, u32 edx, u32 ecx)
+    {
+        Emit8(0xBE); Emit32(esi);                                       // mov esi, imm32
+        CallWithAddress(function, edx_from_context, edx_field, edx, ecx);
+    }
+
+    // Same, esi already set
+    void CallWithAddress(const void* function, bool edx_from_context, int edx_field, u32 edx, u32 ecx)
+    {
+        Emit8(0x4C); Emit8(0x89); Emit8(0xE7);                          // mov rdi, r12
+        if (edx_from_context)
+        {
+            Emit8(0x0F); Emit8(0xB6); Emit8(0x53); Emit8(edx_field);    // movzx edx, byte [rbx+d]
+        }
+        else
+        {
+            Emit8(0xBA); Emit32(edx);                                   // mov edx, imm32
+        }
+        Emit8(0xB9); Emit32(ecx);                                       // mov ecx, imm32
+        Emit8(0x48); Emit8(0xB8); Emit64(reinterpret_cast<u64>(function)); // mov rax, imm64
+        Emit8(0xFF); Emit8(0xD0);                                       // call rax
+    }
+
+private:
+    u8* start_;
+    u8* cursor_;
+};
+
+// Translation of one instruction. read is u32 (*)(processor, address,
+// unused, t_states) and write void (*)(processor, address, value,
+// t_states), t_states being the block T-states before the instruction.
+// Sets access when the instruction went to the bus.
+bool JITEmitInstruction(JITAssembler* assembler, u8 opcode, u16 operand, u32 t_states, const void* read, const void* write, bool* access);
+
+// Instructions that end a block (branches, JMP). A jump back to
+// block_address goes to loop_start when there is budget for one more
+// iteration.
+bool JITIsTerminator(u8 opcode);
+void JITEmitTerminator(JITAssembler* assembler, u8 opcode, u16 operand, u16 next, u32 t_states, u8 instructions, u16 block_address, u8* loop_start);
+
+// Leaves the block with PC, T-states and instruction count in the context
+void JITEmitExit(JITAssembler* assembler, u16 pc, u32 t_states, u8 instructions);
+
+#endif // G6502_JIT_X64
+
+} // namespace g6502
+
+#endif // G6502_JIT_X64_H_
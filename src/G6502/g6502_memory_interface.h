@@ -24,6 +24,9 @@
 
 namespace g6502
 {
+
+// GetIdleReadLimit() for memory that only the CPU can change
+const unsigned int kIdleReadUnlimited = 0xFFFFFFFF;
     
 class MemoryInterface
 {
@@ -34,6 +37,19 @@ public:
     virtual void Write(u16 address, u8 value) = 0;
     virtual void Disassemble(u16 address, const char* disassembled_string) = 0;
     virtual bool IsDisassembled(u16 address) = 0;
+    // Bank that holds the code at address when it is read-only and can be
+    // decoded once (PRG-ROM), -1 otherwise
+    virtual int GetCodeBank(u16 address) { (void)address; return -1; }
+    // T-states from now during which reading address keeps returning the
+    // same value with no side effects, 0 when that can't be promised
+    virtual unsigned int GetIdleReadLimit(u16 address) { (void)address; return 0; }
+    // Memory behind $0000-$01FF when it is plain RAM, so zero page and
+    // stack accesses can skip Read() and Write(). nullptr otherwise.
+    virtual u8* GetRAMPages() { return nullptr; }
+    // The 256 byte page holding address when reading it has no side
+    // effects, nullptr otherwise. Remapping a page must be followed by
+    // G6502::InvalidateFetchPage().
+    virtual const u8* GetReadPage(u16 address) { (void)address; return nullptr; }
 };
 
 } // namespace g6502
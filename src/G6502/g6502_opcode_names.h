@@ -20,14 +20,15 @@
 #ifndef G6502_OPCODENAMES_H_
 #define	G6502_OPCODENAMES_H_
 
+#include <cstdio>
 #include "g6502_definitions.h"
 
 namespace g6502
 {
 
-#ifdef G6502_DISASM
-
-static const char* kOPCodeNames[256] = {
+// Operands as %1 (low byte), %2 (high byte) and %3 (branch target), see
+// FormatOPCode()
+static const char* const kOPCodeNames[256] = {
     "BRK",
     "ORA $(%2%1,X)",
     "KIL",
@@ -301,7 +302,40 @@ static const char* kOPCodeNames[256] = {
     "ISC $%2%1,X"
 };
 
-#endif
+// kOPCodeNames[opcode] for the instruction at address, with its operand
+// bytes filled in or shown as ?? when operands is nullptr
+inline void FormatOPCode(char* buffer, int size, u16 address, u8 opcode, const u8* operands)
+{
+    const char* name = kOPCodeNames[opcode];
+    int length = 0;
+
+    for (int i = 0; (name[i] != 0) && (length < size - 5); i++)
+    {
+        if ((name[i] != '%') || (name[i + 1] < '1') || (name[i + 1] > '3'))
+        {
+            buffer[length++] = name[i];
+            continue;
+        }
+
+        i++;
+
+        if (operands == nullptr)
+        {
+            length += snprintf(buffer + length, size - length, (name[i] == '3') ? "????" : "??");
+        }
+        else if (name[i] == '3')
+        {
+            u16 target = static_cast<u16>(address + 2 + static_cast<s8>(operands[0]));
+            length += snprintf(buffer + length, size - length, "%04X", target);
+        }
+        else
+        {
+            length += snprintf(buffer + length, size - length, "%02X", operands[name[i] - '1']);
+        }
+    }
+
+    buffer[length] = 0;
+}
 
 } // namespace g6502
 
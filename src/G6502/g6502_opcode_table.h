@@ -0,0 +1,409 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_OPCODE_TABLE_H_
+#define	G6502_OPCODE_TABLE_H_
+
+#include "g6502_types.h"
+
+// X(opcode, operation, addressing mode, T-states, page cross T-states)
+// Every opcode has a row, unofficial ones included. Each row becomes an
+// Instruction<Op##operation, Mode##mode>() instantiation in the dispatch
+// loops. Branches charge the page cross T-state only when taken.
+#define G6502_OPCODE_TABLE(X) \
+    X(0x00, BRK, Implied,         7, 0) \
+    X(0x01, ORA, IndexedIndirect, 6, 0) \
+    X(0x02, KIL, Implied,         2, 0) \
+    X(0x03, SLO, IndexedIndirect, 8, 0) \
+    X(0x04, NOP, ZeroPage,        3, 0) \
+    X(0x05, ORA, ZeroPage,        3, 0) \
+    X(0x06, ASL, ZeroPage,        5, 0) \
+    X(0x07, SLO, ZeroPage,        5, 0) \
+    X(0x08, PHP, Implied,         3, 0) \
+    X(0x09, ORA, Immediate,       2, 0) \
+    X(0x0A, ASL, Accumulator,     2, 0) \
+    X(0x0B, ANC, Immediate,       2, 0) \
+    X(0x0C, NOP, Absolute,        4, 0) \
+    X(0x0D, ORA, Absolute,        4, 0) \
+    X(0x0E, ASL, Absolute,        6, 0) \
+    X(0x0F, SLO, Absolute,        6, 0) \
+    X(0x10, BPL, Relative,        2, 1) \
+    X(0x11, ORA, IndirectIndexed, 5, 1) \
+    X(0x12, KIL, Implied,         2, 0) \
+    X(0x13, SLO, IndirectIndexed, 8, 0) \
+    X(0x14, NOP, ZeroPageX,       4, 0) \
+    X(0x15, ORA, ZeroPageX,       4, 0) \
+    X(0x16, ASL, ZeroPageX,       6, 0) \
+    X(0x17, SLO, ZeroPageX,       6, 0) \
+    X(0x18, CLC, Implied,         2, 0) \
+    X(0x19, ORA, AbsoluteY,       4, 1) \
+    X(0x1A, NOP, Implied,         2, 0) \
+    X(0x1B, SLO, AbsoluteY,       7, 0) \
+    X(0x1C, NOP, AbsoluteX,       4, 1) \
+    X(0x1D, ORA, AbsoluteX,       4, 1) \
+    X(0x1E, ASL, AbsoluteX,       7, 0) \
+    X(0x1F, SLO, AbsoluteX,       7, 0) \
+    X(0x20, JSR, Absolute,        6, 0) \
+    X(0x21, AND, IndexedIndirect, 6, 0) \
+    X(0x22, KIL, Implied,         2, 0) \
+    X(0x23, RLA, IndexedIndirect, 8, 0) \
+    X(0x24, BIT, ZeroPage,        3, 0) \
+    X(0x25, AND, ZeroPage,        3, 0) \
+    X(0x26, ROL, ZeroPage,        5, 0) \
+    X(0x27, RLA, ZeroPage,        5, 0) \
+    X(0x28, PLP, Implied,         4, 0) \
+    X(0x29, AND, Immediate,       2, 0) \
+    X(0x2A, ROL, Accumulator,     2, 0) \
+    X(0x2B, ANC, Immediate,       2, 0) \
+    X(0x2C, BIT, Absolute,        4, 0) \
+    X(0x2D, AND, Absolute,        4, 0) \
+    X(0x2E, ROL, Absolute,        6, 0) \
+    X(0x2F, RLA, Absolute,        6, 0) \
+    X(0x30, BMI, Relative,        2, 1) \
+    X(0x31, AND, IndirectIndexed, 5, 1) \
+    X(0x32, KIL, Implied,         2, 0) \
+    X(0x33, RLA, IndirectIndexed, 8, 0) \
+    X(0x34, NOP, ZeroPageX,       4, 0) \
+    X(0x35, AND, ZeroPageX,       4, 0) \
+    X(0x36, ROL, ZeroPageX,       6, 0) \
+    X(0x37, RLA, ZeroPageX,       6, 0) \
+    X(0x38, SEC, Implied,         2, 0) \
+    X(0x39, AND, AbsoluteY,       4, 1) \
+    X(0x3A, NOP, Implied,         2, 0) \
+    X(0x3B, RLA, AbsoluteY,       7, 0) \
+    X(0x3C, NOP, AbsoluteX,       4, 1) \
+    X(0x3D, AND, AbsoluteX,       4, 1) \
+    X(0x3E, ROL, AbsoluteX,       7, 0) \
+    X(0x3F, RLA, AbsoluteX,       7, 0) \
+    X(0x40, RTI, Implied,         6, 0) \
+    X(0x41, EOR, IndexedIndirect, 6, 0) \
+    X(0x42, KIL, Implied,         2, 0) \
+    X(0x43, SRE, IndexedIndirect, 8, 0) \
+    X(0x44, NOP, ZeroPage,        3, 0) \
+    X(0x45, EOR, ZeroPage,        3, 0) \
+    X(0x46, LSR, ZeroPage,        5, 0) \
+    X(0x47, SRE, ZeroPage,        5, 0) \
+    X(0x48, PHA, Implied,         3, 0) \
+    X(0x49, EOR, Immediate,       2, 0) \
+    X(0x4A, LSR, Accumulator,     2, 0) \
+    X(0x4B, ALR, Immediate,       2, 0) \
+    X(0x4C, JMP, Absolute,        3, 0) \
+    X(0x4D, EOR, Absolute,        4, 0) \
+    X(0x4E, LSR, Absolute,        6, 0) \
+    X(0x4F, SRE, Absolute,        6, 0) \
+    X(0x50, BVC, Relative,        2, 1) \
+    X(0x51, EOR, IndirectIndexed, 5, 1) \
+    X(0x52, KIL, Implied,         2, 0) \
+    X(0x53, SRE, IndirectIndexed, 8, 0) \
+    X(0x54, NOP, ZeroPageX,       4, 0) \
+    X(0x55, EOR, ZeroPageX,       4, 0) \
+    X(0x56, LSR, ZeroPageX,       6, 0) \
+    X(0x57, SRE, ZeroPageX,       6, 0) \
+    X(0x58, CLI, Implied,         2, 0) \
+    X(0x59, EOR, AbsoluteY,       4, 1) \
+    X(0x5A, NOP, Implied,         2, 0) \
+    X(0x5B, SRE, AbsoluteY,       7, 0) \
+    X(0x5C, NOP, AbsoluteX,       4, 1) \
+    X(0x5D, EOR, AbsoluteX,       4, 1) \
+    X(0x5E, LSR, AbsoluteX,       7, 0) \
+    X(0x5F, SRE, AbsoluteX,       7, 0) \
+    X(0x60, RTS, Implied,         6, 0) \
+    X(0x61, ADC, IndexedIndirect, 6, 0) \
+    X(0x62, KIL, Implied,         2, 0) \
+    X(0x63, RRA, IndexedIndirect, 8, 0) \
+    X(0x64, NOP, ZeroPage,        3, 0) \
+    X(0x65, ADC, ZeroPage,        3, 0) \
+    X(0x66, ROR, ZeroPage,        5, 0) \
+    X(0x67, RRA, ZeroPage,        5, 0) \
+    X(0x68, PLA, Implied,         4, 0) \
+    X(0x69, ADC, Immediate,       2, 0) \
+    X(0x6A, ROR, Accumulator,     2, 0) \
+    X(0x6B, ARR, Immediate,       2, 0) \
+    X(0x6C, JMP, Indirect,        5, 0) \
+    X(0x6D, ADC, Absolute,        4, 0) \
+    X(0x6E, ROR, Absolute,        6, 0) \
+    X(0x6F, RRA, Absolute,        6, 0) \
+    X(0x70, BVS, Relative,        2, 1) \
+    X(0x71, ADC, IndirectIndexed, 5, 1) \
+    X(0x72, KIL, Implied,         2, 0) \
+    X(0x73, RRA, IndirectIndexed, 8, 0) \
+    X(0x74, NOP, ZeroPageX,       4, 0) \
+    X(0x75, ADC, ZeroPageX,       4, 0) \
+    X(0x76, ROR, ZeroPageX,       6, 0) \
+    X(0x77, RRA, ZeroPageX,       6, 0) \
+    X(0x78, SEI, Implied,         2, 0) \
+    X(0x79, ADC, AbsoluteY,       4, 1) \
+    X(0x7A, NOP, Implied,         2, 0) \
+    X(0x7B, RRA, AbsoluteY,       7, 0) \
+    X(0x7C, NOP, AbsoluteX,       4, 1) \
+    X(0x7D, ADC, AbsoluteX,       4, 1) \
+    X(0x7E, ROR, AbsoluteX,       7, 0) \
+    X(0x7F, RRA, AbsoluteX,       7, 0) \
+    X(0x80, NOP, Immediate,       2, 0) \
+    X(0x81, STA, IndexedIndirect, 6, 0) \
+    X(0x82, NOP, Immediate,       2, 0) \
+    X(0x83, SAX, IndexedIndirect, 6, 0) \
+    X(0x84, STY, ZeroPage,        3, 0) \
+    X(0x85, STA, ZeroPage,        3, 0) \
+    X(0x86, STX, ZeroPage,        3, 0) \
+    X(0x87, SAX, ZeroPage,        3, 0) \
+    X(0x88, DEY, Implied,         2, 0) \
+    X(0x89, NOP, Immediate,       2, 0) \
+    X(0x8A, TXA, Implied,         2, 0) \
+    X(0x8B, XAA, Immediate,       2, 0) \
+    X(0x8C, STY, Absolute,        4, 0) \
+    X(0x8D, STA, Absolute,        4, 0) \
+    X(0x8E, STX, Absolute,        4, 0) \
+    X(0x8F, SAX, Absolute,        4, 0) \
+    X(0x90, BCC, Relative,        2, 1) \
+    X(0x91, STA, IndirectIndexed, 6, 0) \
+    X(0x92, KIL, Implied,         2, 0) \
+    X(0x93, AHX, IndirectIndexed, 6, 0) \
+    X(0x94, STY, ZeroPageX,       4, 0) \
+    X(0x95, STA, ZeroPageX,       4, 0) \
+    X(0x96, STX, ZeroPageY,       4, 0) \
+    X(0x97, SAX, ZeroPageY,       4, 0) \
+    X(0x98, TYA, Implied,         2, 0) \
+    X(0x99, STA, AbsoluteY,       5, 0) \
+    X(0x9A, TXS, Implied,         2, 0) \
+    X(0x9B, TAS, AbsoluteY,       5, 0) \
+    X(0x9C, SHY, AbsoluteX,       5, 0) \
+    X(0x9D, STA, AbsoluteX,       5, 0) \
+    X(0x9E, SHX, AbsoluteY,       5, 0) \
+    X(0x9F, AHX, AbsoluteY,       5, 0) \
+    X(0xA0, LDY, Immediate,       2, 0) \
+    X(0xA1, LDA, IndexedIndirect, 6, 0) \
+    X(0xA2, LDX, Immediate,       2, 0) \
+    X(0xA3, LAX, IndexedIndirect, 6, 0) \
+    X(0xA4, LDY, ZeroPage,        3, 0) \
+    X(0xA5, LDA, ZeroPage,        3, 0) \
+    X(0xA6, LDX, ZeroPage,        3, 0) \
+    X(0xA7, LAX, ZeroPage,        3, 0) \
+    X(0xA8, TAY, Implied,         2, 0) \
+    X(0xA9, LDA, Immediate,       2, 0) \
+    X(0xAA, TAX, Implied,         2, 0) \
+    X(0xAB, LAX, Immediate,       2, 0) \
+    X(0xAC, LDY, Absolute,        4, 0) \
+    X(0xAD, LDA, Absolute,        4, 0) \
+    X(0xAE, LDX, Absolute,        4, 0) \
+    X(0xAF, LAX, Absolute,        4, 0) \
+    X(0xB0, BCS, Relative,        2, 1) \
+    X(0xB1, LDA, IndirectIndexed, 5, 1) \
+    X(0xB2, KIL, Implied,         2, 0) \
+    X(0xB3, LAX, IndirectIndexed, 5, 1) \
+    X(0xB4, LDY, ZeroPageX,       4, 0) \
+    X(0xB5, LDA, ZeroPageX,       4, 0) \
+    X(0xB6, LDX, ZeroPageY,       4, 0) \
+    X(0xB7, LAX, ZeroPageY,       4, 0) \
+    X(0xB8, CLV, Implied,         2, 0) \
+    X(0xB9, LDA, AbsoluteY,       4, 1) \
+    X(0xBA, TSX, Implied,         2, 0) \
+    X(0xBB, LAS, AbsoluteY,       4, 1) \
+    X(0xBC, LDY, AbsoluteX,       4, 1) \
+    X(0xBD, LDA, AbsoluteX,       4, 1) \
+    X(0xBE, LDX, AbsoluteY,       4, 1) \
+    X(0xBF, LAX, AbsoluteY,       4, 1) \
+    X(0xC0, CPY, Immediate,       2, 0) \
+    X(0xC1, CMP, IndexedIndirect, 6, 0) \
+    X(0xC2, NOP, Immediate,       2, 0) \
+    X(0xC3, DCP, IndexedIndirect, 8, 0) \
+    X(0xC4, CPY, ZeroPage,        3, 0) \
+    X(0xC5, CMP, ZeroPage,        3, 0) \
+    X(0xC6, DEC, ZeroPage,        5, 0) \
+    X(0xC7, DCP, ZeroPage,        5, 0) \
+    X(0xC8, INY, Implied,         2, 0) \
+    X(0xC9, CMP, Immediate,       2, 0) \
+    X(0xCA, DEX, Implied,         2, 0) \
+    X(0xCB, AXS, Immediate,       2, 0) \
+    X(0xCC, CPY, Absolute,        4, 0) \
+    X(0xCD, CMP, Absolute,        4, 0) \
+    X(0xCE, DEC, Absolute,        6, 0) \
+    X(0xCF, DCP, Absolute,        6, 0) \
+    X(0xD0, BNE, Relative,        2, 1) \
+    X(0xD1, CMP, IndirectIndexed, 5, 1) \
+    X(0xD2, KIL, Implied,         2, 0) \
+    X(0xD3, DCP, IndirectIndexed, 8, 0) \
+    X(0xD4, NOP, ZeroPageX,       4, 0) \
+    X(0xD5, CMP, ZeroPageX,       4, 0) \
+    X(0xD6, DEC, ZeroPageX,       6, 0) \
+    X(0xD7, DCP, ZeroPageX,       6, 0) \
+    X(0xD8, CLD, Implied,         2, 0) \
+    X(0xD9, CMP, AbsoluteY,       4, 1) \
+    X(0xDA, NOP, Implied,         2, 0) \
+    X(0xDB, DCP, AbsoluteY,       7, 0) \
+    X(0xDC, NOP, AbsoluteX,       4, 1) \
+    X(0xDD, CMP, AbsoluteX,       4, 1) \
+    X(0xDE, DEC, AbsoluteX,       7, 0) \
+    X(0xDF, DCP, AbsoluteX,       7, 0) \
+    X(0xE0, CPX, Immediate,       2, 0) \
+    X(0xE1, SBC, IndexedIndirect, 6, 0) \
+    X(0xE2, NOP, Immediate,       2, 0) \
+    X(0xE3, ISC, IndexedIndirect, 8, 0) \
+    X(0xE4, CPX, ZeroPage,        3, 0) \
+    X(0xE5, SBC, ZeroPage,        3, 0) \
+    X(0xE6, INC, ZeroPage,        5, 0) \
+    X(0xE7, ISC, ZeroPage,        5, 0) \
+    X(0xE8, INX, Implied,         2, 0) \
+    X(0xE9, SBC, Immediate,       2, 0) \
+    X(0xEA, NOP, Implied,         2, 0) \
+    X(0xEB, SBC, Immediate,       2, 0) \
+    X(0xEC, CPX, Absolute,        4, 0) \
+    X(0xED, SBC, Absolute,        4, 0) \
+    X(0xEE, INC, Absolute,        6, 0) \
+    X(0xEF, ISC, Absolute,        6, 0) \
+    X(0xF0, BEQ, Relative,        2, 1) \
+    X(0xF1, SBC, IndirectIndexed, 5, 1) \
+    X(0xF2, KIL, Implied,         2, 0) \
+    X(0xF3, ISC, IndirectIndexed, 8, 0) \
+    X(0xF4, NOP, ZeroPageX,       4, 0) \
+    X(0xF5, SBC, ZeroPageX,       4, 0) \
+    X(0xF6, INC, ZeroPageX,       6, 0) \
+    X(0xF7, ISC, ZeroPageX,       6, 0) \
+    X(0xF8, SED, Implied,         2, 0) \
+    X(0xF9, SBC, AbsoluteY,       4, 1) \
+    X(0xFA, NOP, Implied,         2, 0) \
+    X(0xFB, ISC, AbsoluteY,       7, 0) \
+    X(0xFC, NOP, AbsoluteX,       4, 1) \
+    X(0xFD, SBC, AbsoluteX,       4, 1) \
+    X(0xFE, INC, AbsoluteX,       7, 0) \
+    X(0xFF, ISC, AbsoluteX,       7, 0)
+
+#define G6502_OPERATION_LIST(X) \
+    X(ADC) X(AND) X(ASL) X(BCC) X(BCS) X(BEQ) X(BIT) X(BMI) \
+    X(BNE) X(BPL) X(BRK) X(BVC) X(BVS) X(CLC) X(CLD) X(CLI) \
+    X(CLV) X(CMP) X(CPX) X(CPY) X(DEC) X(DEX) X(DEY) X(EOR) \
+    X(INC) X(INX) X(INY) X(JMP) X(JSR) X(LDA) X(LDX) X(LDY) \
+    X(LSR) X(NOP) X(ORA) X(PHA) X(PHP) X(PLA) X(PLP) X(ROL) \
+    X(ROR) X(RTI) X(RTS) X(SBC) X(SEC) X(SED) X(SEI) X(STA) \
+    X(STX) X(STY) X(TAX) X(TAY) X(TSX) X(TXA) X(TXS) X(TYA) \
+    X(AHX) X(ALR) X(ANC) X(ARR) X(AXS) X(DCP) X(ISC) X(KIL) \
+    X(LAS) X(LAX) X(RLA) X(RRA) X(SAX) X(SHX) X(SHY) X(SLO) \
+    X(SRE) X(TAS) X(XAA)
+
+// Instruction pairs that RunFor() runs in one dispatch when they follow
+// each other: index, first opcode, second opcode, name. A first opcode
+// may start several pairs.
+#define G6502_FUSED_PAIR_TABLE(X) \
+    X(0, 0xCA, 0xD0, "DEX/BNE") \
+    X(1, 0x88, 0xD0, "DEY/BNE") \
+    X(2, 0xBD, 0x99, "LDA abs,X/STA abs,Y") \
+    X(3, 0xE6, 0xD0, "INC zp/BNE") \
+    X(4, 0xC9, 0xF0, "CMP #imm/BEQ")
+
+#define G6502_READ_ONLY_OPERATION_LIST(X) \
+    X(ADC) X(AND) X(BCC) X(BCS) X(BEQ) X(BIT) X(BMI) X(BNE) \
+    X(BPL) X(BVC) X(BVS) X(CLC) X(CLD) X(CLI) X(CLV) X(CMP) \
+    X(CPX) X(CPY) X(DEX) X(DEY) X(EOR) X(INX) X(INY) X(JMP) \
+    X(LDA) X(LDX) X(LDY) X(NOP) X(ORA) X(SBC) X(SEC) X(SED) \
+    X(SEI) X(TAX) X(TAY) X(TSX) X(TXA) X(TXS) X(TYA) X(ALR) \
+    X(ANC) X(ARR) X(AXS) X(LAS) X(LAX) X(XAA)
+
+namespace g6502
+{
+
+enum OPCode_Addressing
+{
+    kAddressingImplied,
+    kAddressingAccumulator,
+    kAddressingImmediate,
+    kAddressingZeroPage,
+    kAddressingZeroPageX,
+    kAddressingZeroPageY,
+    kAddressingRelative,
+    kAddressingAbsolute,
+    kAddressingAbsoluteX,
+    kAddressingAbsoluteY,
+    kAddressingIndirect,
+    kAddressingIndexedIndirect,
+    kAddressingIndirectIndexed
+};
+
+// Addressing mode tags, the size includes the opcode byte
+struct ModeImplied { static constexpr u8 kSize = 1; static constexpr OPCode_Addressing kAddressing = kAddressingImplied; };
+struct ModeAccumulator { static constexpr u8 kSize = 1; static constexpr OPCode_Addressing kAddressing = kAddressingAccumulator; };
+struct ModeImmediate { static constexpr u8 kSize = 2; static constexpr OPCode_Addressing kAddressing = kAddressingImmediate; };
+struct ModeZeroPage { static constexpr u8 kSize = 2; static constexpr OPCode_Addressing kAddressing = kAddressingZeroPage; };
+struct ModeZeroPageX { static constexpr u8 kSize = 2; static constexpr OPCode_Addressing kAddressing = kAddressingZeroPageX; };
+struct ModeZeroPageY { static constexpr u8 kSize = 2; static constexpr OPCode_Addressing kAddressing = kAddressingZeroPageY; };
+struct ModeRelative { static constexpr u8 kSize = 2; static constexpr OPCode_Addressing kAddressing = kAddressingRelative; };
+struct ModeAbsolute { static constexpr u8 kSize = 3; static constexpr OPCode_Addressing kAddressing = kAddressingAbsolute; };
+struct ModeAbsoluteX { static constexpr u8 kSize = 3; static constexpr OPCode_Addressing kAddressing = kAddressingAbsoluteX; };
+struct ModeAbsoluteY { static constexpr u8 kSize = 3; static constexpr OPCode_Addressing kAddressing = kAddressingAbsoluteY; };
+struct ModeIndirect { static constexpr u8 kSize = 3; static constexpr OPCode_Addressing kAddressing = kAddressingIndirect; };
+struct ModeIndexedIndirect { static constexpr u8 kSize = 2; static constexpr OPCode_Addressing kAddressing = kAddressingIndexedIndirect; };
+struct ModeIndirectIndexed { static constexpr u8 kSize = 2; static constexpr OPCode_Addressing kAddressing = kAddressingIndirectIndexed; };
+
+// Operation tags
+#define G6502_OPERATION_TAG(operation) struct Op##operation { };
+G6502_OPERATION_LIST(G6502_OPERATION_TAG)
+#undef G6502_OPERATION_TAG
+
+// Operations that only change registers and flags, reading at most their
+// operand. Shifts and rotates are also read-only on the accumulator.
+template <class Operation> struct ReadOnlyOperation { static constexpr bool value = false; };
+
+#define G6502_READ_ONLY_TAG(operation) \
+    template <> struct ReadOnlyOperation<Op##operation> { static constexpr bool value = true; };
+G6502_READ_ONLY_OPERATION_LIST(G6502_READ_ONLY_TAG)
+#undef G6502_READ_ONLY_TAG
+
+struct stOPCodeInfo
+{
+    u8 opcode;
+    u8 t_states;
+    u8 page_cross_t_states;
+    u8 size;
+    u8 addressing;
+    bool read_only;
+};
+
+#define G6502_OPCODE_INFO(opcode, operation, mode, t_states, page_cross) \
+    { opcode, t_states, page_cross, Mode##mode::kSize, Mode##mode::kAddressing, \
+      ReadOnlyOperation<Op##operation>::value || (Mode##mode::kAddressing == kAddressingAccumulator) },
+
+constexpr stOPCodeInfo kOPCodeInfo[256] = { G6502_OPCODE_TABLE(G6502_OPCODE_INFO) };
+
+#undef G6502_OPCODE_INFO
+
+constexpr bool OPCodeInfoIsOrdered(int index)
+{
+    return (index == 256) || ((kOPCodeInfo[index].opcode == index) && OPCodeInfoIsOrdered(index + 1));
+}
+
+static_assert(OPCodeInfoIsOrdered(0), "G6502_OPCODE_TABLE rows must be sorted by opcode");
+
+// Operation and addressing mode of an opcode at compile time
+template <int opcode> struct OPCodeTraits;
+
+#define G6502_OPCODE_TRAITS(opcode, operation, mode, t_states, page_cross) \
+    template <> struct OPCodeTraits<opcode> { typedef Op##operation Operation; typedef Mode##mode Mode; };
+G6502_OPCODE_TABLE(G6502_OPCODE_TRAITS)
+#undef G6502_OPCODE_TRAITS
+
+#define G6502_FUSED_PAIR_NAME(pair, first, second, name) name,
+
+const char* const kFusedPairNames[] = { G6502_FUSED_PAIR_TABLE(G6502_FUSED_PAIR_NAME) };
+
+#undef G6502_FUSED_PAIR_NAME
+
+const int kFusedPairCount = sizeof(kFusedPairNames) / sizeof(kFusedPairNames[0]);
+
+} // namespace g6502
+
+#endif	/* G6502_OPCODE_TABLE_H_ */
@@ -0,0 +1,623 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_OPCODES_INL_H_
+#define	G6502_OPCODES_INL_H_
+
+#include "g6502_definitions.h"
+#include "g6502_eight_bit_register.h"
+#include "g6502_sixteen_bit_register.h"
+#include "g6502_core.h"
+
+namespace g6502
+{
+
+// The addressing mode and operation are both types, so every row of
+// G6502_OPCODE_TABLE compiles to its own body with the addressing inlined
+template <class MemoryImpl>
+template <class Operation, class Mode>
+inline void G6502<MemoryImpl>::Instruction()
+{
+    Execute(Operation(), Mode());
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpADC, Mode mode)
+{
+    OPCodes_ADC(Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpAND, Mode mode)
+{
+    OPCodes_AND(Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpASL, Mode mode)
+{
+    OPCodes_ASL_Memory(mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpASL, ModeAccumulator)
+{
+    OPCodes_ASL_Accumulator();
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBCC, ModeRelative)
+{
+    OPcodes_Branch(!IsSetFlag(FLAG_CARRY));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBCS, ModeRelative)
+{
+    OPcodes_Branch(IsSetFlag(FLAG_CARRY));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBEQ, ModeRelative)
+{
+    OPcodes_Branch(IsSetFlag(FLAG_ZERO));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpBIT, Mode mode)
+{
+    OPCodes_BIT(Operand(mode));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBMI, ModeRelative)
+{
+    OPcodes_Branch(IsSetFlag(FLAG_NEGATIVE));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBNE, ModeRelative)
+{
+    OPcodes_Branch(!IsSetFlag(FLAG_ZERO));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBPL, ModeRelative)
+{
+    OPcodes_Branch(!IsSetFlag(FLAG_NEGATIVE));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBRK, ModeImplied)
+{
+    OPCodes_BRK();
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBVC, ModeRelative)
+{
+    OPcodes_Branch(!IsSetFlag(FLAG_OVERFLOW));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpBVS, ModeRelative)
+{
+    OPcodes_Branch(IsSetFlag(FLAG_OVERFLOW));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpCLC, ModeImplied)
+{
+    OPCodes_ClearFlag(FLAG_CARRY);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpCLD, ModeImplied)
+{
+    OPCodes_ClearFlag(FLAG_DECIMAL);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpCLI, ModeImplied)
+{
+    OPCodes_ClearFlag(FLAG_IRQ);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpCLV, ModeImplied)
+{
+    OPCodes_ClearFlag(FLAG_OVERFLOW);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpCMP, Mode mode)
+{
+    OPCodes_CMP(&A_, Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpCPX, Mode mode)
+{
+    OPCodes_CMP(&X_, Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpCPY, Mode mode)
+{
+    OPCodes_CMP(&Y_, Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpDEC, Mode mode)
+{
+    OPCodes_DEC_Mem(mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpDEX, ModeImplied)
+{
+    OPCodes_DEC_Reg(&X_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpDEY, ModeImplied)
+{
+    OPCodes_DEC_Reg(&Y_);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpEOR, Mode mode)
+{
+    OPCodes_EOR(Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpINC, Mode mode)
+{
+    OPCodes_INC_Mem(mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpINX, ModeImplied)
+{
+    OPCodes_INC_Reg(&X_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpINY, ModeImplied)
+{
+    OPCodes_INC_Reg(&Y_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpJMP, ModeAbsolute)
+{
+    u16 target = AbsoluteAddressing();
+    u16 end = PC_.GetValue();
+    PC_.SetValue(target);
+
+    if ((target < end) && idle_loop_detection_)
+    {
+        IdleLoop(target, end);
+    }
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpJMP, Mode mode)
+{
+    PC_.SetValue(Address(mode));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpJSR, ModeAbsolute)
+{
+    u16 target = AbsoluteAddressing();
+    StackPush16(PC_.GetValue() - 1);
+    PC_.SetValue(target);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpLDA, Mode mode)
+{
+    OPCodes_LD(&A_, Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpLDX, Mode mode)
+{
+    OPCodes_LD(&X_, Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpLDY, Mode mode)
+{
+    OPCodes_LD(&Y_, Operand(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpLSR, Mode mode)
+{
+    OPCodes_LSR_Memory(mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpLSR, ModeAccumulator)
+{
+    OPCodes_LSR_Accumulator();
+}
+
+// The unofficial NOPs still read their operand
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpNOP, Mode mode)
+{
+    Operand(mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpNOP, ModeImplied)
+{
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpORA, Mode mode)
+{
+    OPCodes_ORA(Operand(mode));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpPHA, ModeImplied)
+{
+    StackPush8(A_.GetValue());
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpPHP, ModeImplied)
+{
+    SetFlag(FLAG_BRK);
+    StackPush8(GetP());
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpPLA, ModeImplied)
+{
+    u8 result = StackPop8();
+    A_.SetValue(result);
+    SetZeroFlagFromResult(result);
+    SetNegativeFlagFromResult(result);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpPLP, ModeImplied)
+{
+    SetP((StackPop8() & 0xCF) | (GetP() & 0x30));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpROL, Mode mode)
+{
+    OPCodes_ROL_Memory(mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpROL, ModeAccumulator)
+{
+    OPCodes_ROL_Accumulator();
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpROR, Mode mode)
+{
+    OPCodes_ROR_Memory(mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpROR, ModeAccumulator)
+{
+    OPCodes_ROR_Accumulator();
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpRTI, ModeImplied)
+{
+    SetP((StackPop8() & 0xCF) | (GetP() & 0x30));
+    PC_.SetValue(StackPop16());
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpRTS, ModeImplied)
+{
+    PC_.SetValue(StackPop16() + 1);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpSBC, Mode mode)
+{
+    OPCodes_SBC(Operand(mode));
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpSEC, ModeImplied)
+{
+    OPCodes_SetFlag(FLAG_CARRY);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpSED, ModeImplied)
+{
+    OPCodes_SetFlag(FLAG_DECIMAL);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpSEI, ModeImplied)
+{
+    OPCodes_SetFlag(FLAG_IRQ);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpSTA, Mode mode)
+{
+    OPCodes_Store(&A_, mode);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpSTX, Mode mode)
+{
+    OPCodes_Store(&X_, mode);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpSTY, Mode mode)
+{
+    OPCodes_Store(&Y_, mode);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpTAX, ModeImplied)
+{
+    OPCodes_Transfer(&A_, &X_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpTAY, ModeImplied)
+{
+    OPCodes_Transfer(&A_, &Y_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpTSX, ModeImplied)
+{
+    OPCodes_Transfer(&S_, &X_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpTXA, ModeImplied)
+{
+    OPCodes_Transfer(&X_, &A_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpTXS, ModeImplied)
+{
+    OPCodes_Transfer(&X_, &S_);
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpTYA, ModeImplied)
+{
+    OPCodes_Transfer(&Y_, &A_);
+}
+
+// Unofficial opcodes
+
+// Also known as SHA
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpAHX, Mode mode)
+{
+    OPCodes_StoreHighAnd(Address(mode), Y_.GetValue(), A_.GetValue() & X_.GetValue());
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpALR, ModeImmediate)
+{
+    OPCodes_AND(ImmediateAddressing());
+    OPCodes_LSR_Accumulator();
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpANC, ModeImmediate)
+{
+    OPCodes_AND(ImmediateAddressing());
+    if (IsSetFlag(FLAG_NEGATIVE))
+        SetFlag(FLAG_CARRY);
+    else
+        ClearFlag(FLAG_CARRY);
+}
+
+// AND then ROR, with C from bit 6 and V from bit 6 ^ bit 5
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpARR, ModeImmediate)
+{
+    u8 result = (A_.GetValue() & ImmediateAddressing()) >> 1;
+    result |= IsSetFlag(FLAG_CARRY) ? 0x80 : 0x00;
+    A_.SetValue(result);
+    SetZeroFlagFromResult(result);
+    SetNegativeFlagFromResult(result);
+    if ((result & 0x40) != 0)
+        SetFlag(FLAG_CARRY);
+    else
+        ClearFlag(FLAG_CARRY);
+    if ((((result >> 6) ^ (result >> 5)) & 0x01) != 0)
+        SetFlag(FLAG_OVERFLOW);
+    else
+        ClearFlag(FLAG_OVERFLOW);
+}
+
+// Also known as SBX, X = (A & X) - value with CMP flags
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpAXS, ModeImmediate)
+{
+    u8 value = ImmediateAddressing();
+    u8 reg_value = A_.GetValue() & X_.GetValue();
+    u8 result = reg_value - value;
+    X_.SetValue(result);
+    SetZeroFlagFromResult(result);
+    SetNegativeFlagFromResult(result);
+    if (reg_value >= value)
+        SetFlag(FLAG_CARRY);
+    else
+        ClearFlag(FLAG_CARRY);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpDCP, Mode mode)
+{
+    OPCodes_CMP(&A_, OPCodes_DEC_Mem(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpISC, Mode mode)
+{
+    OPCodes_SBC(OPCodes_INC_Mem(mode));
+}
+
+// Jams the CPU, it keeps executing the same opcode
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpKIL, ModeImplied)
+{
+    PC_.Decrement();
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpLAS, ModeAbsoluteY)
+{
+    u8 result = Read(AbsoluteAddressing(&Y_)) & S_.GetValue();
+    A_.SetValue(result);
+    S_.SetValue(result);
+    OPCodes_LD(&X_, result);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpLAX, Mode mode)
+{
+    u8 value = Operand(mode);
+    A_.SetValue(value);
+    OPCodes_LD(&X_, value);
+}
+
+// Unstable on hardware, uses the common 0xEE magic constant
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpLAX, ModeImmediate)
+{
+    u8 result = (A_.GetValue() | 0xEE) & ImmediateAddressing();
+    A_.SetValue(result);
+    OPCodes_LD(&X_, result);
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpRLA, Mode mode)
+{
+    OPCodes_AND(OPCodes_ROL_Memory(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpRRA, Mode mode)
+{
+    OPCodes_ADC(OPCodes_ROR_Memory(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpSAX, Mode mode)
+{
+    Store(mode, Address(mode), A_.GetValue() & X_.GetValue());
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpSHX, ModeAbsoluteY)
+{
+    OPCodes_StoreHighAnd(AbsoluteAddressing(&Y_), Y_.GetValue(), X_.GetValue());
+}
+
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpSHY, ModeAbsoluteX)
+{
+    OPCodes_StoreHighAnd(AbsoluteAddressing(&X_), X_.GetValue(), Y_.GetValue());
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpSLO, Mode mode)
+{
+    OPCodes_ORA(OPCodes_ASL_Memory(mode));
+}
+
+template <class MemoryImpl>
+template <class Mode>
+inline void G6502<MemoryImpl>::Execute(OpSRE, Mode mode)
+{
+    OPCodes_EOR(OPCodes_LSR_Memory(mode));
+}
+
+// Also known as SHS
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpTAS, ModeAbsoluteY)
+{
+    S_.SetValue(A_.GetValue() & X_.GetValue());
+    OPCodes_StoreHighAnd(AbsoluteAddressing(&Y_), Y_.GetValue(), S_.GetValue());
+}
+
+// Also known as ANE, unstable on hardware like LAX #imm
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::Execute(OpXAA, ModeImmediate)
+{
+    OPCodes_LD(&A_, (A_.GetValue() | 0xEE) & X_.GetValue() & ImmediateAddressing());
+}
+
+} // namespace g6502
+
+#endif // G6502_OPCODES_INL_H_
@@ -0,0 +1,276 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "g6502_profiler.h"
+
+#ifdef G6502_PROFILER
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include "g6502_opcode_names.h"
+
+namespace g6502
+{
+
+Profiler::Profiler()
+{
+    addresses_ = new stProfilerAddress[0x10000];
+    Reset();
+}
+
+Profiler::~Profiler()
+{
+    delete [] addresses_;
+}
+
+void Profiler::Reset()
+{
+    memset(addresses_, 0, sizeof(stProfilerAddress) * 0x10000);
+
+    stNode root;
+    root.parent = -1;
+    root.function = 0;
+    root.kind = kProfilerCall;
+    root.calls = 0;
+    root.t_states = 0;
+
+    nodes_.clear();
+    nodes_.push_back(root);
+    children_.clear();
+    total_t_states_ = 0;
+    ClearCallStack();
+}
+
+// Back to the stack after reset, the profile so far is kept
+void Profiler::ClearCallStack()
+{
+    depth_ = 0;
+    node_ = 0;
+}
+
+void Profiler::Enter(u16 function, Profiler_Frame kind, unsigned int return_s)
+{
+    // Code that never returns (a handler that resets S and jumps back to
+    // the main loop) would grow the stack forever
+    if (depth_ == kMaxDepth)
+    {
+        ClearCallStack();
+    }
+
+    u64 key = (static_cast<u64>(node_) << 32) | (static_cast<u64>(kind) << 16) | function;
+    std::unordered_map<u64, int>::const_iterator it = children_.find(key);
+    int child;
+
+    if (it != children_.end())
+    {
+        child = it->second;
+    }
+    else
+    {
+        stNode node;
+        node.parent = node_;
+        node.function = function;
+        node.kind = kind;
+        node.calls = 0;
+        node.t_states = 0;
+
+        child = static_cast<int>(nodes_.size());
+        nodes_.push_back(node);
+        children_[key] = child;
+    }
+
+    nodes_[child].calls++;
+    frames_[depth_].node = node_;
+    frames_[depth_].return_s = return_s;
+    depth_++;
+    node_ = child;
+}
+
+void Profiler::Return(unsigned int s)
+{
+    while ((depth_ > 0) && (s >= frames_[depth_ - 1].return_s))
+    {
+        depth_--;
+        node_ = frames_[depth_].node;
+    }
+}
+
+const stProfilerAddress* Profiler::GetAddress(u16 address) const
+{
+    return &addresses_[address];
+}
+
+u64 Profiler::GetTotalTStates() const
+{
+    return total_t_states_;
+}
+
+// Addresses sorted by cycles, count <= 0 prints all of them
+void Profiler::PrintHotSpots(FILE* file, int count) const
+{
+    std::vector<u16> hot;
+
+    for (int i = 0; i < 0x10000; i++)
+    {
+        if (addresses_[i].instructions > 0)
+            hot.push_back(static_cast<u16>(i));
+    }
+
+    size_t lines = ((count > 0) && (static_cast<size_t>(count) < hot.size())) ? count : hot.size();
+
+    std::partial_sort(hot.begin(), hot.begin() + lines, hot.end(), [this](u16 a, u16 b)
+    {
+        return addresses_[a].t_states > addresses_[b].t_states;
+    });
+
+    fprintf(file, "%14s %8s %14s  %-7s %s\n", "cycles", "%", "instructions", "address", "instruction");
+
+    for (size_t i = 0; i < lines; i++)
+    {
+        const stProfilerAddress& entry = addresses_[hot[i]];
+        char instruction[32];
+        FormatInstruction(hot[i], instruction, sizeof(instruction));
+
+        fprintf(file, "%14llu %7.2f%% %14llu  $%04X   %s\n", static_cast<unsigned long long>(entry.t_states),
+                (total_t_states_ > 0) ? (entry.t_states * 100.0 / total_t_states_) : 0.0,
+                static_cast<unsigned long long>(entry.instructions), hot[i], instruction);
+    }
+}
+
+// Caller -> callee edges with the cycles spent under the callee, merged
+// over every stack they appear in and sorted by those cycles
+void Profiler::PrintCallGraph(FILE* file, int count) const
+{
+    struct stEdge
+    {
+        int caller;
+        int callee;
+        u64 calls;
+        u64 t_states;
+    };
+
+    std::vector<u64> inclusive(nodes_.size());
+
+    for (size_t i = 0; i < nodes_.size(); i++)
+        inclusive[i] = nodes_[i].t_states;
+
+    // Children are always created after their parent
+    for (size_t i = nodes_.size() - 1; i > 0; i--)
+        inclusive[nodes_[i].parent] += inclusive[i];
+
+    std::map<u64, stEdge> edges;
+
+    for (size_t i = 1; i < nodes_.size(); i++)
+    {
+        const stNode& callee = nodes_[i];
+        const stNode& caller = nodes_[callee.parent];
+        u64 caller_id = (callee.parent == 0) ? 0xFFFFFFFF : ((caller.kind << 16) | caller.function);
+        u64 callee_id = (callee.kind << 16) | callee.function;
+        u64 key = (caller_id << 32) | callee_id;
+
+        std::map<u64, stEdge>::iterator it = edges.find(key);
+
+        if (it == edges.end())
+        {
+            stEdge edge = { callee.parent, static_cast<int>(i), 0, 0 };
+            it = edges.insert(std::make_pair(key, edge)).first;
+        }
+
+        it->second.calls += callee.calls;
+        it->second.t_states += inclusive[i];
+    }
+
+    std::vector<stEdge> sorted;
+
+    for (std::map<u64, stEdge>::const_iterator it = edges.begin(); it != edges.end(); ++it)
+        sorted.push_back(it->second);
+
+    size_t lines = ((count > 0) && (static_cast<size_t>(count) < sorted.size())) ? count : sorted.size();
+
+    std::partial_sort(sorted.begin(), sorted.begin() + lines, sorted.end(), [](const stEdge& a, const stEdge& b)
+    {
+        return a.t_states > b.t_states;
+    });
+
+    fprintf(file, "%14s %8s %12s  %s\n", "cycles", "%", "calls", "caller -> callee");
+
+    for (size_t i = 0; i < lines; i++)
+    {
+        char caller[16];
+        char callee[16];
+        FormatFrame(sorted[i].caller, caller, sizeof(caller));
+        FormatFrame(sorted[i].callee, callee, sizeof(callee));
+
+        fprintf(file, "%14llu %7.2f%% %12llu  %s -> %s\n", static_cast<unsigned long long>(sorted[i].t_states),
+                (total_t_states_ > 0) ? (sorted[i].t_states * 100.0 / total_t_states_) : 0.0,
+                static_cast<unsigned long long>(sorted[i].calls), caller, callee);
+    }
+}
+
+// One "frame;frame;frame cycles" line per call stack with cycles of its
+// own, the input format of flamegraph.pl and speedscope
+void Profiler::PrintCollapsedStacks(FILE* file) const
+{
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        if (nodes_[i].t_states == 0)
+            continue;
+
+        std::string stack;
+
+        for (int node = static_cast<int>(i); node >= 0; node = nodes_[node].parent)
+        {
+            char frame[16];
+            FormatFrame(node, frame, sizeof(frame));
+            stack = (node == static_cast<int>(i)) ? std::string(frame) : (std::string(frame) + ";" + stack);
+        }
+
+        fprintf(file, "%s %llu\n", stack.c_str(), static_cast<unsigned long long>(nodes_[i].t_states));
+    }
+}
+
+void Profiler::FormatInstruction(u16 address, char* buffer, int size) const
+{
+    const stProfilerAddress& entry = addresses_[address];
+    FormatOPCode(buffer, size, address, entry.opcode, entry.decoded ? entry.operand : nullptr);
+}
+
+void Profiler::FormatFrame(int node, char* buffer, int size) const
+{
+    if (node == 0)
+    {
+        snprintf(buffer, size, "reset");
+        return;
+    }
+
+    const char* prefix = "";
+
+    if (nodes_[node].kind == kProfilerNMI)
+        prefix = "NMI ";
+    else if (nodes_[node].kind == kProfilerIRQ)
+        prefix = "IRQ ";
+
+    snprintf(buffer, size, "%s$%04X", prefix, nodes_[node].function);
+}
+
+} // namespace g6502
+
+#endif // G6502_PROFILER
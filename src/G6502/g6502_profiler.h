@@ -0,0 +1,146 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_PROFILER_H_
+#define	G6502_PROFILER_H_
+
+#include <cstdio>
+#include "g6502_definitions.h"
+
+#ifdef G6502_PROFILER
+#include <vector>
+#include <unordered_map>
+#endif
+
+namespace g6502
+{
+
+class Profiler;
+
+#ifdef G6502_PROFILER
+
+enum Profiler_Frame
+{
+    kProfilerCall,
+    kProfilerNMI,
+    // IRQ and BRK, both go through $FFFE
+    kProfilerIRQ
+};
+
+struct stProfilerAddress
+{
+    u64 instructions;
+    // Including DMA stalls and idle loop rounds skipped at this address
+    u64 t_states;
+    u8 opcode;
+    u8 operand[2];
+    // Operands are only known when the opcode came from a fetch page
+    bool decoded;
+};
+
+// Guest code profile filled by G6502::Tick(). Cycles go to the address of
+// each instruction and to the call stack it ran in, which follows JSR,
+// interrupts, RTS and RTI.
+class Profiler
+{
+public:
+    Profiler();
+    ~Profiler();
+    void Reset();
+    void ClearCallStack();
+    void Instruction(u16 address, u8 opcode, const u8* operands, unsigned int t_states);
+    void AddTStates(unsigned int t_states);
+    void Enter(u16 function, Profiler_Frame kind, unsigned int return_s);
+    void Return(unsigned int s);
+    const stProfilerAddress* GetAddress(u16 address) const;
+    u64 GetTotalTStates() const;
+    void PrintHotSpots(FILE* file, int count) const;
+    void PrintCallGraph(FILE* file, int count) const;
+    void PrintCollapsedStacks(FILE* file) const;
+
+private:
+    // One node per distinct call stack, node 0 is the stack after reset
+    struct stNode
+    {
+        int parent;
+        u16 function;
+        Profiler_Frame kind;
+        u64 calls;
+        u64 t_states;
+    };
+
+    struct stFrame
+    {
+        int node;
+        // S once the frame has returned, RTS or RTI pop every frame whose
+        // return_s they reach. Code that drops its return address and
+        // jumps away is popped by the next return of its caller.
+        unsigned int return_s;
+    };
+
+    static const int kMaxDepth = 64;
+
+private:
+    void FormatInstruction(u16 address, char* buffer, int size) const;
+    void FormatFrame(int node, char* buffer, int size) const;
+
+private:
+    stProfilerAddress* addresses_;
+    std::vector<stNode> nodes_;
+    // (parent, kind, function) -> node
+    std::unordered_map<u64, int> children_;
+    stFrame frames_[kMaxDepth];
+    int depth_;
+    int node_;
+    u64 total_t_states_;
+};
+
+inline void Profiler::Instruction(u16 address, u8 opcode, const u8* operands, unsigned int t_states)
+{
+    stProfilerAddress* entry = &addresses_[address];
+    entry->instructions++;
+    entry->t_states += t_states;
+
+    if (!entry->decoded)
+    {
+        entry->opcode = opcode;
+
+        if (operands != nullptr)
+        {
+            entry->operand[0] = operands[0];
+            entry->operand[1] = operands[1];
+            entry->decoded = true;
+        }
+    }
+
+    nodes_[node_].t_states += t_states;
+    total_t_states_ += t_states;
+}
+
+inline void Profiler::AddTStates(unsigned int t_states)
+{
+    nodes_[node_].t_states += t_states;
+    total_t_states_ += t_states;
+}
+
+#endif
+
+} // namespace g6502
+
+#endif // G6502_PROFILER_H_
@@ -0,0 +1,98 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_PROFILER_INL_H_
+#define	G6502_PROFILER_INL_H_
+
+#include "g6502_core.h"
+
+namespace g6502
+{
+
+// Only available in G6502_PROFILER builds. While enabled RunFor() goes
+// through Tick(), whatever the dispatch engine, the instruction cache or
+// the JIT, so the profile sees every instruction.
+template <class MemoryImpl>
+bool G6502<MemoryImpl>::EnableProfiler(bool enabled)
+{
+#ifdef G6502_PROFILER
+    if (enabled && (profiler_ == nullptr))
+    {
+        profiler_ = new Profiler();
+    }
+    else if (!enabled)
+    {
+        delete profiler_;
+        profiler_ = nullptr;
+    }
+
+    return true;
+#else
+    return !enabled;
+#endif
+}
+
+// nullptr while the profiler is disabled
+template <class MemoryImpl>
+Profiler* G6502<MemoryImpl>::GetProfiler() const
+{
+#ifdef G6502_PROFILER
+    return profiler_;
+#else
+    return nullptr;
+#endif
+}
+
+#ifdef G6502_PROFILER
+
+// Called by Tick() once the instruction at address has run, with
+// t_states_ holding everything it took
+template <class MemoryImpl>
+void G6502<MemoryImpl>::ProfileInstruction(u16 address, u8 opcode)
+{
+    // Operands are only peeked at in the fetch page, like fusion does
+    const u8* operands = nullptr;
+
+    if (((address >> 8) == fetch_page_number_) && ((address & 0xFF) < 0xFE))
+    {
+        operands = fetch_page_ + (address & 0xFF) + 1;
+    }
+
+    profiler_->Instruction(address, opcode, operands, t_states_);
+
+    switch (opcode)
+    {
+        case 0x20: // JSR
+            profiler_->Enter(PC_.GetValue(), kProfilerCall, S_.GetValue() + 2);
+            break;
+        case 0x00: // BRK
+            profiler_->Enter(PC_.GetValue(), kProfilerIRQ, S_.GetValue() + 3);
+            break;
+        case 0x40: // RTI
+        case 0x60: // RTS
+            profiler_->Return(S_.GetValue());
+            break;
+    }
+}
+
+#endif
+
+} // namespace g6502
+
+#endif // G6502_PROFILER_INL_H_
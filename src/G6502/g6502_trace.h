@@ -0,0 +1,171 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_TRACE_H_
+#define	G6502_TRACE_H_
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include "g6502_definitions.h"
+
+namespace g6502
+{
+
+// stTraceRecord::flags
+const u8 kTraceOperandsValid = 0x01;
+
+// One instruction, with the registers and the cycle count from before it
+// ran, as nestest.log shows them
+struct stTraceRecord
+{
+    u64 cycles;
+    u16 pc;
+    u8 opcode;
+    // Only what the instruction size uses, valid with kTraceOperandsValid
+    u8 operand[2];
+    u8 a;
+    u8 x;
+    u8 y;
+    u8 s;
+    u8 p;
+    u8 flags;
+    u8 reserved[5];
+};
+
+static_assert(sizeof(stTraceRecord) == 24, "stTraceRecord is a file format");
+
+// Lock-free ring of trace records with one producer (the CPU) and one
+// consumer (a thread writing them out). The producer waits when the
+// ring is full, so no record is ever lost.
+class TraceBuffer
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit TraceBuffer(int capacity);
+    ~TraceBuffer();
+    stTraceRecord* BeginWrite();
+    void EndWrite();
+    int Read(stTraceRecord* records, int count);
+    bool IsEmpty() const;
+    u64 GetWrittenRecords() const;
+    u64 GetFullWaits() const;
+
+private:
+    stTraceRecord* records_;
+    u64 mask_;
+    // Each side on its own cache line
+    u8 padding_head_[64];
+    std::atomic<u64> head_;
+    u64 cached_tail_;
+    u64 full_waits_;
+    u8 padding_tail_[64];
+    std::atomic<u64> tail_;
+};
+
+inline TraceBuffer::TraceBuffer(int capacity)
+{
+    u64 size = 1;
+
+    while (size < static_cast<u64>(capacity))
+        size <<= 1;
+
+    records_ = new stTraceRecord[size];
+    memset(records_, 0, sizeof(stTraceRecord) * size);
+    mask_ = size - 1;
+    head_.store(0);
+    tail_.store(0);
+    cached_tail_ = 0;
+    full_waits_ = 0;
+}
+
+inline TraceBuffer::~TraceBuffer()
+{
+    delete [] records_;
+}
+
+// The slot for the next record, fill it and call EndWrite()
+inline stTraceRecord* TraceBuffer::BeginWrite()
+{
+    u64 head = head_.load(std::memory_order_relaxed);
+
+    if ((head - cached_tail_) > mask_)
+    {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+
+        while ((head - cached_tail_) > mask_)
+        {
+            full_waits_++;
+            std::this_thread::yield();
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+    }
+
+    return &records_[head & mask_];
+}
+
+inline void TraceBuffer::EndWrite()
+{
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Copies up to count records out and frees their slots, returns how many
+inline int TraceBuffer::Read(stTraceRecord* records, int count)
+{
+    u64 tail = tail_.load(std::memory_order_relaxed);
+    u64 available = head_.load(std::memory_order_acquire) - tail;
+    int read = (available < static_cast<u64>(count)) ? static_cast<int>(available) : count;
+
+    for (int i = 0; i < read; )
+    {
+        // Up to the end of the ring in one copy
+        u64 index = (tail + i) & mask_;
+        int run = static_cast<int>(mask_ + 1 - index);
+
+        if (run > read - i)
+            run = read - i;
+
+        memcpy(records + i, records_ + index, sizeof(stTraceRecord) * run);
+        i += run;
+    }
+
+    tail_.store(tail + read, std::memory_order_release);
+
+    return read;
+}
+
+inline bool TraceBuffer::IsEmpty() const
+{
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+inline u64 TraceBuffer::GetWrittenRecords() const
+{
+    return head_.load(std::memory_order_acquire);
+}
+
+// Times the producer found the ring full and had to wait for the consumer
+inline u64 TraceBuffer::GetFullWaits() const
+{
+    return full_waits_;
+}
+
+} // namespace g6502
+
+#endif // G6502_TRACE_H_
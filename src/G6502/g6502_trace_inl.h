@@ -0,0 +1,85 @@
+/*
+ * G6502 - 6502 Emulator
+ * Copyright (C) 2016  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef G6502_TRACE_INL_H_
+#define	G6502_TRACE_INL_H_
+
+#include "g6502_core.h"
+
+namespace g6502
+{
+
+// Every instruction is written to buffer from now on, nullptr stops. cycles
+// is the count the next instruction is traced with. While tracing RunFor()
+// goes through Tick(), as with the profiler.
+template <class MemoryImpl>
+void G6502<MemoryImpl>::SetTraceBuffer(TraceBuffer* buffer, u64 cycles)
+{
+    trace_buffer_ = buffer;
+    trace_cycles_ = cycles;
+}
+
+// Called by Tick() after the opcode fetch, before the instruction runs
+template <class MemoryImpl>
+inline void G6502<MemoryImpl>::TraceInstruction(u16 address, u8 opcode)
+{
+    stTraceRecord* record = trace_buffer_->BeginWrite();
+
+    record->cycles = trace_cycles_;
+    record->pc = address;
+    record->opcode = opcode;
+    record->a = A_.GetValue();
+    record->x = X_.GetValue();
+    record->y = Y_.GetValue();
+    record->s = S_.GetValue();
+    record->p = GetP();
+    record->flags = 0;
+    record->operand[0] = 0;
+    record->operand[1] = 0;
+
+    // Operands are only peeked at in directly mapped pages, reading them
+    // through the bus could have side effects
+    u8 size = kOPCodeInfo[opcode].size;
+    bool valid = true;
+
+    for (int i = 1; i < size; i++)
+    {
+        u16 operand_address = static_cast<u16>(address + i);
+        const u8* page = memory_impl_->GetReadPage(operand_address);
+
+        if (page == nullptr)
+        {
+            valid = false;
+            break;
+        }
+
+        record->operand[i - 1] = page[operand_address & 0xFF];
+    }
+
+    if (valid)
+    {
+        record->flags |= kTraceOperandsValid;
+    }
+
+    trace_buffer_->EndWrite();
+}
+
+} // namespace g6502
+
+#endif // G6502_TRACE_INL_H_
@@ -48,7 +48,7 @@ void Audio::Init()
 {
 //    if (SDL_Init(SDL_INIT_AUDIO) < 0)
 //    {
-//        Log("--> ** SDL Audio not initialized");
+//        LogError(kLogAudio, "--> ** SDL Audio not initialized");
 //    }
 //
 //    atexit(SDL_Quit);
@@ -45,6 +45,8 @@ Cartridge::Cartridge()
     chr_rom_bank_count_ = 0;
     trainer_present_ = false;
     battery_present_ = false;
+    chr_ram_ = false;
+    mirroring_ = kMirroringHorizontal;
     mapper_ = 0;
 }
 
@@ -77,6 +79,8 @@ void Cartridge::Reset()
     chr_rom_bank_count_ = 0;
     trainer_present_ = false;
     battery_present_ = false;
+    chr_ram_ = false;
+    mirroring_ = kMirroringHorizontal;
     mapper_ = 0;
 }
 
@@ -120,6 +124,16 @@ int Cartridge::GetCHRROMBankCount() const
     return chr_rom_bank_count_;
 }
 
+bool Cartridge::HasCHRRAM() const
+{
+    return chr_ram_;
+}
+
+NES_Mirroring Cartridge::GetMirroring() const
+{
+    return mirroring_;
+}
+
 u8* Cartridge::GetTrainer() const
 {
     return trainer_;
@@ -146,7 +160,7 @@ bool Cartridge::LoadFromZipFile(const u8* buffer, int size)
     status = mz_zip_reader_init_mem(&zip_archive, static_cast<const void*>(buffer), static_cast<size_t>(size), 0);
     if (!status)
     {
-        Log("mz_zip_reader_init_mem() failed!");
+        LogError(kLogCartridge, "mz_zip_reader_init_mem() failed!");
         return false;
     }
 
@@ -155,12 +169,12 @@ bool Cartridge::LoadFromZipFile(const u8* buffer, int size)
         mz_zip_archive_file_stat file_stat;
         if (!mz_zip_reader_file_stat(&zip_archive, i, &file_stat))
         {
-            Log("mz_zip_reader_file_stat() failed!");
+            LogError(kLogCartridge, "mz_zip_reader_file_stat() failed!");
             mz_zip_reader_end(&zip_archive);
             return false;
         }
 
-        Log("ZIP Content - Filename: \"%s\", Comment: \"%s\", Uncompressed size: %u, Compressed size: %u", file_stat.m_filename, file_stat.m_comment, static_cast<unsigned int>(file_stat.m_uncomp_size), static_cast<unsigned int>(file_stat.m_comp_size));
+        LogInfo(kLogCartridge, "ZIP Content - Filename: \"%s\", Comment: \"%s\", Uncompressed size: %u, Compressed size: %u", file_stat.m_filename, file_stat.m_comment, static_cast<unsigned int>(file_stat.m_uncomp_size), static_cast<unsigned int>(file_stat.m_comp_size));
 
         string fn(static_cast<const char*>(file_stat.m_filename));
         transform(fn.begin(), fn.end(), fn.begin(), [](unsigned char c){ return tolower(c); });
@@ -174,7 +188,7 @@ bool Cartridge::LoadFromZipFile(const u8* buffer, int size)
             p = mz_zip_reader_extract_file_to_heap(&zip_archive, file_stat.m_filename, &uncomp_size, 0);
             if (!p)
             {
-                Log("mz_zip_reader_extract_file_to_heap() failed!");
+                LogError(kLogCartridge, "mz_zip_reader_extract_file_to_heap() failed!");
                 mz_zip_reader_end(&zip_archive);
                 return false;
             }
@@ -194,7 +208,7 @@ bool Cartridge::LoadFromFile(const char* path)
 {
     using namespace std;
 
-    Log("Loading %s...", path);
+    LogInfo(kLogCartridge, "Loading %s...", path);
 
     Reset();
 
@@ -239,7 +253,7 @@ bool Cartridge::LoadFromFile(const char* path)
 
         if (extension == "zip")
         {
-            Log("Loading from ZIP...");
+            LogInfo(kLogCartridge, "Loading from ZIP...");
             ready_ = LoadFromZipFile(reinterpret_cast<u8*> (memblock), size);
         }
         else
@@ -249,18 +263,18 @@ bool Cartridge::LoadFromFile(const char* path)
 
         if (ready_)
         {
-            Log("ROM loaded", path);
+            LogInfo(kLogCartridge, "ROM loaded");
         }
         else
         {
-            Log("There was a problem loading the memory for file %s...", path);
+            LogError(kLogCartridge, "There was a problem loading the memory for file %s...", path);
         }
 
         SafeDeleteArray(memblock);
     }
     else
     {
-        Log("There was a problem loading the file %s...", path);
+        LogError(kLogCartridge, "There was a problem loading the file %s...", path);
         ready_ = false;
     }
 
@@ -283,7 +297,7 @@ bool Cartridge::LoadFromBuffer(const u8* buffer, int size)
 
         if (TestValid())
         {
-            Log("ROM is Valid.");
+            LogInfo(kLogCartridge, "ROM is Valid.");
 
             GatherMetadata();
 
@@ -299,13 +313,22 @@ bool Cartridge::LoadFromBuffer(const u8* buffer, int size)
             offset += prg_rom_size_;
 
             chr_rom_ = new u8[chr_rom_size_];
-            memcpy(chr_rom_, buffer + offset, static_cast<size_t>(chr_rom_size_));
 
+            if (chr_ram_)
+            {
+                memset(chr_rom_, 0, static_cast<size_t>(chr_rom_size_));
+            }
+            else
+            {
+                memcpy(chr_rom_, buffer + offset, static_cast<size_t>(chr_rom_size_));
+            }
+
+            ready_ = true;
             return true;
         }
         else
         {
-            Log("ROM is NOT Valid. No header found");
+            LogError(kLogCartridge, "ROM is NOT Valid. No header found");
         }
     }
 
@@ -328,31 +351,47 @@ void Cartridge::GatherMetadata()
     chr_rom_bank_count_ = header_[5];
     u8 flags_6 = header_[6];
     u8 flags_7 = header_[7];
-    u8 prg_ram_bank_count = header_[8];
-    u8 flags_9 = header_[9];
-    u8 flags_10 = header_[10];
 
     mapper_ = (flags_6 >> 4) | (flags_7 & 0xF0);
-    Log("Mapper: %d", mapper_);
+    LogInfo(kLogCartridge, "Mapper: %d", mapper_);
 
     prg_rom_size_ = prg_rom_bank_count_ * 16 * 1024;
-    Log("PRG ROM, banks: %d size: %d", prg_rom_bank_count_, prg_rom_size_);
+    LogInfo(kLogCartridge, "PRG ROM, banks: %d size: %d", prg_rom_bank_count_, prg_rom_size_);
 
     chr_rom_size_ = chr_rom_bank_count_ * 8 * 1024;
-    Log("CHR ROM, banks: %d size: %d", chr_rom_bank_count_, chr_rom_size_);
+    LogInfo(kLogCartridge, "CHR ROM, banks: %d size: %d", chr_rom_bank_count_, chr_rom_size_);
+
+    // No CHR-ROM means the board carries 8KB of CHR-RAM instead
+    chr_ram_ = (chr_rom_bank_count_ == 0);
+
+    if (chr_ram_)
+    {
+        chr_rom_size_ = 8 * 1024;
+        LogInfo(kLogCartridge, "CHR RAM, size: %d", chr_rom_size_);
+    }
+
+    if ((flags_6 & 0x08) != 0)
+    {
+        mirroring_ = kMirroringFourScreen;
+    }
+    else
+    {
+        mirroring_ = ((flags_6 & 0x01) != 0) ? kMirroringVertical : kMirroringHorizontal;
+    }
+    LogInfo(kLogCartridge, "Mirroring: %d", mirroring_);
 
-    Log("PRG RAM banks: %d", prg_ram_bank_count);
+    LogInfo(kLogCartridge, "PRG RAM banks: %d", header_[8]);
 
     battery_present_ = ((flags_6 & 0x02) != 0);
-    Log("Battery: %s", battery_present_ ? "YES" : "NO");
+    LogInfo(kLogCartridge, "Battery: %s", battery_present_ ? "YES" : "NO");
 
     trainer_present_ = ((flags_6 & 0x04) != 0);
-    Log("Trainer: %s", trainer_present_ ? "YES" : "NO");
+    LogInfo(kLogCartridge, "Trainer: %s", trainer_present_ ? "YES" : "NO");
 
-    Log("Header byte #6: 0x%08X", flags_6);
-    Log("Header byte #7: 0x%08X", flags_7);
-    Log("Header byte #9: 0x%08X", flags_9);
-    Log("Header byte #10: 0x%08X", flags_10);
+    LogDebug(kLogCartridge, "Header byte #6: 0x%08X", flags_6);
+    LogDebug(kLogCartridge, "Header byte #7: 0x%08X", flags_7);
+    LogDebug(kLogCartridge, "Header byte #9: 0x%08X", header_[9]);
+    LogDebug(kLogCartridge, "Header byte #10: 0x%08X", header_[10]);
 }
 
 } // namespace Gearnes
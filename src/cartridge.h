@@ -25,6 +25,15 @@
 namespace Gearnes
 {
 
+enum NES_Mirroring
+{
+    kMirroringHorizontal,
+    kMirroringVertical,
+    kMirroringFourScreen,
+    kMirroringSingleScreenLow,
+    kMirroringSingleScreenHigh
+};
+
 class Cartridge
 {
 public:
@@ -42,6 +51,8 @@ public:
     u8* GetCHRROM() const;
     int GetCHRROMSize() const;
     int GetCHRROMBankCount() const;
+    bool HasCHRRAM() const;
+    NES_Mirroring GetMirroring() const;
     u8* GetTrainer() const;
     bool LoadFromFile(const char* path);
     bool LoadFromBuffer(const u8* buffer, int size);
@@ -67,6 +78,8 @@ private:
     char file_name_[512];
     bool trainer_present_;
     bool battery_present_;
+    bool chr_ram_;
+    NES_Mirroring mirroring_;
     u8 mapper_;
 };
 
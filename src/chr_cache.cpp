@@ -0,0 +1,65 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "chr_cache.h"
+
+namespace Gearnes
+{
+
+CHRCache::CHRCache()
+{
+    InitPointer(chr_);
+    InitPointer(decoded_);
+    size_ = 0;
+}
+
+CHRCache::~CHRCache()
+{
+    SafeDeleteArray(decoded_);
+}
+
+void CHRCache::Build(const u8* chr, int size)
+{
+    if (size != size_)
+    {
+        SafeDeleteArray(decoded_);
+        // 16 bytes of bitplanes become 64 pixels
+        decoded_ = new u8[size * 4];
+        size_ = size;
+    }
+
+    chr_ = chr;
+
+    int tiles = size >> 4;
+
+    for (int tile = 0; tile < tiles; tile++)
+    {
+        InvalidateTile(tile);
+    }
+}
+
+void CHRCache::InvalidateTile(int tile)
+{
+    for (int row = 0; row < 8; row++)
+    {
+        DecodeRow(tile, row);
+    }
+}
+
+} // namespace Gearnes
@@ -0,0 +1,78 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef CHR_CACHE_H_
+#define	CHR_CACHE_H_
+
+#include "common.h"
+
+namespace Gearnes
+{
+
+// Pattern tables decoded from the two bitplanes into one byte per pixel
+// (0-3), 8 bytes per tile row, so a row is fetched with a single load.
+// It covers the whole CHR memory, so CHR bank switches only move the
+// address used to look it up.
+class CHRCache
+{
+public:
+    CHRCache();
+    ~CHRCache();
+    void Build(const u8* chr, int size);
+    void Update(int address);
+    void InvalidateTile(int tile);
+    const u8* GetRow(int address) const;
+
+private:
+    void DecodeRow(int tile, int row);
+
+private:
+    const u8* chr_;
+    int size_;
+    u8* decoded_;
+};
+
+// Decoded pixels for the row whose low bitplane byte is at address
+inline const u8* CHRCache::GetRow(int address) const
+{
+    return decoded_ + (((address >> 4) << 6) | ((address & 0x07) << 3));
+}
+
+// CHR-RAM writes only change the row they land on
+inline void CHRCache::Update(int address)
+{
+    DecodeRow(address >> 4, address & 0x07);
+}
+
+inline void CHRCache::DecodeRow(int tile, int row)
+{
+    u8 low = chr_[(tile << 4) + row];
+    u8 high = chr_[(tile << 4) + row + 8];
+    u8* pixels = decoded_ + (tile << 6) + (row << 3);
+
+    for (int i = 0; i < 8; i++)
+    {
+        int bit = 7 - i;
+        pixels[i] = ((low >> bit) & 0x01) | (((high >> bit) & 0x01) << 1);
+    }
+}
+
+} // namespace Gearnes
+
+#endif // CHR_CACHE_H_
@@ -23,7 +23,9 @@
 namespace Gearnes
 {
 
-#define DEBUG_GEARNES 1
+#ifndef GEARNES_DISABLE_DEBUG
+    #define DEBUG_GEARNES 1
+#endif
 
 #ifdef DEBUG_GEARNES
     #define DISASM_GEARNES 1
@@ -0,0 +1,314 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <cstring>
+#include "compositor.h"
+
+#ifdef GEARNES_COMPOSITOR_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define GEARNES_TARGET_AVX2
+    #else
+        #define GEARNES_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace Gearnes
+{
+
+static inline int ComposeScalar(const stCompositorLine& line, int x_start, int x_end)
+{
+    int hit = -1;
+
+    for (int x = x_start; x < x_end; x++)
+    {
+        u8 background = (x >= line.background_start) ? line.background[x] : 0;
+        u8 sprite = (x >= line.sprites_start) ? line.sprites[x] : 0;
+        u8 index = background;
+
+        if ((sprite != 0) && ((background == 0) || ((sprite & 0x40) == 0)))
+        {
+            index = sprite & 0x1F;
+        }
+
+        if ((hit < 0) && ((sprite & 0x80) != 0) && (background != 0) && (x != 255))
+        {
+            hit = x;
+        }
+
+        if (IsValidPointer(line.output))
+        {
+            line.output[x] = line.colors[index];
+        }
+        else
+        {
+            line.indexed_output[x] = line.indexes[index];
+        }
+    }
+
+    return hit;
+}
+
+#ifdef GEARNES_COMPOSITOR_X86
+
+// kEnableMask + 32 - n: n leading zero bytes, then 0xFF
+static const u8 kEnableMask[64] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// Pixels disabled by clipping at the start of a chunk, 0 to width
+static inline const u8* EnableMask(int x, int start, int width)
+{
+    int disabled = start - x;
+    disabled = (disabled < 0) ? 0 : ((disabled > width) ? width : disabled);
+    return kEnableMask + 32 - disabled;
+}
+
+static inline int FirstHit(unsigned int hits, int x, int width)
+{
+    // No hit at x = 255
+    if ((x + width) > 255)
+    {
+        hits &= ~(1u << (255 - x));
+    }
+
+    if (hits == 0)
+    {
+        return -1;
+    }
+
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward(&bit, hits);
+    return x + static_cast<int>(bit);
+#else
+    return x + __builtin_ctz(hits);
+#endif
+}
+
+// 16 pixels at x. Inlined in the AVX2 path too, so it gets VEX encoding
+// there and the tails don't pay SSE/AVX transitions.
+static inline int ComposeChunk16(const stCompositorLine& line, int x)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i behind = _mm_set1_epi8(0x40);
+    const __m128i sprite0 = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i entry = _mm_set1_epi8(0x1F);
+
+    __m128i background_enable = _mm_loadu_si128(reinterpret_cast<const __m128i*>(EnableMask(x, line.background_start, 16)));
+    __m128i sprites_enable = _mm_loadu_si128(reinterpret_cast<const __m128i*>(EnableMask(x, line.sprites_start, 16)));
+    __m128i background = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line.background + x)), background_enable);
+    __m128i sprite = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line.sprites + x)), sprites_enable);
+
+    __m128i transparent = _mm_cmpeq_epi8(background, zero);
+    __m128i front = _mm_cmpeq_epi8(_mm_and_si128(sprite, behind), zero);
+    __m128i use_sprite = _mm_andnot_si128(_mm_cmpeq_epi8(sprite, zero), _mm_or_si128(transparent, front));
+    __m128i index = _mm_or_si128(_mm_and_si128(use_sprite, _mm_and_si128(sprite, entry)), _mm_andnot_si128(use_sprite, background));
+    __m128i hits = _mm_andnot_si128(transparent, _mm_cmpeq_epi8(_mm_and_si128(sprite, sprite0), sprite0));
+
+    // No byte shuffle in SSE2, the palette lookup stays scalar
+    u8 indexes[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indexes), index);
+
+    if (IsValidPointer(line.output))
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            line.output[x + i] = line.colors[indexes[i]];
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            line.indexed_output[x + i] = line.indexes[indexes[i]];
+        }
+    }
+
+    return FirstHit(static_cast<unsigned int>(_mm_movemask_epi8(hits)), x, 16);
+}
+
+static inline int ComposeTail(const stCompositorLine& line, int x, int x_end, int hit)
+{
+    for (; (x + 16) <= x_end; x += 16)
+    {
+        int chunk_hit = ComposeChunk16(line, x);
+        hit = (hit < 0) ? chunk_hit : hit;
+    }
+
+    if (x < x_end)
+    {
+        int tail = ComposeScalar(line, x, x_end);
+        hit = (hit < 0) ? tail : hit;
+    }
+
+    return hit;
+}
+
+static int ComposeSSE2(const stCompositorLine& line, int x_start, int x_end)
+{
+    return ComposeTail(line, x_start, x_end, -1);
+}
+
+GEARNES_TARGET_AVX2 static inline __m256i LookupColors(__m256i index, __m256i c0, __m256i c1, __m256i c2, __m256i c3)
+{
+    // 32 entry table as four 8 entry registers, picked by index bits 3 and 4
+    __m256i low = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(c0, index), _mm256_permutevar8x32_epi32(c1, index),
+            _mm256_srai_epi32(_mm256_slli_epi32(index, 28), 31));
+    __m256i high = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(c2, index), _mm256_permutevar8x32_epi32(c3, index),
+            _mm256_srai_epi32(_mm256_slli_epi32(index, 28), 31));
+    return _mm256_blendv_epi8(low, high, _mm256_srai_epi32(_mm256_slli_epi32(index, 27), 31));
+}
+
+GEARNES_TARGET_AVX2 static int ComposeAVX2(const stCompositorLine& line, int x_start, int x_end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i behind = _mm256_set1_epi8(0x40);
+    const __m256i sprite0 = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i entry = _mm256_set1_epi8(0x1F);
+
+    const __m256i* colors = reinterpret_cast<const __m256i*>(line.colors);
+    __m256i c0 = _mm256_loadu_si256(colors + 0);
+    __m256i c1 = _mm256_loadu_si256(colors + 1);
+    __m256i c2 = _mm256_loadu_si256(colors + 2);
+    __m256i c3 = _mm256_loadu_si256(colors + 3);
+
+    // 32 entry index table as two 16 byte shuffles, picked by index bit 4
+    __m256i indexes_low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line.indexes)));
+    __m256i indexes_high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(line.indexes + 16)));
+    const __m256i entry_high = _mm256_set1_epi8(0x10);
+    bool indexed = !IsValidPointer(line.output);
+
+    int hit = -1;
+    int x = x_start;
+
+    for (; (x + 32) <= x_end; x += 32)
+    {
+        __m256i background_enable = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(EnableMask(x, line.background_start, 32)));
+        __m256i sprites_enable = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(EnableMask(x, line.sprites_start, 32)));
+        __m256i background = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(line.background + x)), background_enable);
+        __m256i sprite = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(line.sprites + x)), sprites_enable);
+
+        __m256i transparent = _mm256_cmpeq_epi8(background, zero);
+        __m256i front = _mm256_cmpeq_epi8(_mm256_and_si256(sprite, behind), zero);
+        __m256i use_sprite = _mm256_andnot_si256(_mm256_cmpeq_epi8(sprite, zero), _mm256_or_si256(transparent, front));
+        __m256i index = _mm256_blendv_epi8(background, _mm256_and_si256(sprite, entry), use_sprite);
+
+        if (hit < 0)
+        {
+            __m256i hits = _mm256_andnot_si256(transparent, _mm256_cmpeq_epi8(_mm256_and_si256(sprite, sprite0), sprite0));
+            hit = FirstHit(static_cast<unsigned int>(_mm256_movemask_epi8(hits)), x, 32);
+        }
+
+        if (indexed)
+        {
+            __m256i high = _mm256_cmpeq_epi8(_mm256_and_si256(index, entry_high), entry_high);
+            __m256i value = _mm256_blendv_epi8(_mm256_shuffle_epi8(indexes_low, index), _mm256_shuffle_epi8(indexes_high, index), high);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(line.indexed_output + x), value);
+            continue;
+        }
+
+        __m128i index_low = _mm256_castsi256_si128(index);
+        __m128i index_high = _mm256_extracti128_si256(index, 1);
+        __m256i* output = reinterpret_cast<__m256i*>(line.output + x);
+
+        _mm256_storeu_si256(output + 0, LookupColors(_mm256_cvtepu8_epi32(index_low), c0, c1, c2, c3));
+        _mm256_storeu_si256(output + 1, LookupColors(_mm256_cvtepu8_epi32(_mm_srli_si128(index_low, 8)), c0, c1, c2, c3));
+        _mm256_storeu_si256(output + 2, LookupColors(_mm256_cvtepu8_epi32(index_high), c0, c1, c2, c3));
+        _mm256_storeu_si256(output + 3, LookupColors(_mm256_cvtepu8_epi32(_mm_srli_si128(index_high, 8)), c0, c1, c2, c3));
+    }
+
+    return ComposeTail(line, x, x_end, hit);
+}
+
+static bool CPUHasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then the OS must save the YMM state
+    if (((info[2] & (1 << 27)) == 0) || ((info[2] & (1 << 28)) == 0))
+        return false;
+    if ((_xgetbv(0) & 0x06) != 0x06)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // GEARNES_COMPOSITOR_X86
+
+CompositorFunction GetCompositor(Compositor_Path path)
+{
+    switch (path)
+    {
+        case kCompositorScalar:
+            return ComposeScalar;
+#ifdef GEARNES_COMPOSITOR_X86
+        case kCompositorSSE2:
+            return ComposeSSE2;
+        case kCompositorAVX2:
+            return CPUHasAVX2() ? ComposeAVX2 : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+Compositor_Path GetBestCompositorPath()
+{
+    for (int i = kCompositorPathCount - 1; i > kCompositorScalar; i--)
+    {
+        Compositor_Path path = static_cast<Compositor_Path>(i);
+
+        if (IsValidPointer(GetCompositor(path)))
+        {
+            return path;
+        }
+    }
+
+    return kCompositorScalar;
+}
+
+const char* GetCompositorPathName(Compositor_Path path)
+{
+    switch (path)
+    {
+        case kCompositorScalar:
+            return "scalar";
+        case kCompositorSSE2:
+            return "sse2";
+        case kCompositorAVX2:
+            return "avx2";
+        default:
+            return "unknown";
+    }
+}
+
+} // namespace Gearnes
@@ -0,0 +1,69 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef COMPOSITOR_H_
+#define	COMPOSITOR_H_
+
+#include "common.h"
+#include "video.h"
+
+#if !defined(GEARNES_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define GEARNES_COMPOSITOR_X86 1
+#endif
+
+namespace Gearnes
+{
+
+enum Compositor_Path
+{
+    kCompositorScalar,
+    kCompositorSSE2,
+    kCompositorAVX2,
+    kCompositorPathCount
+};
+
+// One visible line ready to be mixed. background and sprites are indexed
+// by x. Background values are palette entries 0x00-0x0F (0 transparent),
+// sprite values carry the entry in bits 0-4, bit 6 behind background and
+// bit 7 sprite 0. Pixels left of background_start / sprites_start are
+// clipped (256 hides the whole layer). Pixels go to output as colors, or
+// to indexed_output as 6-bit palette indexes when output is null.
+struct stCompositorLine
+{
+    const u8* background;
+    const u8* sprites;
+    const NES_Color* colors;
+    const u8* indexes;
+    NES_Color* output;
+    u8* indexed_output;
+    int background_start;
+    int sprites_start;
+};
+
+// Writes pixels [x_start, x_end) and returns the first x with a sprite 0
+// hit, or -1
+typedef int (*CompositorFunction)(const stCompositorLine& line, int x_start, int x_end);
+
+CompositorFunction GetCompositor(Compositor_Path path);
+Compositor_Path GetBestCompositorPath();
+const char* GetCompositorPathName(Compositor_Path path);
+
+} // namespace Gearnes
+
+#endif // COMPOSITOR_H_
@@ -22,10 +22,22 @@
 #include "memory.h"
 #include "audio.h"
 #include "video.h"
+#include "palette.h"
 #include "input.h"
 #include "cartridge.h"
 #include "mapper.h"
 #include "mappers/nrom.h"
+#include "trace_file.h"
+#include "video_pipeline.h"
+#include "G6502/g6502_core_inl.h"
+
+namespace g6502
+{
+
+// Bus accesses are resolved at compile time and inlined
+template class G6502<Gearnes::Memory>;
+
+} // namespace g6502
 
 namespace Gearnes
 {
@@ -34,10 +46,14 @@ GearnesCore::GearnesCore()
 {
     InitPointer(memory_);
     InitPointer(g6502_);
+    InitPointer(scheduler_);
     InitPointer(audio_);
     InitPointer(video_);
     InitPointer(input_);
     InitPointer(cartridge_);
+    InitPointer(trace_);
+    InitPointer(pipeline_);
+    threaded_rendering_ = false;
 
     for (int i = 0; i < 256; i++)
     {
@@ -46,12 +62,15 @@ GearnesCore::GearnesCore()
 
     paused_ = true;
     current_mapper_ = 0;
+    frame_idle_cycles_ = 0;
 }
 
 GearnesCore::~GearnesCore()
 {
 
     MemoryDump();
+    StopTrace();
+    SafeDelete(trace_);
 
     for (int i = 0; i < 256; i++)
     {
@@ -60,47 +79,103 @@ GearnesCore::~GearnesCore()
 
     SafeDelete(cartridge_);
     SafeDelete(input_);
+    SafeDelete(pipeline_);
     SafeDelete(video_);
     SafeDelete(audio_);
+    SafeDelete(scheduler_);
     SafeDelete(g6502_);
     SafeDelete(memory_);
 }
 
 void GearnesCore::Init()
 {
-    Log("-=:: %s ::=-", GEARNES_TITLE);
+    LogInfo(kLogCore, "-=:: %s ::=-", GEARNES_TITLE);
 
     cartridge_ = new Cartridge();
     video_ = new Video();
     memory_ = new Memory(video_);
-    g6502_ = new g6502::G6502();
+    g6502_ = new g6502::G6502<Memory>();
+    scheduler_ = new Scheduler();
     audio_ = new Audio();    
     input_ = new Input();
+    trace_ = new TraceFileWriter();
 
     cartridge_->Init();
     memory_->Init();
+    memory_->SetProcessor(g6502_);
     g6502_->Init(memory_);
+    g6502_->EnableIdleLoopDetection(true);
+    scheduler_->Init(g6502_);
     audio_->Init();
-    video_->Init();
+    video_->Init(cartridge_, scheduler_, g6502_);
     input_->Init();
 
     InitMappers();
 }
 
+// A nullptr frame_buffer runs the frame without rendering it, for
+// fast-forward and frameskip. Everything the CPU can see, VBlank, sprite 0
+// hit and sprite overflow included, stays exact.
 void GearnesCore::RunToVBlank(NES_Color* frame_buffer)
 {
     if (!paused_ && cartridge_->IsReady())
     {
-        bool vblank = false;
-        while (!vblank)
+        video_->SetFrameBuffer(frame_buffer);
+        RunFrame();
+    }
+}
+
+// frame_buffer holds NES_INDEXED_FRAME_SIZE bytes, GetPalette() converts it.
+// nullptr skips rendering as in RunToVBlank().
+void GearnesCore::RunToVBlankIndexed(u8* frame_buffer)
+{
+    if (!paused_ && cartridge_->IsReady())
+    {
+        video_->SetIndexedFrameBuffer(frame_buffer);
+        RunFrame();
+    }
+}
+
+void GearnesCore::RunFrame()
+{
+    u64 frame_start = scheduler_->GetClockCycles();
+    bool vblank = false;
+    g6502::stIdleLoopStats idle_start;
+    g6502_->GetIdleLoopStats(&idle_start);
+
+    // The CPU runs uninterrupted between events
+    while (!vblank)
+    {
+        scheduler_->RunToNextEvent();
+
+        switch (scheduler_->PopEvent())
         {
-            unsigned int clock_cycles = g6502_->Tick();
-            vblank = video_->Tick(clock_cycles, frame_buffer);
-            audio_->Tick(clock_cycles);
-            input_->Tick(clock_cycles);
+            case kSchedulerEventVBlank:
+                video_->StartVBlank();
+                vblank = true;
+                break;
+            case kSchedulerEventSprite0Hit:
+                video_->Sprite0Hit();
+                break;
+            case kSchedulerEventMapperIRQ:
+                // A12 clocked IRQs depend on what the PPU fetched
+                video_->CatchUp();
+                break;
+            case kSchedulerEventRenderSync:
+                video_->SyncPipeline();
+                break;
+            default:
+                break;
         }
-        audio_->EndFrame();
     }
+
+    g6502::stIdleLoopStats idle_end;
+    g6502_->GetIdleLoopStats(&idle_end);
+    frame_idle_cycles_ = static_cast<unsigned int>(idle_end.skipped_t_states - idle_start.skipped_t_states);
+
+    u64 frame_cycles = scheduler_->GetClockCycles() - frame_start;
+    audio_->Tick(static_cast<unsigned int>(frame_cycles / kMasterCyclesPerCPUCycle));
+    audio_->EndFrame();
 }
 
 bool GearnesCore::LoadROM(const char* path)
@@ -114,6 +189,18 @@ bool GearnesCore::LoadROM(const char* path)
     return loaded;
 }
 
+bool GearnesCore::LoadROMFromBuffer(const u8* buffer, int size)
+{
+    MemoryDump();
+
+    cartridge_->Reset();
+    bool loaded = cartridge_->LoadFromBuffer(buffer, size);
+
+    Reset();
+
+    return loaded;
+}
+
 Memory* GearnesCore::GetMemory()
 {
     return memory_;
@@ -124,6 +211,117 @@ Cartridge* GearnesCore::GetCartridge()
     return cartridge_;
 }
 
+Palette* GearnesCore::GetPalette()
+{
+    return video_->GetPalette();
+}
+
+u64 GearnesCore::GetClockCycles()
+{
+    return scheduler_->GetClockCycles() / kMasterCyclesPerCPUCycle;
+}
+
+void GearnesCore::EnableInstructionCache(bool enabled)
+{
+    g6502_->EnableInstructionCache(enabled);
+}
+
+void GearnesCore::GetInstructionCacheStats(g6502::stInstructionCacheStats* stats)
+{
+    g6502_->GetInstructionCacheStats(stats);
+}
+
+bool GearnesCore::EnableJIT(bool enabled)
+{
+    return g6502_->EnableJIT(enabled);
+}
+
+void GearnesCore::GetJITStats(g6502::stJITStats* stats)
+{
+    g6502_->GetJITStats(stats);
+}
+
+// On by default, it doesn't change emulation. Loops run by the JIT are
+// not skipped.
+void GearnesCore::EnableIdleLoopDetection(bool enabled)
+{
+    g6502_->EnableIdleLoopDetection(enabled);
+}
+
+void GearnesCore::GetIdleLoopStats(g6502::stIdleLoopStats* stats)
+{
+    g6502_->GetIdleLoopStats(stats);
+}
+
+unsigned int GearnesCore::GetFrameIdleCycles()
+{
+    return frame_idle_cycles_;
+}
+
+void GearnesCore::EnableInstructionFusion(bool enabled)
+{
+    g6502_->EnableInstructionFusion(enabled);
+}
+
+void GearnesCore::GetFusionStats(g6502::stFusionStats* stats)
+{
+    g6502_->GetFusionStats(stats);
+}
+
+// Renders on a second thread, see VideoPipeline. Frames come out the
+// same. Takes effect on the next ROM load or ResetROM(), the render
+// thread has to start from the same state as the PPU.
+void GearnesCore::EnableThreadedRendering(bool enabled)
+{
+    threaded_rendering_ = enabled;
+}
+
+bool GearnesCore::IsThreadedRendering()
+{
+    return IsValidPointer(pipeline_);
+}
+
+// Only available in G6502_PROFILER builds, emulation runs much slower
+// while it is enabled
+bool GearnesCore::EnableProfiler(bool enabled)
+{
+    return g6502_->EnableProfiler(enabled);
+}
+
+g6502::Profiler* GearnesCore::GetProfiler()
+{
+    return g6502_->GetProfiler();
+}
+
+// Writes every instruction the CPU runs to file_path until StopTrace(),
+// render it with the gearnes-trace tool
+bool GearnesCore::StartTrace(const char* file_path)
+{
+    StopTrace();
+
+    if (!trace_->Open(file_path))
+        return false;
+
+    g6502_->SetTraceBuffer(trace_->GetBuffer(), GetClockCycles());
+
+    return true;
+}
+
+void GearnesCore::StopTrace()
+{
+    if (IsValidPointer(trace_) && trace_->IsOpen())
+    {
+        g6502_->SetTraceBuffer(nullptr, 0);
+        trace_->Close();
+    }
+}
+
+// Stats of the last trace are kept after StopTrace()
+TraceFileWriter* GearnesCore::GetTrace()
+{
+    return trace_;
+}
+
 void GearnesCore::KeyPressed(NES_Joypads joypad, NES_Keys key)
 {
     input_->KeyPressed(joypad, key);
@@ -138,11 +336,11 @@ void GearnesCore::Pause(bool paused)
 {
     if (paused)
     {
-        Log("PAUSED");
+        LogInfo(kLogCore, "PAUSED");
     }
     else
     {
-        Log("RESUMED");
+        LogInfo(kLogCore, "RESUMED");
     }
     paused_ = paused;
 }
@@ -156,7 +354,7 @@ void GearnesCore::ResetROM()
 {
     if (cartridge_->IsReady())
     {
-        Log("RESET");
+        LogInfo(kLogCore, "RESET");
         Reset();
     }
 }
@@ -165,18 +363,18 @@ void GearnesCore::EnableSound(bool enabled)
 {
     if (enabled)
     {
-        Log("Sound ENABLED");
+        LogInfo(kLogCore, "Sound ENABLED");
     }
     else
     {
-        Log("Sound DISABLED");
+        LogInfo(kLogCore, "Sound DISABLED");
     }
     audio_->Enable(enabled);
 }
 
 void GearnesCore::SetSoundSampleRate(int rate)
 {
-    Log("Sound sample rate: %d", rate);
+    LogInfo(kLogCore, "Sound sample rate: %d", rate);
     audio_->SetSampleRate(rate);
 }
 
@@ -218,21 +416,35 @@ bool GearnesCore::SetupMapper()
         default:
             supported = false;
             current_mapper_ = 0;
-            Log("Mapper not supported: %d", mapper);
+            LogError(kLogCore, "Mapper not supported: %d", mapper);
             break;
     }
 
     memory_->SetCurrentMapper(mappers_[current_mapper_]);
+    mappers_[current_mapper_]->Reset();
 
     return supported;
 }
 
 void GearnesCore::Reset()
 {
+    if (threaded_rendering_ && !IsValidPointer(pipeline_))
+    {
+        pipeline_ = new VideoPipeline();
+        pipeline_->Init(cartridge_, video_->GetPalette());
+        video_->SetPipeline(pipeline_);
+    }
+    else if (!threaded_rendering_ && IsValidPointer(pipeline_))
+    {
+        video_->SetPipeline(nullptr);
+        SafeDelete(pipeline_);
+    }
+
+    scheduler_->Reset();
     memory_->Reset();
+    video_->Reset();
     SetupMapper();
     audio_->Reset();
-    video_->Reset();
     input_->Reset();
     g6502_->Reset();
     paused_ = false;
@@ -243,7 +455,7 @@ void GearnesCore::MemoryDump()
 #ifdef DEBUG_GEARNES
     if (cartridge_->IsReady())
     {
-        Log("Saving Memory Dump...");
+        LogInfo(kLogCore, "Saving Memory Dump...");
 
         using namespace std;
 
@@ -254,7 +466,7 @@ void GearnesCore::MemoryDump()
 
         memory_->MemoryDump(dmp_path);
 
-        Log("Memory Dump Saved");
+        LogInfo(kLogCore, "Memory Dump Saved");
     }
 #endif
 }
@@ -266,7 +478,7 @@ void GearnesCore::InitMappers()
         InitPointer(mappers_[i]);
     }
 
-    mappers_[0] = new NROMMapper(memory_, cartridge_);
+    mappers_[0] = new NROMMapper(memory_, video_, cartridge_);
 }
 
 } // namespace Gearnes
@@ -23,6 +23,7 @@
 #include "common.h"
 #include "video.h"
 #include "input.h"
+#include "scheduler.h"
 #include "G6502/g6502_core.h"
 
 namespace Gearnes
@@ -37,8 +38,11 @@ enum NES_System
 
 class Memory;
 class Audio;
+class TraceFileWriter;
 class Cartridge;
 class Mapper;
+class Palette;
+class VideoPipeline;
 
 class GearnesCore
 {
@@ -47,9 +51,29 @@ public:
     ~GearnesCore();
     void Init();
     void RunToVBlank(NES_Color* frame_buffer);
+    void RunToVBlankIndexed(u8* frame_buffer);
     bool LoadROM(const char* path);
+    bool LoadROMFromBuffer(const u8* buffer, int size);
     Memory* GetMemory();
     Cartridge* GetCartridge();
+    Palette* GetPalette();
+    u64 GetClockCycles();
+    void EnableInstructionCache(bool enabled);
+    void GetInstructionCacheStats(g6502::stInstructionCacheStats* stats);
+    bool EnableJIT(bool enabled);
+    void GetJITStats(g6502::stJITStats* stats);
+    void EnableIdleLoopDetection(bool enabled);
+    void GetIdleLoopStats(g6502::stIdleLoopStats* stats);
+    unsigned int GetFrameIdleCycles();
+    void EnableInstructionFusion(bool enabled);
+    void GetFusionStats(g6502::stFusionStats* stats);
+    void EnableThreadedRendering(bool enabled);
+    bool IsThreadedRendering();
+    bool EnableProfiler(bool enabled);
+    g6502::Profiler* GetProfiler();
+    bool StartTrace(const char* file_path);
+    void StopTrace();
+    TraceFileWriter* GetTrace();
     void KeyPressed(NES_Joypads joypad, NES_Keys key);
     void KeyReleased(NES_Joypads joypad, NES_Keys key);
     void Pause(bool paused);
@@ -65,20 +89,27 @@ public:
 
 private:
     void InitMappers();
+    void RunFrame();
     bool SetupMapper();
     void Reset();
     void MemoryDump();
 
 private:
     Memory* memory_;
-    g6502::G6502* g6502_;
+    g6502::G6502<Memory>* g6502_;
+    Scheduler* scheduler_;
     Audio* audio_;
     Video* video_;
     Input* input_;
     Cartridge* cartridge_;
     Mapper* mappers_[256];
+    TraceFileWriter* trace_;
+    VideoPipeline* pipeline_;
+    bool threaded_rendering_;
     bool paused_;
     u8 current_mapper_;
+    // CPU cycles skipped in idle loops during the last frame
+    unsigned int frame_idle_cycles_;
 };
 
 } // namespace Gearnes
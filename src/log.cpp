@@ -0,0 +1,356 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include "log.h"
+
+namespace Gearnes
+{
+
+std::atomic<unsigned int> Logger::categories_((1u << kLogCategoryCount) - 1);
+
+static const char* const kLogLevelPrefixes[] = { "ERROR: ", "WARNING: ", "", "" };
+
+// Bounded queue with many producers and one consumer. Each slot has a
+// sequence number telling whose turn it is: a producer owns slot
+// position when it equals position, the consumer when it equals
+// position + 1. Producers only contend on the compare and swap of
+// enqueue_position_.
+class LogQueue
+{
+public:
+    LogQueue();
+    ~LogQueue();
+    stLogRecord* BeginWrite();
+    void EndWrite(stLogRecord* record);
+    void Flush();
+    unsigned long long GetDropped() const;
+
+private:
+    // record first, Logger only hands out pointers to it
+    struct stSlot
+    {
+        stLogRecord record;
+        std::atomic<unsigned long long> sequence;
+    };
+
+    static const int kSlots = 4096;
+
+    void Run();
+    bool PrintNext();
+
+private:
+    stSlot* slots_;
+    std::atomic<unsigned long long> enqueue_position_;
+    unsigned long long dequeue_position_;
+    std::atomic<unsigned long long> dropped_;
+    std::atomic<bool> running_;
+    std::atomic<unsigned long long> passes_;
+    unsigned long long reported_dropped_;
+    std::thread thread_;
+};
+
+// Created on the first message, the destructor prints what is left when
+// the program exits
+static LogQueue* GetLogQueue()
+{
+    static LogQueue queue;
+    return &queue;
+}
+
+LogQueue::LogQueue()
+{
+    slots_ = new stSlot[kSlots];
+
+    for (int i = 0; i < kSlots; i++)
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+
+    enqueue_position_.store(0);
+    dequeue_position_ = 0;
+    dropped_.store(0);
+    passes_.store(0);
+    reported_dropped_ = 0;
+    running_.store(true);
+    thread_ = std::thread(&LogQueue::Run, this);
+}
+
+LogQueue::~LogQueue()
+{
+    running_.store(false);
+    thread_.join();
+    delete [] slots_;
+}
+
+// nullptr when the queue is full, the message is dropped
+stLogRecord* LogQueue::BeginWrite()
+{
+    unsigned long long position = enqueue_position_.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        stSlot* slot = &slots_[position & (kSlots - 1)];
+        long long difference = static_cast<long long>(slot->sequence.load(std::memory_order_acquire) - position);
+
+        if (difference == 0)
+        {
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                return &slot->record;
+        }
+        else if (difference < 0)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void LogQueue::EndWrite(stLogRecord* record)
+{
+    stSlot* slot = reinterpret_cast<stSlot*>(record);
+    unsigned long long position = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+// Waits until every message logged before the call is printed, drop
+// reports included. Two passes of Run() make sure one started after the
+// call.
+void LogQueue::Flush()
+{
+    unsigned long long passes = passes_.load(std::memory_order_acquire);
+
+    while (passes_.load(std::memory_order_acquire) < passes + 2)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+unsigned long long LogQueue::GetDropped() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+void LogQueue::Run()
+{
+    while (true)
+    {
+        bool stopping = !running_.load();
+        bool printed = false;
+
+        while (PrintNext())
+            printed = true;
+
+        unsigned long long dropped = dropped_.load(std::memory_order_relaxed);
+
+        if (dropped != reported_dropped_)
+        {
+            printf("Log: %llu messages dropped, the queue was full\n", dropped - reported_dropped_);
+            reported_dropped_ = dropped;
+            printed = true;
+        }
+
+        if (printed)
+            fflush(stdout);
+
+        passes_.fetch_add(1, std::memory_order_release);
+
+        if (stopping)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+// Splits format at each conversion and hands snprintf one argument at a
+// time, with the length modifier swapped for the width it was packed with
+static int FormatRecord(const stLogRecord& record, char* buffer, int size)
+{
+    const char* format = record.format;
+    int length = 0;
+    int arg = 0;
+
+    for (int i = 0; (format[i] != 0) && (length < size - 1); )
+    {
+        if (format[i] != '%')
+        {
+            buffer[length++] = format[i++];
+            continue;
+        }
+
+        if (format[i + 1] == '%')
+        {
+            buffer[length++] = '%';
+            i += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision], the length modifier is dropped
+        char spec[32];
+        int spec_length = 0;
+        spec[spec_length++] = format[i++];
+
+        while ((format[i] != 0) && (strchr("-+ #0123456789.", format[i]) != nullptr) && (spec_length < 24))
+            spec[spec_length++] = format[i++];
+
+        int modifier = 0;
+
+        while ((format[i] != 0) && (strchr("hlLqjzt", format[i]) != nullptr))
+            modifier += (format[i++] == 'h') ? -1 : 1;
+
+        char conversion = format[i];
+
+        if (conversion == 0)
+            break;
+
+        i++;
+
+        if (arg >= record.arg_count)
+        {
+            length += snprintf(buffer + length, size - length, "<?>");
+            continue;
+        }
+
+        unsigned long long value = record.args[arg];
+        unsigned char type = record.types[arg];
+        arg++;
+
+        spec[spec_length] = 0;
+        int written = 0;
+
+        if (type == kLogArgString)
+        {
+            spec[spec_length++] = 's';
+            spec[spec_length] = 0;
+            written = snprintf(buffer + length, size - length, spec, record.strings + value);
+        }
+        else if (type == kLogArgPointer)
+        {
+            spec[spec_length++] = 'p';
+            spec[spec_length] = 0;
+            written = snprintf(buffer + length, size - length, spec, reinterpret_cast<void*>(static_cast<uintptr_t>(value)));
+        }
+        else if (type == kLogArgDouble)
+        {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            spec[spec_length++] = (strchr("eEfFgGaA", conversion) != nullptr) ? conversion : 'f';
+            spec[spec_length] = 0;
+            written = snprintf(buffer + length, size - length, spec, d);
+        }
+        else if (conversion == 'c')
+        {
+            spec[spec_length++] = 'c';
+            spec[spec_length] = 0;
+            written = snprintf(buffer + length, size - length, spec, static_cast<int>(value));
+        }
+        else
+        {
+            // Truncate to the width the format asked for, %X of a negative
+            // int shows 32 bits as printf would
+            if (modifier <= -2)
+                value &= 0xFF;
+            else if (modifier == -1)
+                value &= 0xFFFF;
+            else if (modifier == 0)
+                value &= 0xFFFFFFFF;
+
+            bool is_signed = (conversion == 'd') || (conversion == 'i');
+
+            if (is_signed && (modifier <= 0))
+            {
+                int bits = (modifier <= -2) ? 8 : ((modifier == -1) ? 16 : 32);
+                unsigned long long sign = 1ull << (bits - 1);
+                value = (value ^ sign) - sign;
+            }
+
+            spec[spec_length++] = 'l';
+            spec[spec_length++] = 'l';
+            spec[spec_length++] = (strchr("diouxX", conversion) != nullptr) ? conversion : 'u';
+            spec[spec_length] = 0;
+
+            if (is_signed)
+                written = snprintf(buffer + length, size - length, spec, static_cast<long long>(value));
+            else
+                written = snprintf(buffer + length, size - length, spec, value);
+        }
+
+        if (written > 0)
+            length += written;
+    }
+
+    if (length > size - 1)
+        length = size - 1;
+
+    buffer[length] = 0;
+
+    return length;
+}
+
+bool LogQueue::PrintNext()
+{
+    unsigned long long position = dequeue_position_;
+    stSlot* slot = &slots_[position & (kSlots - 1)];
+
+    if (slot->sequence.load(std::memory_order_acquire) != position + 1)
+        return false;
+
+    char message[512];
+    FormatRecord(slot->record, message, sizeof(message));
+    printf("%llu: %s%s\n", position + 1, kLogLevelPrefixes[slot->record.level], message);
+
+    slot->sequence.store(position + kSlots, std::memory_order_release);
+    dequeue_position_ = position + 1;
+
+    return true;
+}
+
+void Logger::SetCategoryEnabled(Log_Category category, bool enabled)
+{
+    if (enabled)
+        categories_.fetch_or(1u << category);
+    else
+        categories_.fetch_and(~(1u << category));
+}
+
+// Blocks until everything logged so far has been printed
+void Logger::Flush()
+{
+    GetLogQueue()->Flush();
+}
+
+// Messages lost because the queue was full
+unsigned long long Logger::GetDropped()
+{
+    return GetLogQueue()->GetDropped();
+}
+
+stLogRecord* Logger::BeginWrite()
+{
+    return GetLogQueue()->BeginWrite();
+}
+
+void Logger::EndWrite(stLogRecord* record)
+{
+    GetLogQueue()->EndWrite(record);
+}
+
+} // namespace Gearnes
@@ -20,29 +20,243 @@
 #ifndef LOG_H_
 #define	LOG_H_
 
-#include <cstdio>
-#include <cstdarg>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
-namespace Gearnes
-{
+// Messages above GEARNES_LOG_LEVEL are compiled out, arguments included.
+// Debug builds keep everything, GEARNES_DISABLE_DEBUG builds nothing.
+#define GEARNES_LOG_NONE 0
+#define GEARNES_LOG_ERROR 1
+#define GEARNES_LOG_WARNING 2
+#define GEARNES_LOG_INFO 3
+#define GEARNES_LOG_DEBUG 4
+
+#ifndef GEARNES_LOG_LEVEL
+    #ifdef DEBUG_GEARNES
+        #define GEARNES_LOG_LEVEL GEARNES_LOG_DEBUG
+    #else
+        #define GEARNES_LOG_LEVEL GEARNES_LOG_NONE
+    #endif
+#endif
+
+// Both forms pass the message to LogFormatCheck() in dead code, so the
+// compiler checks the format against the arguments at every level and
+// compiled out messages still use them, without evaluating them twice
+#define GEARNES_LOG_WRITE(level, category, msg, ...) \
+    do { if (false) Gearnes::LogFormatCheck(msg, ##__VA_ARGS__); Gearnes::Logger::Write(level, category, msg, ##__VA_ARGS__); } while (0)
+#define GEARNES_LOG_DISABLED(category, msg, ...) \
+    do { if (false) { (void)(category); Gearnes::LogFormatCheck(msg, ##__VA_ARGS__); } } while (0)
+
+#if GEARNES_LOG_LEVEL >= GEARNES_LOG_ERROR
+    #define LogError(category, msg, ...) GEARNES_LOG_WRITE(Gearnes::kLogLevelError, category, msg, ##__VA_ARGS__)
+#else
+    #define LogError(category, msg, ...) GEARNES_LOG_DISABLED(category, msg, ##__VA_ARGS__)
+#endif
+
+#if GEARNES_LOG_LEVEL >= GEARNES_LOG_WARNING
+    #define LogWarning(category, msg, ...) GEARNES_LOG_WRITE(Gearnes::kLogLevelWarning, category, msg, ##__VA_ARGS__)
+#else
+    #define LogWarning(category, msg, ...) GEARNES_LOG_DISABLED(category, msg, ##__VA_ARGS__)
+#endif
+
+#if GEARNES_LOG_LEVEL >= GEARNES_LOG_INFO
+    #define LogInfo(category, msg, ...) GEARNES_LOG_WRITE(Gearnes::kLogLevelInfo, category, msg, ##__VA_ARGS__)
+#else
+    #define LogInfo(category, msg, ...) GEARNES_LOG_DISABLED(category, msg, ##__VA_ARGS__)
+#endif
 
-#ifdef DEBUG_GEARNES
-    #define Log(msg, ...) (Gearnes::LogImpl(msg, ##__VA_ARGS__))
+#if GEARNES_LOG_LEVEL >= GEARNES_LOG_DEBUG
+    #define LogDebug(category, msg, ...) GEARNES_LOG_WRITE(Gearnes::kLogLevelDebug, category, msg, ##__VA_ARGS__)
 #else
-    #define Log(msg, ...)
+    #define LogDebug(category, msg, ...) GEARNES_LOG_DISABLED(category, msg, ##__VA_ARGS__)
 #endif
 
-__attribute__((__format__ (__printf__, 1, 0)))
-inline void LogImpl(const char* const msg, ...)
-{
-    static int count = 1;
-    char szBuf[512];
-    va_list args;
-    va_start(args, msg);
-    vsprintf(szBuf, msg, args);
-    va_end(args);
-    printf("%d: %s\n", count, szBuf);
-    count++;
+namespace Gearnes
+{
+
+enum Log_Level
+{
+    kLogLevelError,
+    kLogLevelWarning,
+    kLogLevelInfo,
+    kLogLevelDebug
+};
+
+enum Log_Category
+{
+    kLogCore,
+    kLogCartridge,
+    kLogMemory,
+    kLogVideo,
+    kLogAudio,
+    kLogMapper,
+    kLogCategoryCount
+};
+
+enum Log_Arg_Type
+{
+    kLogArgSigned,
+    kLogArgUnsigned,
+    kLogArgDouble,
+    kLogArgString,
+    kLogArgPointer
+};
+
+// Never called, only gives the log macros printf format checking
+__attribute__((__format__ (__printf__, 1, 2)))
+inline void LogFormatCheck(const char*, ...)
+{
+}
+
+const int kLogMaxArgs = 8;
+const int kLogStringBytes = 152;
+
+// A message before formatting. format must be a string literal, only its
+// pointer is kept. Strings are copied into strings, truncated if they
+// don't fit.
+struct stLogRecord
+{
+    const char* format;
+    unsigned long long args[kLogMaxArgs];
+    unsigned char types[kLogMaxArgs];
+    unsigned char level;
+    unsigned char category;
+    unsigned char arg_count;
+    unsigned char string_bytes;
+    char strings[kLogStringBytes];
+};
+
+// Log messages are queued with their raw arguments and a background
+// thread formats and prints them, so logging never waits for the
+// terminal. Any thread can log. When the queue is full messages are
+// dropped and counted instead of blocking the caller.
+class Logger
+{
+public:
+    template <typename... Args>
+    static void Write(Log_Level level, Log_Category category, const char* format, Args... args);
+    static void SetCategoryEnabled(Log_Category category, bool enabled);
+    static bool IsCategoryEnabled(Log_Category category);
+    static void Flush();
+    static unsigned long long GetDropped();
+
+private:
+    static stLogRecord* BeginWrite();
+    static void EndWrite(stLogRecord* record);
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type Pack(stLogRecord* record, T value);
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type Pack(stLogRecord* record, T value);
+    template <typename T>
+    static typename std::enable_if<std::is_enum<T>::value>::type Pack(stLogRecord* record, T value);
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type Pack(stLogRecord* record, T value);
+    static void Pack(stLogRecord* record, const char* value);
+    static void Pack(stLogRecord* record, const void* value);
+    static void PackAll(stLogRecord* record);
+    template <typename T, typename... Args>
+    static void PackAll(stLogRecord* record, T value, Args... args);
+
+private:
+    static std::atomic<unsigned int> categories_;
+};
+
+template <typename... Args>
+inline void Logger::Write(Log_Level level, Log_Category category, const char* format, Args... args)
+{
+    static_assert(sizeof...(Args) <= kLogMaxArgs, "Too many log arguments");
+
+    if (!IsCategoryEnabled(category))
+        return;
+
+    stLogRecord* record = BeginWrite();
+
+    if (record == nullptr)
+        return;
+
+    record->format = format;
+    record->level = static_cast<unsigned char>(level);
+    record->category = static_cast<unsigned char>(category);
+    record->arg_count = 0;
+    record->string_bytes = 0;
+    PackAll(record, args...);
+
+    EndWrite(record);
+}
+
+inline bool Logger::IsCategoryEnabled(Log_Category category)
+{
+    return ((categories_.load(std::memory_order_relaxed) >> category) & 1) != 0;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type Logger::Pack(stLogRecord* record, T value)
+{
+    record->types[record->arg_count] = kLogArgSigned;
+    record->args[record->arg_count++] = static_cast<unsigned long long>(static_cast<long long>(value));
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type Logger::Pack(stLogRecord* record, T value)
+{
+    record->types[record->arg_count] = kLogArgUnsigned;
+    record->args[record->arg_count++] = static_cast<unsigned long long>(value);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value>::type Logger::Pack(stLogRecord* record, T value)
+{
+    record->types[record->arg_count] = kLogArgSigned;
+    record->args[record->arg_count++] = static_cast<unsigned long long>(static_cast<long long>(value));
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type Logger::Pack(stLogRecord* record, T value)
+{
+    double d = static_cast<double>(value);
+    record->types[record->arg_count] = kLogArgDouble;
+    memcpy(&record->args[record->arg_count++], &d, sizeof(d));
+}
+
+// The offset of the copy goes in args
+inline void Logger::Pack(stLogRecord* record, const char* value)
+{
+    int offset = record->string_bytes;
+    int length = 0;
+
+    if (value == nullptr)
+        value = "(null)";
+
+    while ((value[length] != 0) && (offset + length < kLogStringBytes - 1))
+    {
+        record->strings[offset + length] = value[length];
+        length++;
+    }
+
+    record->strings[offset + length] = 0;
+    record->string_bytes = static_cast<unsigned char>((offset + length + 1 < kLogStringBytes) ? (offset + length + 1) : (kLogStringBytes - 1));
+    record->types[record->arg_count] = kLogArgString;
+    record->args[record->arg_count++] = static_cast<unsigned long long>(offset);
+}
+
+inline void Logger::Pack(stLogRecord* record, const void* value)
+{
+    record->types[record->arg_count] = kLogArgPointer;
+    record->args[record->arg_count++] = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(value));
+}
+
+inline void Logger::PackAll(stLogRecord*)
+{
+}
+
+template <typename T, typename... Args>
+inline void Logger::PackAll(stLogRecord* record, T value, Args... args)
+{
+    Pack(record, value);
+    PackAll(record, args...);
 }
 
 } // namespace Gearnes
@@ -22,9 +22,12 @@
 namespace Gearnes
 {
 
-Mapper::Mapper(Memory* memory, Cartridge* cartridge)
+// Mappers switch PRG banks through memory and CHR banks and mirroring
+// through video, both by moving page pointers
+Mapper::Mapper(Memory* memory, Video* video, Cartridge* cartridge)
 {
     memory_ = memory;
+    video_ = video;
     cartridge_ = cartridge;
 }
 
@@ -48,4 +51,11 @@ bool Mapper::PersistedRAM()
     return false;
 }
 
+// Mappers counting PPU A12 edges need the PPU in sync before any of
+// their registers is accessed
+bool Mapper::WatchesPPUA12()
+{
+    return false;
+}
+
 } // namespace Gearnes
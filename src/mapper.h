@@ -27,12 +27,13 @@ namespace Gearnes
 {
 
 class Memory;
+class Video;
 class Cartridge;
 
 class Mapper
 {
 public:
-    Mapper(Memory* memory, Cartridge* cartridge);
+    Mapper(Memory* memory, Video* video, Cartridge* cartridge);
     virtual ~Mapper();
     virtual u8 PerformRead(u16 address) = 0;
     virtual void PerformWrite(u16 address, u8 value) = 0;
@@ -40,9 +41,11 @@ public:
     virtual void SaveRam(std::ofstream &file);
     virtual bool LoadRam(std::ifstream &file, s32 fileSize);
     virtual bool PersistedRAM();
+    virtual bool WatchesPPUA12();
 
 protected:
     Memory* memory_;
+    Video* video_;
     Cartridge* cartridge_;
 };
 
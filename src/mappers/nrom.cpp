@@ -19,11 +19,13 @@
 
 #include "nrom.h"
 #include "../cartridge.h"
+#include "../memory.h"
+#include "../video.h"
 
 namespace Gearnes
 {
 
-NROMMapper::NROMMapper(Memory* memory, Cartridge* cartridge) : Mapper(memory,                                                                           cartridge)
+NROMMapper::NROMMapper(Memory* memory, Video* video, Cartridge* cartridge) : Mapper(memory, video, cartridge)
 {
 
 }
@@ -35,14 +37,39 @@ NROMMapper::~NROMMapper()
 
 void NROMMapper::Reset()
 {
+    // 8 KB of CHR, no banking
+    if (IsValidPointer(cartridge_->GetCHRROM()))
+    {
+        video_->MapCHR(0x0000, 0x2000, 0);
+    }
+
+    video_->SetMirroring(cartridge_->GetMirroring());
+
+    u8* prg_rom = cartridge_->GetPRGROM();
+
+    if (!IsValidPointer(prg_rom))
+    {
+        return;
+    }
 
+    if (cartridge_->GetPRGROMSize() == 0x4000)
+    {
+        // NROM-128, mirrored
+        memory_->MapPRGROM(0x8000, 0x4000, prg_rom, 0);
+        memory_->MapPRGROM(0xC000, 0x4000, prg_rom, 0);
+    }
+    else
+    {
+        // NROM-256
+        memory_->MapPRGROM(0x8000, 0x8000, prg_rom, 0);
+    }
 }
 
 u8 NROMMapper::PerformRead(u16 address)
 {
     if (address < 0x8000)
     {
-        Log("NROM Reading $%04X", address);
+        LogDebug(kLogMapper, "NROM Reading $%04X", address);
 
         return 0xFF;
     }
@@ -58,7 +85,7 @@ u8 NROMMapper::PerformRead(u16 address)
 
 void NROMMapper::PerformWrite(u16 address, u8 value)
 {
-    Log("NROM Writing to cartridge $%04X 0x%02X", address, value);
+    LogDebug(kLogMapper, "NROM Writing to cartridge $%04X 0x%02X", address, value);
 }
 
 } // namespace Gearnes
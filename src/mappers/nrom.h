@@ -27,12 +27,13 @@ namespace Gearnes
 {
 
 class Memory;
+class Video;
 class Cartridge;
 
 class NROMMapper : public Mapper
 {
 public:
-    NROMMapper(Memory* memory, Cartridge* cartridge);
+    NROMMapper(Memory* memory, Video* video, Cartridge* cartridge);
     virtual ~NROMMapper();
     virtual void Reset();
     virtual u8 PerformRead(u16 address);
@@ -29,11 +29,20 @@ namespace Gearnes
 Memory::Memory(Video* video)
 {
     video_ = video;
+    InitPointer(processor_);
     InitPointer(map_);
     InitPointer(current_mapper_);
     InitPointer(disassembled_map_);
+    mapper_watches_a12_ = false;
 
     map_ = new u8[0x10000];
+
+    for (int i = 0; i < 0x100; i++)
+    {
+        InitPointer(read_pages_[i]);
+        InitPointer(write_pages_[i]);
+        code_banks_[i] = -1;
+    }
 }
 
 Memory::~Memory()
@@ -50,11 +59,123 @@ void Memory::Init()
 void Memory::Reset()
 {
     memset(map_, 0xFF, 0x10000);
+
+    UnmapRead(0x0000, 0x10000);
+    UnmapWrite(0x0000, 0x10000);
+
+    // 2KB internal RAM, mirrored up to $1FFF
+    for (int i = 0; i < 4; i++)
+    {
+        MapRead(i * 0x0800, 0x0800, map_);
+        MapWrite(i * 0x0800, 0x0800, map_);
+    }
+}
+
+void Memory::SetProcessor(g6502::G6502<Memory>* processor)
+{
+    processor_ = processor;
 }
 
 void Memory::SetCurrentMapper(Mapper* mapper)
 {
     current_mapper_ = mapper;
+    mapper_watches_a12_ = mapper->WatchesPPUA12();
+
+    // Cartridge space ($4100-$FFFF) goes to the mapper handlers until the
+    // mapper maps its own banks
+    UnmapRead(0x4100, 0x10000 - 0x4100);
+    UnmapWrite(0x4100, 0x10000 - 0x4100);
+}
+
+void Memory::MapRead(u16 address, int size, u8* data)
+{
+    int first_page = address >> 8;
+    int page_count = size >> 8;
+
+    for (int i = 0; i < page_count; i++)
+    {
+        read_pages_[first_page + i] = data + (i << 8);
+        code_banks_[first_page + i] = -1;
+    }
+
+    // The processor may be fetching from one of these pages
+    if (IsValidPointer(processor_))
+    {
+        processor_->InvalidateFetchPage();
+    }
+}
+
+// Maps PRG-ROM from offset. Code in these pages is never written, so the
+// processor may keep it decoded; the 256 byte ROM page is the bank id.
+void Memory::MapPRGROM(u16 address, int size, u8* prg_rom, int offset)
+{
+    MapRead(address, size, prg_rom + offset);
+
+    int first_page = address >> 8;
+    int page_count = size >> 8;
+
+    for (int i = 0; i < page_count; i++)
+    {
+        code_banks_[first_page + i] = (offset >> 8) + i;
+    }
+}
+
+void Memory::MapWrite(u16 address, int size, u8* data)
+{
+    int first_page = address >> 8;
+    int page_count = size >> 8;
+
+    for (int i = 0; i < page_count; i++)
+    {
+        write_pages_[first_page + i] = data + (i << 8);
+    }
+}
+
+void Memory::UnmapRead(u16 address, int size)
+{
+    int first_page = address >> 8;
+    int page_count = size >> 8;
+
+    for (int i = 0; i < page_count; i++)
+    {
+        InitPointer(read_pages_[first_page + i]);
+        code_banks_[first_page + i] = -1;
+    }
+
+    // The processor may be fetching from one of these pages
+    if (IsValidPointer(processor_))
+    {
+        processor_->InvalidateFetchPage();
+    }
+}
+
+void Memory::UnmapWrite(u16 address, int size)
+{
+    int first_page = address >> 8;
+    int page_count = size >> 8;
+
+    for (int i = 0; i < page_count; i++)
+    {
+        InitPointer(write_pages_[first_page + i]);
+    }
+}
+
+void Memory::OAMDMA(u8 page)
+{
+    u8 data[0x100];
+    u16 address = page << 8;
+
+    for (int i = 0; i < 0x100; i++)
+    {
+        data[i] = Read(address + i);
+    }
+
+    unsigned int stall = video_->OAMDMA(data);
+
+    if (IsValidPointer(processor_))
+    {
+        processor_->AddTStates(stall);
+    }
 }
 
 Mapper* Memory::GetCurrentMapper()
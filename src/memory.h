@@ -29,20 +29,35 @@
 namespace Gearnes
 {
 
-class Memory : public g6502::MemoryInterface
+class Memory final : public g6502::MemoryInterface
 {
 public:
     Memory(Video* video);
     virtual ~Memory();
     void Init();
     void Reset();
+    void SetProcessor(g6502::G6502<Memory>* processor);
     void SetCurrentMapper(Mapper* mapper);
     Mapper* GetCurrentMapper();
     virtual u8 Read(u16 address);
     virtual void Write(u16 address, u8 value);
     virtual void Disassemble(u16 address, const char* disassembled_string);
     virtual bool IsDisassembled(u16 address);
+    virtual int GetCodeBank(u16 address);
+    virtual unsigned int GetIdleReadLimit(u16 address);
+    virtual u8* GetRAMPages();
+    virtual const u8* GetReadPage(u16 address);
     void MemoryDump(const char* file_path);
+    void MapRead(u16 address, int size, u8* data);
+    void MapPRGROM(u16 address, int size, u8* prg_rom, int offset);
+    void MapWrite(u16 address, int size, u8* data);
+    void UnmapRead(u16 address, int size);
+    void UnmapWrite(u16 address, int size);
+
+private:
+    u8 ReadHandler(u16 address);
+    void WriteHandler(u16 address, u8 value);
+    void OAMDMA(u8 page);
 
 private:
     struct stDisassemble
@@ -52,21 +67,83 @@ private:
 
 private:
     Video* video_;
+    g6502::G6502<Memory>* processor_;
     u8* map_;
     Mapper* current_mapper_;
+    bool mapper_watches_a12_;
     stDisassemble* disassembled_map_;
+    // One pointer per 256 byte page. Pages without a pointer have side
+    // effects (PPU, APU, mapper registers) and go through the handlers.
+    u8* read_pages_[0x100];
+    u8* write_pages_[0x100];
+    // PRG-ROM page mapped at each page, -1 for anything else
+    int code_banks_[0x100];
 };
 
 
 inline u8 Memory::Read(u16 address)
 {
+    u8* page = read_pages_[address >> 8];
+
+    if (IsValidPointer(page))
+    {
+        return page[address & 0xFF];
+    }
+
+    return ReadHandler(address);
+}
+
+inline void Memory::Write(u16 address, u8 value)
+{
+    u8* page = write_pages_[address >> 8];
+
+    if (IsValidPointer(page))
+    {
+        page[address & 0xFF] = value;
+    }
+    else
+    {
+        WriteHandler(address, value);
+    }
+}
+
+inline int Memory::GetCodeBank(u16 address)
+{
+    return code_banks_[address >> 8];
+}
+
+// Internal RAM, zero page and stack never go through the handlers
+inline u8* Memory::GetRAMPages()
+{
+    return map_;
+}
+
+inline const u8* Memory::GetReadPage(u16 address)
+{
+    return read_pages_[address >> 8];
+}
+
+inline unsigned int Memory::GetIdleReadLimit(u16 address)
+{
+    // Mapped pages only change when written
+    if (IsValidPointer(read_pages_[address >> 8]))
+    {
+        return g6502::kIdleReadUnlimited;
+    }
+
+    if ((address & 0xE007) == 0x2002)
+    {
+        return video_->GetStatusIdleLimit();
+    }
+
+    return 0;
+}
+
+inline u8 Memory::ReadHandler(u16 address)
+{
+    // 2KB internal RAM is always paged in by Reset() and never gets here
     switch (address & 0xE000)
     {
-        case 0x0000:
-        {
-            // 2KB internal RAM
-            return map_[address & 0x07FF];
-        }
         case 0x2000:
         {
             // NES PPU registers
@@ -98,7 +175,7 @@ inline u8 Memory::Read(u16 address)
                 case 0x401A:
                 {
                     // Unused
-                    Log("Reading unused IO register $%04X", address);
+                    LogDebug(kLogMemory, "Reading unused IO register $%04X", address);
                     return map_[address];
                 }
                 default:
@@ -129,16 +206,11 @@ inline u8 Memory::Read(u16 address)
     }
 }
 
-inline void Memory::Write(u16 address, u8 value)
+inline void Memory::WriteHandler(u16 address, u8 value)
 {
+    // 2KB internal RAM is always paged in by Reset() and never gets here
     switch (address & 0xE000)
     {
-        case 0x0000:
-        {
-            // 2KB internal RAM
-            map_[address & 0x07FF] = value;
-            break;
-        }
         case 0x2000:
         {
             // NES PPU registers
@@ -152,8 +224,8 @@ inline void Memory::Write(u16 address, u8 value)
                 case 0x4014:
                 {
                     // OAM-DMA
-                    Log("Writing to OAM-DMA $%04X 0x%02X", address, value);
                     map_[address] = value;
+                    OAMDMA(value);
                     break;
                 }
                 case 0x4016:
@@ -175,7 +247,7 @@ inline void Memory::Write(u16 address, u8 value)
                 case 0x401A:
                 {
                     // Unused
-                    Log("Writing to unused IO register $%04X 0x%02X", address, value);
+                    LogDebug(kLogMemory, "Writing to unused IO register $%04X 0x%02X", address, value);
                     map_[address] = value;
                     break;
                 }
@@ -204,7 +276,11 @@ inline void Memory::Write(u16 address, u8 value)
         }
         default:
         {
-            // PRG-ROM
+            // PRG-ROM, mapper registers
+            if (mapper_watches_a12_)
+            {
+                video_->CatchUp();
+            }
             current_mapper_->PerformWrite(address, value);
         }
     }
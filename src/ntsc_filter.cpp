@@ -0,0 +1,464 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <cmath>
+#include <cstring>
+#include "ntsc_filter.h"
+
+#ifdef GEARNES_NTSC_FILTER_X86
+    #include <emmintrin.h>
+#endif
+
+namespace Gearnes
+{
+
+// 2C02 output levels relative to sync, for luma 0-3 with the signal low
+// and high. Colors $xD-$xF are black, $x0 has no low half.
+static const float kSignalLevels[8] = {
+    0.350f, 0.518f, 0.962f, 1.550f,
+    1.094f, 1.506f, 1.962f, 1.962f
+};
+
+static const float kSignalBlack = 0.518f;
+static const float kSignalWhite = 1.962f;
+static const float kEmphasisAttenuation = 0.746f;
+
+// Samples are stored with white at this value and filter taps with 1.0
+// at 1 << kCoefficientBits, so a sum shifted by kOutputShift is 0-255
+static const float kSampleScale = 1020.0f;
+static const float kCoefficientScale = 4096.0f;
+static const int kOutputShift = 14;
+
+// Decoder hue in samples, 30 degrees each, set to match the default
+// palette on flat colors
+static const float kHue = 4.0f;
+static const float kPi = 3.14159265358979f;
+
+// YIQ to RGB with the standard FCC matrix
+static const float kYIQToRGB[3][2] = {
+    { 0.956f, 0.621f },
+    { -0.272f, -0.647f },
+    { -1.106f, 1.703f }
+};
+
+static bool InColorPhase(int color, int phase)
+{
+    return ((color + phase) % 12) < 6;
+}
+
+// Normalized level of one sample of a 6-bit color with emphasis at a
+// phase of the subcarrier, as the PPU generates it
+static float SignalSample(int index, int phase)
+{
+    int color = index & 0x0F;
+    int level = (index >> 4) & 0x03;
+    int emphasis = (index >> 6) & 0x07;
+
+    if (color > 13)
+    {
+        level = 1;
+    }
+
+    float low = kSignalLevels[level + ((color == 0) ? 4 : 0)];
+    float high = kSignalLevels[level + ((color < 13) ? 4 : 0)];
+    float signal = InColorPhase(color, phase) ? high : low;
+
+    if ((((emphasis & 0x01) != 0) && InColorPhase(0, phase)) ||
+        (((emphasis & 0x02) != 0) && InColorPhase(4, phase)) ||
+        (((emphasis & 0x04) != 0) && InColorPhase(8, phase)))
+    {
+        signal *= kEmphasisAttenuation;
+    }
+
+    return (signal - kSignalBlack) / (kSignalWhite - kSignalBlack);
+}
+
+NTSCFilter::NTSCFilter()
+{
+    path_ = GetBestPath();
+    frame_ = new u8[NES_INDEXED_FRAME_SIZE];
+    memset(frame_, 0, NES_INDEXED_FRAME_SIZE);
+    InitPointer(output_);
+    frame_phase_ = 0;
+    running_ = false;
+    pending_ = false;
+    generation_ = 0;
+    next_band_.store(kBands);
+    done_bands_.store(kBands);
+    BuildTables();
+}
+
+NTSCFilter::~NTSCFilter()
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    work_condition_.notify_all();
+
+    for (size_t i = 0; i < threads_.size(); i++)
+    {
+        threads_[i].join();
+    }
+
+    SafeDeleteArray(frame_);
+}
+
+// threads workers, 0 filters on the caller inside Submit(). Negative
+// picks one per spare core, up to 4.
+void NTSCFilter::Init(int threads)
+{
+    if (threads < 0)
+    {
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        threads = (cores > 5) ? 4 : ((cores > 1) ? cores - 1 : 1);
+    }
+
+    running_ = true;
+
+    for (int i = 0; i < threads; i++)
+    {
+        threads_.push_back(std::thread(&NTSCFilter::Run, this));
+    }
+}
+
+// Falls back to scalar when the path is not available
+void NTSCFilter::SetPath(NTSC_Filter_Path path)
+{
+    Wait();
+    path_ = IsPathAvailable(path) ? path : kNTSCFilterScalar;
+}
+
+// Starts filtering indexed_frame into output, NES_NTSC_WIDTH x NES_HEIGHT.
+// indexed_frame can be reused at once, output only after Wait().
+void NTSCFilter::Submit(const u8* indexed_frame, NES_Color* output)
+{
+    Wait();
+
+    memcpy(frame_, indexed_frame, NES_INDEXED_FRAME_SIZE);
+    output_ = output;
+
+    // With rendering on, frames alternate between two subcarrier phases
+    frame_phase_ = (frame_phase_ == 0) ? 8 : 0;
+
+    done_bands_.store(0);
+    next_band_.store(0);
+
+    if (threads_.empty())
+    {
+        FilterBands();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_++;
+        pending_ = true;
+    }
+    work_condition_.notify_all();
+}
+
+// Blocks until the last submitted frame is in its output
+void NTSCFilter::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this] { return done_bands_.load() == kBands; });
+    pending_ = false;
+}
+
+void NTSCFilter::Filter(const u8* indexed_frame, NES_Color* output)
+{
+    Submit(indexed_frame, output);
+    Wait();
+}
+
+bool NTSCFilter::IsPathAvailable(NTSC_Filter_Path path)
+{
+    switch (path)
+    {
+        case kNTSCFilterScalar:
+            return true;
+#ifdef GEARNES_NTSC_FILTER_X86
+        case kNTSCFilterSSE2:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+NTSC_Filter_Path NTSCFilter::GetBestPath()
+{
+    for (int i = kNTSCFilterPathCount - 1; i > kNTSCFilterScalar; i--)
+    {
+        NTSC_Filter_Path path = static_cast<NTSC_Filter_Path>(i);
+
+        if (IsPathAvailable(path))
+        {
+            return path;
+        }
+    }
+
+    return kNTSCFilterScalar;
+}
+
+const char* NTSCFilter::GetPathName(NTSC_Filter_Path path)
+{
+    switch (path)
+    {
+        case kNTSCFilterScalar:
+            return "scalar";
+        case kNTSCFilterSSE2:
+            return "sse2";
+        default:
+            return "unknown";
+    }
+}
+
+void NTSCFilter::BuildTables()
+{
+    for (int index = 0; index < NES_PALETTE_SIZE; index++)
+    {
+        for (int start = 0; start < 3; start++)
+        {
+            for (int i = 0; i < kSamplesPerPixel; i++)
+            {
+                float sample = SignalSample(index, (start * 4) + i) * kSampleScale;
+                pixel_samples_[index][start][i] = static_cast<s16>(floorf(sample + 0.5f));
+            }
+        }
+    }
+
+    // Luma is the average of one subcarrier cycle in the middle of the
+    // window, which cancels the chroma of flat areas. Chroma is
+    // demodulated over the whole window with a Hann taper.
+    float luma[kTaps];
+    float chroma[kTaps];
+    float chroma_sum = 0.0f;
+
+    for (int k = 0; k < kTaps; k++)
+    {
+        luma[k] = ((k >= 2) && (k < 14)) ? (1.0f / 12.0f) : 0.0f;
+        chroma[k] = 0.5f - (0.5f * cosf((2.0f * kPi * (k + 0.5f)) / kTaps));
+        chroma_sum += chroma[k];
+    }
+
+    for (int phase = 0; phase < 12; phase++)
+    {
+        float i[kTaps];
+        float q[kTaps];
+        float i_dc = 0.0f;
+        float q_dc = 0.0f;
+
+        for (int k = 0; k < kTaps; k++)
+        {
+            float angle = (kPi * (phase + k + kHue)) / 6.0f;
+            i[k] = (2.0f * chroma[k] * cosf(angle)) / chroma_sum;
+            q[k] = (2.0f * chroma[k] * sinf(angle)) / chroma_sum;
+            i_dc += i[k];
+            q_dc += q[k];
+        }
+
+        // 16 taps are not whole subcarrier cycles, take out what they
+        // would pass of a flat signal so grays stay gray
+        for (int k = 0; k < kTaps; k++)
+        {
+            float i_tap = i[k] - ((i_dc * chroma[k]) / chroma_sum);
+            float q_tap = q[k] - ((q_dc * chroma[k]) / chroma_sum);
+
+            for (int c = 0; c < 3; c++)
+            {
+                float coefficient = luma[k] + (kYIQToRGB[c][0] * i_tap) + (kYIQToRGB[c][1] * q_tap);
+                kernels_[phase][c][k] = static_cast<s16>(floorf((coefficient * kCoefficientScale) + 0.5f));
+            }
+
+            kernels_[phase][3][k] = 0;
+        }
+    }
+
+    // Output pixel j is centered at (j + 0.5) * kLineSamples / NES_NTSC_WIDTH
+    for (int j = 0; j < NES_NTSC_WIDTH; j++)
+    {
+        int start = static_cast<int>(floorf(((((j + 0.5f) * kLineSamples) / NES_NTSC_WIDTH) - (kTaps / 2)) + 0.5f));
+        window_start_[j] = start;
+        window_phase_[j] = ((start % 12) + 12) % 12;
+    }
+}
+
+void NTSCFilter::Run()
+{
+    u64 generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_condition_.wait(lock, [this, generation] { return !running_ || (pending_ && (generation_ != generation)); });
+
+            if (!running_)
+            {
+                break;
+            }
+
+            generation = generation_;
+        }
+
+        FilterBands();
+    }
+}
+
+// Takes bands until there are none left. The last one done wakes Wait().
+void NTSCFilter::FilterBands()
+{
+    s16 signal[kPadding + kLineSamples + kPadding];
+    memset(signal, 0, sizeof(signal));
+
+    while (true)
+    {
+        int band = next_band_.fetch_add(1);
+
+        if (band >= kBands)
+        {
+            break;
+        }
+
+        for (int line = band * kBandLines; line < (band + 1) * kBandLines; line++)
+        {
+            FilterLine(line, signal + kPadding);
+        }
+
+        if (done_bands_.fetch_add(1) + 1 == kBands)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+            }
+            done_condition_.notify_all();
+        }
+    }
+}
+
+void NTSCFilter::FilterLine(int line, s16* signal)
+{
+    const u8* pixels = frame_ + (line * NES_WIDTH);
+    int emphasis = (frame_[(NES_WIDTH * NES_HEIGHT) + line] & 0x07) << 6;
+
+    // Each line starts 4 samples later in the subcarrier cycle than the
+    // one above (341 dots of 8 samples)
+    int line_phase = (frame_phase_ + (line * 4)) % 12;
+
+    for (int x = 0; x < NES_WIDTH; x++)
+    {
+        int start = (((x * kSamplesPerPixel) + line_phase) % 12) >> 2;
+        memcpy(signal + (x * kSamplesPerPixel), pixel_samples_[emphasis | (pixels[x] & 0x3F)][start], kSamplesPerPixel * sizeof(s16));
+    }
+
+    NES_Color* output = output_ + (line * NES_NTSC_WIDTH);
+
+#ifdef GEARNES_NTSC_FILTER_X86
+    if (path_ == kNTSCFilterSSE2)
+    {
+        DecodeSSE2(signal, line_phase, output);
+        return;
+    }
+#endif
+
+    DecodeScalar(signal, line_phase, output);
+}
+
+static inline u8 ClampOutput(s32 sum)
+{
+    s32 value = (sum + (1 << (kOutputShift - 1))) >> kOutputShift;
+    return static_cast<u8>((value < 0) ? 0 : ((value > 255) ? 255 : value));
+}
+
+// The reference, the SIMD paths must match it bit for bit
+void NTSCFilter::DecodeScalar(const s16* signal, int line_phase, NES_Color* output) const
+{
+    for (int j = 0; j < NES_NTSC_WIDTH; j++)
+    {
+        const s16* samples = signal + window_start_[j];
+        const s16 (*kernel)[kTaps] = kernels_[(window_phase_[j] + line_phase) % 12];
+        s32 sums[3] = { 0, 0, 0 };
+
+        for (int c = 0; c < 3; c++)
+        {
+            for (int k = 0; k < kTaps; k++)
+            {
+                sums[c] += kernel[c][k] * samples[k];
+            }
+        }
+
+        output[j].red = ClampOutput(sums[0]);
+        output[j].green = ClampOutput(sums[1]);
+        output[j].blue = ClampOutput(sums[2]);
+        output[j].alpha = 0xFF;
+    }
+}
+
+#ifdef GEARNES_NTSC_FILTER_X86
+
+// R, G, B, 0 sums of one output pixel, as 32-bit lanes
+static inline __m128i DecodePixelSSE2(const s16* samples, const s16 (*kernel)[16])
+{
+    __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples));
+    __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + 8));
+
+    __m128i r = _mm_add_epi32(_mm_madd_epi16(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel[0]))),
+                              _mm_madd_epi16(high, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel[0] + 8))));
+    __m128i g = _mm_add_epi32(_mm_madd_epi16(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel[1]))),
+                              _mm_madd_epi16(high, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel[1] + 8))));
+    __m128i b = _mm_add_epi32(_mm_madd_epi16(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel[2]))),
+                              _mm_madd_epi16(high, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel[2] + 8))));
+    __m128i zero = _mm_setzero_si128();
+
+    // Transpose and add the 4 partial sums of each channel
+    __m128i rg = _mm_add_epi32(_mm_unpacklo_epi32(r, g), _mm_unpackhi_epi32(r, g));
+    __m128i b0 = _mm_add_epi32(_mm_unpacklo_epi32(b, zero), _mm_unpackhi_epi32(b, zero));
+
+    return _mm_add_epi32(_mm_unpacklo_epi64(rg, b0), _mm_unpackhi_epi64(rg, b0));
+}
+
+// Two pixels per step, 602 is even
+void NTSCFilter::DecodeSSE2(const s16* signal, int line_phase, NES_Color* output) const
+{
+    const __m128i round = _mm_set1_epi32(1 << (kOutputShift - 1));
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+    for (int j = 0; j < NES_NTSC_WIDTH; j += 2)
+    {
+        __m128i first = DecodePixelSSE2(signal + window_start_[j], kernels_[(window_phase_[j] + line_phase) % 12]);
+        __m128i second = DecodePixelSSE2(signal + window_start_[j + 1], kernels_[(window_phase_[j + 1] + line_phase) % 12]);
+
+        first = _mm_srai_epi32(_mm_add_epi32(first, round), kOutputShift);
+        second = _mm_srai_epi32(_mm_add_epi32(second, round), kOutputShift);
+
+        // Saturates to 0-255 as ClampOutput() does
+        __m128i words = _mm_packs_epi32(first, second);
+        __m128i bytes = _mm_packus_epi16(words, words);
+        bytes = _mm_or_si128(bytes, alpha);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + j), bytes);
+    }
+}
+
+#endif // GEARNES_NTSC_FILTER_X86
+
+} // namespace Gearnes
@@ -0,0 +1,132 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef NTSC_FILTER_H_
+#define	NTSC_FILTER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common.h"
+#include "video.h"
+#include "palette.h"
+
+#if !defined(GEARNES_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define GEARNES_NTSC_FILTER_X86 1
+#endif
+
+namespace Gearnes
+{
+
+// 7 output pixels for every 3 NES pixels, about the 8:7 pixel aspect
+const int NES_NTSC_WIDTH = 602;
+
+enum NTSC_Filter_Path
+{
+    kNTSCFilterScalar,
+    kNTSCFilterSSE2,
+    kNTSCFilterPathCount
+};
+
+// Turns indexed frames (see palette.h) into what a TV shows from the
+// composite signal: color fringes on edges, dot crawl and blending of
+// dithered patterns. Each line is rebuilt as the 2C02 outputs it, 8
+// samples per pixel at 12 samples per color subcarrier cycle, then
+// decoded with a 16-tap filter per output pixel that goes straight to RGB.
+// The filters and the samples of every color are precomputed, the kernel
+// only multiplies and adds 16-bit integers, so the scalar path is the
+// exact reference for the SIMD ones.
+//
+// The frame is split in bands of lines across a small pool of workers.
+// Submit() returns at once, so filtering a frame overlaps emulating the
+// next one; Wait() or the next Submit() collects it.
+class NTSCFilter
+{
+public:
+    NTSCFilter();
+    ~NTSCFilter();
+    void Init(int threads);
+    void SetPath(NTSC_Filter_Path path);
+    NTSC_Filter_Path GetPath() const;
+    int GetThreadCount() const;
+    void Submit(const u8* indexed_frame, NES_Color* output);
+    void Wait();
+    void Filter(const u8* indexed_frame, NES_Color* output);
+    static bool IsPathAvailable(NTSC_Filter_Path path);
+    static NTSC_Filter_Path GetBestPath();
+    static const char* GetPathName(NTSC_Filter_Path path);
+
+private:
+    void BuildTables();
+    void Run();
+    void FilterBands();
+    void FilterLine(int line, s16* signal);
+    void DecodeScalar(const s16* signal, int line_phase, NES_Color* output) const;
+#ifdef GEARNES_NTSC_FILTER_X86
+    void DecodeSSE2(const s16* signal, int line_phase, NES_Color* output) const;
+#endif
+
+private:
+    static const int kSamplesPerPixel = 8;
+    static const int kLineSamples = NES_WIDTH * kSamplesPerPixel;
+    static const int kTaps = 16;
+    // Black around the line, for the taps past both ends
+    static const int kPadding = 16;
+    static const int kBandLines = 8;
+    static const int kBands = NES_HEIGHT / kBandLines;
+
+    // Samples of each color and emphasis for the 3 phases a pixel can
+    // start on, 0, 4 and 8
+    s16 pixel_samples_[NES_PALETTE_SIZE][3][kSamplesPerPixel];
+    // R, G, B and 0 filters for each phase of the first tap
+    s16 kernels_[12][4][kTaps];
+    // First sample and its phase under each output pixel, phase 0 line
+    int window_start_[NES_NTSC_WIDTH];
+    int window_phase_[NES_NTSC_WIDTH];
+    NTSC_Filter_Path path_;
+    // The frame being filtered, copied so the emulator can reuse its own
+    u8* frame_;
+    NES_Color* output_;
+    int frame_phase_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable work_condition_;
+    std::condition_variable done_condition_;
+    bool running_;
+    bool pending_;
+    u64 generation_;
+    std::atomic<int> next_band_;
+    std::atomic<int> done_bands_;
+};
+
+inline NTSC_Filter_Path NTSCFilter::GetPath() const
+{
+    return path_;
+}
+
+inline int NTSCFilter::GetThreadCount() const
+{
+    return static_cast<int>(threads_.size());
+}
+
+} // namespace Gearnes
+
+#endif // NTSC_FILTER_H_
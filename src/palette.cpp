@@ -0,0 +1,239 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <cstring>
+#include <fstream>
+#include "palette.h"
+
+namespace Gearnes
+{
+
+// 2C02 output as RGB, indexed by the 6-bit palette RAM value
+static const NES_Color kNESPalette[64] = {
+    { 0x74, 0x74, 0x74, 0xFF }, { 0x24, 0x18, 0x8C, 0xFF }, { 0x00, 0x00, 0xA8, 0xFF }, { 0x44, 0x00, 0x9C, 0xFF },
+    { 0x8C, 0x00, 0x74, 0xFF }, { 0xA8, 0x00, 0x10, 0xFF }, { 0xA4, 0x00, 0x00, 0xFF }, { 0x7C, 0x08, 0x00, 0xFF },
+    { 0x40, 0x2C, 0x00, 0xFF }, { 0x00, 0x44, 0x00, 0xFF }, { 0x00, 0x50, 0x00, 0xFF }, { 0x00, 0x3C, 0x14, 0xFF },
+    { 0x18, 0x3C, 0x5C, 0xFF }, { 0x00, 0x00, 0x00, 0xFF }, { 0x00, 0x00, 0x00, 0xFF }, { 0x00, 0x00, 0x00, 0xFF },
+    { 0xBC, 0xBC, 0xBC, 0xFF }, { 0x00, 0x70, 0xEC, 0xFF }, { 0x20, 0x38, 0xEC, 0xFF }, { 0x80, 0x00, 0xF0, 0xFF },
+    { 0xBC, 0x00, 0xBC, 0xFF }, { 0xE4, 0x00, 0x58, 0xFF }, { 0xD8, 0x28, 0x00, 0xFF }, { 0xC8, 0x4C, 0x0C, 0xFF },
+    { 0x88, 0x70, 0x00, 0xFF }, { 0x00, 0x94, 0x00, 0xFF }, { 0x00, 0xA8, 0x00, 0xFF }, { 0x00, 0x90, 0x38, 0xFF },
+    { 0x00, 0x80, 0x88, 0xFF }, { 0x00, 0x00, 0x00, 0xFF }, { 0x00, 0x00, 0x00, 0xFF }, { 0x00, 0x00, 0x00, 0xFF },
+    { 0xFC, 0xFC, 0xFC, 0xFF }, { 0x3C, 0xBC, 0xFC, 0xFF }, { 0x5C, 0x94, 0xFC, 0xFF }, { 0xCC, 0x88, 0xFC, 0xFF },
+    { 0xF4, 0x78, 0xFC, 0xFF }, { 0xFC, 0x74, 0xB4, 0xFF }, { 0xFC, 0x74, 0x60, 0xFF }, { 0xFC, 0x98, 0x38, 0xFF },
+    { 0xF0, 0xBC, 0x3C, 0xFF }, { 0x80, 0xD0, 0x10, 0xFF }, { 0x4C, 0xDC, 0x48, 0xFF }, { 0x58, 0xF8, 0x98, 0xFF },
+    { 0x00, 0xE8, 0xD8, 0xFF }, { 0x78, 0x78, 0x78, 0xFF }, { 0x00, 0x00, 0x00, 0xFF }, { 0x00, 0x00, 0x00, 0xFF },
+    { 0xFC, 0xFC, 0xFC, 0xFF }, { 0xA8, 0xE4, 0xFC, 0xFF }, { 0xC4, 0xD4, 0xFC, 0xFF }, { 0xD4, 0xC8, 0xFC, 0xFF },
+    { 0xFC, 0xC4, 0xFC, 0xFF }, { 0xFC, 0xC4, 0xD8, 0xFF }, { 0xFC, 0xBC, 0xB0, 0xFF }, { 0xFC, 0xD8, 0xA8, 0xFF },
+    { 0xFC, 0xE4, 0xA0, 0xFF }, { 0xE0, 0xFC, 0xA0, 0xFF }, { 0xA8, 0xF0, 0xBC, 0xFF }, { 0xB0, 0xFC, 0xCC, 0xFF },
+    { 0x9C, 0xFC, 0xF0, 0xFF }, { 0xC4, 0xC4, 0xC4, 0xFF }, { 0x00, 0x00, 0x00, 0xFF }, { 0x00, 0x00, 0x00, 0xFF }
+};
+
+// Each emphasis bit dims the other two channels
+static const float kEmphasisAttenuation = 0.816f;
+
+Palette::Palette()
+{
+    memset(colors_, 0, sizeof(colors_));
+    memset(grayscale_colors_, 0, sizeof(grayscale_colors_));
+    memset(rgba8888_, 0, sizeof(rgba8888_));
+    memset(bgra8888_, 0, sizeof(bgra8888_));
+    memset(rgb565_, 0, sizeof(rgb565_));
+
+    for (int i = 0; i < 64; i++)
+    {
+        indexes_[0][i] = static_cast<u8>(i);
+        indexes_[1][i] = static_cast<u8>(i & 0x30);
+    }
+}
+
+Palette::~Palette()
+{
+
+}
+
+void Palette::Init()
+{
+    LoadDefault();
+}
+
+// The built-in 2C02 colors
+void Palette::LoadDefault()
+{
+    memcpy(colors_, kNESPalette, sizeof(kNESPalette));
+    ApplyEmphasis();
+    BuildTables();
+}
+
+// Keeps the current colors if the file can't be read or its size is not
+// one of the .pal sizes
+bool Palette::LoadFromFile(const char* path)
+{
+    using namespace std;
+
+    ifstream file(path, ios::in | ios::binary | ios::ate);
+
+    if (!file.is_open())
+    {
+        LogError(kLogVideo, "There was a problem opening the palette %s", path);
+        return false;
+    }
+
+    int size = static_cast<int>(file.tellg());
+
+    if ((size != NES_PAL_FILE_SIZE) && (size != NES_PAL_FILE_EMPHASIS_SIZE))
+    {
+        LogError(kLogVideo, "Invalid palette size: %d bytes", size);
+        return false;
+    }
+
+    u8 buffer[NES_PAL_FILE_EMPHASIS_SIZE];
+    file.seekg(0, ios::beg);
+    file.read(reinterpret_cast<char*>(buffer), size);
+
+    if (file.fail())
+    {
+        LogError(kLogVideo, "There was a problem reading the palette %s", path);
+        return false;
+    }
+
+    return LoadFromBuffer(buffer, size);
+}
+
+// 64 colors get the built-in emphasis, 512 are taken as they are
+bool Palette::LoadFromBuffer(const u8* buffer, int size)
+{
+    if ((size != NES_PAL_FILE_SIZE) && (size != NES_PAL_FILE_EMPHASIS_SIZE))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < size / 3; i++)
+    {
+        colors_[i].red = buffer[(i * 3) + 0];
+        colors_[i].green = buffer[(i * 3) + 1];
+        colors_[i].blue = buffer[(i * 3) + 2];
+        colors_[i].alpha = 0xFF;
+    }
+
+    if (size == NES_PAL_FILE_SIZE)
+    {
+        ApplyEmphasis();
+    }
+
+    BuildTables();
+
+    LogInfo(kLogVideo, "Palette loaded: %d colors", size / 3);
+
+    return true;
+}
+
+// Fills the 7 emphasis copies from the 64 base colors
+void Palette::ApplyEmphasis()
+{
+    for (int emphasis = 1; emphasis < 8; emphasis++)
+    {
+        // Bit 0 red, bit 1 green, bit 2 blue
+        float red = 1.0f;
+        float green = 1.0f;
+        float blue = 1.0f;
+
+        if ((emphasis & 0x01) != 0)
+        {
+            green *= kEmphasisAttenuation;
+            blue *= kEmphasisAttenuation;
+        }
+        if ((emphasis & 0x02) != 0)
+        {
+            red *= kEmphasisAttenuation;
+            blue *= kEmphasisAttenuation;
+        }
+        if ((emphasis & 0x04) != 0)
+        {
+            red *= kEmphasisAttenuation;
+            green *= kEmphasisAttenuation;
+        }
+
+        for (int i = 0; i < 64; i++)
+        {
+            NES_Color color = colors_[i];
+            color.red = static_cast<u8>((color.red * red) + 0.5f);
+            color.green = static_cast<u8>((color.green * green) + 0.5f);
+            color.blue = static_cast<u8>((color.blue * blue) + 0.5f);
+            colors_[(emphasis << 6) | i] = color;
+        }
+    }
+}
+
+// Everything the renderer and ConvertFrame() look up, so no color math
+// is left for each pixel
+void Palette::BuildTables()
+{
+    for (int i = 0; i < NES_PALETTE_SIZE; i++)
+    {
+        const NES_Color& color = colors_[i];
+        const u8 rgba[4] = { color.red, color.green, color.blue, color.alpha };
+        const u8 bgra[4] = { color.blue, color.green, color.red, color.alpha };
+
+        // Byte order in memory, whatever the host endianness
+        memcpy(&rgba8888_[i], rgba, 4);
+        memcpy(&bgra8888_[i], bgra, 4);
+        rgb565_[i] = static_cast<u16>(((color.red >> 3) << 11) | ((color.green >> 2) << 5) | (color.blue >> 3));
+
+        // Same emphasis, the gray of the color's row
+        grayscale_colors_[i] = colors_[i & 0x1F0];
+    }
+}
+
+void Palette::ConvertFrame(const u8* indexed_frame, void* output, NES_Pixel_Format format) const
+{
+    const u8* emphasis = indexed_frame + (NES_WIDTH * NES_HEIGHT);
+
+    for (int y = 0; y < NES_HEIGHT; y++)
+    {
+        const u8* pixels = indexed_frame + (y * NES_WIDTH);
+        int offset = (emphasis[y] & 0x07) << 6;
+
+        switch (format)
+        {
+            case kPixelFormatRGBA8888:
+            case kPixelFormatBGRA8888:
+            {
+                const u32* table = ((format == kPixelFormatRGBA8888) ? rgba8888_ : bgra8888_) + offset;
+                u32* line = static_cast<u32*>(output) + (y * NES_WIDTH);
+                for (int x = 0; x < NES_WIDTH; x++)
+                {
+                    line[x] = table[pixels[x] & 0x3F];
+                }
+                break;
+            }
+            case kPixelFormatRGB565:
+            {
+                const u16* table = rgb565_ + offset;
+                u16* line = static_cast<u16*>(output) + (y * NES_WIDTH);
+                for (int x = 0; x < NES_WIDTH; x++)
+                {
+                    line[x] = table[pixels[x] & 0x3F];
+                }
+                break;
+            }
+        }
+    }
+}
+
+} // namespace Gearnes
@@ -0,0 +1,97 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef PALETTE_H_
+#define	PALETTE_H_
+
+#include "common.h"
+#include "video.h"
+
+namespace Gearnes
+{
+
+enum NES_Pixel_Format
+{
+    kPixelFormatRGBA8888,
+    kPixelFormatBGRA8888,
+    kPixelFormatRGB565
+};
+
+// 64 colors times the 8 combinations of the PPUMASK emphasis bits
+const int NES_PALETTE_SIZE = 512;
+
+// .pal files: RGB triplets for the 64 colors, or for all 512 with the
+// emphasis combinations in PPUMASK order
+const int NES_PAL_FILE_SIZE = 64 * 3;
+const int NES_PAL_FILE_EMPHASIS_SIZE = NES_PALETTE_SIZE * 3;
+
+// Indexed frames hold one byte per pixel with the 6-bit color, grayscale
+// already applied, followed by the 3 emphasis bits of each line
+const int NES_INDEXED_FRAME_SIZE = (NES_WIDTH * NES_HEIGHT) + NES_HEIGHT;
+
+class Palette
+{
+public:
+    Palette();
+    ~Palette();
+    void Init();
+    void LoadDefault();
+    bool LoadFromFile(const char* path);
+    bool LoadFromBuffer(const u8* buffer, int size);
+    const NES_Color* GetColors() const;
+    const NES_Color* GetColors(bool grayscale) const;
+    const u8* GetIndexes(bool grayscale) const;
+    void ConvertFrame(const u8* indexed_frame, void* output, NES_Pixel_Format format) const;
+
+private:
+    void ApplyEmphasis();
+    void BuildTables();
+
+private:
+    NES_Color colors_[NES_PALETTE_SIZE];
+    // colors_ as seen with the PPUMASK grayscale bit set
+    NES_Color grayscale_colors_[NES_PALETTE_SIZE];
+    u32 rgba8888_[NES_PALETTE_SIZE];
+    u32 bgra8888_[NES_PALETTE_SIZE];
+    u16 rgb565_[NES_PALETTE_SIZE];
+    // 6-bit color shown for each palette RAM value, without and with the
+    // grayscale bit, which keeps only the column of grays
+    u8 indexes_[2][64];
+};
+
+// Indexed by (emphasis << 6) | color
+inline const NES_Color* Palette::GetColors() const
+{
+    return colors_;
+}
+
+// Grayscale is a swap of tables, never a test per pixel
+inline const NES_Color* Palette::GetColors(bool grayscale) const
+{
+    return grayscale ? grayscale_colors_ : colors_;
+}
+
+inline const u8* Palette::GetIndexes(bool grayscale) const
+{
+    return indexes_[grayscale ? 1 : 0];
+}
+
+} // namespace Gearnes
+
+#endif // PALETTE_H_
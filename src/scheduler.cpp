@@ -0,0 +1,134 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "scheduler.h"
+#include "memory.h"
+
+namespace Gearnes
+{
+
+Scheduler::Scheduler()
+{
+    InitPointer(processor_);
+    clock_cycles_ = 0;
+    processor_running_ = false;
+    next_event_ = kSchedulerEventVBlank;
+    next_event_time_ = kSchedulerNever;
+
+    for (int i = 0; i < kSchedulerEventCount; i++)
+    {
+        events_[i] = kSchedulerNever;
+    }
+}
+
+void Scheduler::Init(g6502::G6502<Memory>* processor)
+{
+    processor_ = processor;
+    Reset();
+}
+
+void Scheduler::Reset()
+{
+    clock_cycles_ = 0;
+    processor_running_ = false;
+
+    for (int i = 0; i < kSchedulerEventCount; i++)
+    {
+        events_[i] = kSchedulerNever;
+    }
+
+    UpdateNextEvent();
+}
+
+void Scheduler::Schedule(Scheduler_Event event, u64 timestamp)
+{
+    events_[event] = timestamp;
+
+    if (timestamp < next_event_time_)
+    {
+        next_event_ = event;
+        next_event_time_ = timestamp;
+
+        // Scheduled from inside the CPU batch (a register write), so the
+        // batch has to end early to serve it on time
+        if (processor_running_)
+        {
+            processor_->StopRunFor();
+        }
+    }
+    else if (event == next_event_)
+    {
+        UpdateNextEvent();
+    }
+}
+
+void Scheduler::Cancel(Scheduler_Event event)
+{
+    events_[event] = kSchedulerNever;
+
+    if (event == next_event_)
+    {
+        UpdateNextEvent();
+    }
+}
+
+void Scheduler::RunToNextEvent()
+{
+    while (clock_cycles_ < next_event_time_)
+    {
+        u64 remaining = next_event_time_ - clock_cycles_;
+        u64 t_states = (remaining + kMasterCyclesPerCPUCycle - 1) / kMasterCyclesPerCPUCycle;
+
+        if (t_states > 0x10000000)
+        {
+            t_states = 0x10000000;
+        }
+
+        processor_running_ = true;
+        unsigned int executed = processor_->RunFor(static_cast<unsigned int>(t_states));
+        processor_running_ = false;
+
+        clock_cycles_ += static_cast<u64>(executed) * kMasterCyclesPerCPUCycle;
+    }
+}
+
+Scheduler_Event Scheduler::PopEvent()
+{
+    Scheduler_Event event = next_event_;
+    events_[event] = kSchedulerNever;
+    UpdateNextEvent();
+    return event;
+}
+
+void Scheduler::UpdateNextEvent()
+{
+    next_event_ = kSchedulerEventVBlank;
+    next_event_time_ = kSchedulerNever;
+
+    for (int i = 0; i < kSchedulerEventCount; i++)
+    {
+        if (events_[i] < next_event_time_)
+        {
+            next_event_ = static_cast<Scheduler_Event>(i);
+            next_event_time_ = events_[i];
+        }
+    }
+}
+
+} // namespace Gearnes
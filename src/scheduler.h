@@ -0,0 +1,105 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef SCHEDULER_H_
+#define	SCHEDULER_H_
+
+#include "common.h"
+#include "G6502/g6502_core.h"
+
+namespace Gearnes
+{
+
+class Memory;
+
+// All timestamps are in master clock cycles (21.477 MHz on NTSC)
+const int kMasterCyclesPerCPUCycle = 12;
+const int kMasterCyclesPerPPUCycle = 4;
+
+const u64 kSchedulerNever = 0xFFFFFFFFFFFFFFFFULL;
+
+enum Scheduler_Event
+{
+    kSchedulerEventVBlank,
+    kSchedulerEventSprite0Hit,
+    kSchedulerEventFrameIRQ,
+    kSchedulerEventMapperIRQ,
+    kSchedulerEventDMCFetch,
+    // Only with a render thread, see VideoPipeline
+    kSchedulerEventRenderSync,
+    kSchedulerEventCount
+};
+
+class Scheduler
+{
+public:
+    Scheduler();
+    void Init(g6502::G6502<Memory>* processor);
+    void Reset();
+    u64 GetClockCycles() const;
+    void SetClockCycles(u64 clock_cycles);
+    void Schedule(Scheduler_Event event, u64 timestamp);
+    void Cancel(Scheduler_Event event);
+    bool IsScheduled(Scheduler_Event event) const;
+    u64 GetEventTime(Scheduler_Event event) const;
+    void RunToNextEvent();
+    Scheduler_Event PopEvent();
+
+private:
+    void UpdateNextEvent();
+
+private:
+    g6502::G6502<Memory>* processor_;
+    u64 clock_cycles_;
+    bool processor_running_;
+    // One slot per event type, the earliest one is cached in next_event_
+    u64 events_[kSchedulerEventCount];
+    Scheduler_Event next_event_;
+    u64 next_event_time_;
+};
+
+inline u64 Scheduler::GetClockCycles() const
+{
+    if (processor_running_)
+    {
+        return clock_cycles_ + (processor_->GetElapsedTStates() * kMasterCyclesPerCPUCycle);
+    }
+
+    return clock_cycles_;
+}
+
+// For a scheduler with no processor, whose clock nothing else moves
+inline void Scheduler::SetClockCycles(u64 clock_cycles)
+{
+    clock_cycles_ = clock_cycles;
+}
+
+inline bool Scheduler::IsScheduled(Scheduler_Event event) const
+{
+    return events_[event] != kSchedulerNever;
+}
+
+inline u64 Scheduler::GetEventTime(Scheduler_Event event) const
+{
+    return events_[event];
+}
+
+} // namespace Gearnes
+
+#endif // SCHEDULER_H_
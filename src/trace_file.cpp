@@ -0,0 +1,287 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <chrono>
+#include <cstring>
+#include "trace_file.h"
+
+// The implementation is built by cartridge.cpp, or by the tool linking this
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz/miniz.c"
+
+namespace Gearnes
+{
+
+static const int kTraceRecordBytes = sizeof(g6502::stTraceRecord);
+static const int kTraceBlockBytes = kTraceBlockRecords * kTraceRecordBytes;
+
+// Delta cycles and byte planes, see trace_file.h. records is left with
+// the deltas.
+static void SplitPlanes(g6502::stTraceRecord* records, int count, u8* planes)
+{
+    for (int i = count - 1; i > 0; i--)
+        records[i].cycles -= records[i - 1].cycles;
+
+    const u8* bytes = reinterpret_cast<const u8*>(records);
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int b = 0; b < kTraceRecordBytes; b++)
+            planes[(b * count) + i] = bytes[(i * kTraceRecordBytes) + b];
+    }
+}
+
+static void JoinPlanes(const u8* planes, int count, g6502::stTraceRecord* records)
+{
+    u8* bytes = reinterpret_cast<u8*>(records);
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int b = 0; b < kTraceRecordBytes; b++)
+            bytes[(i * kTraceRecordBytes) + b] = planes[(b * count) + i];
+    }
+
+    for (int i = 1; i < count; i++)
+        records[i].cycles += records[i - 1].cycles;
+}
+
+TraceFileWriter::TraceFileWriter()
+{
+    InitPointer(file_);
+    InitPointer(buffer_);
+    InitPointer(block_);
+    InitPointer(planes_);
+    InitPointer(compressed_);
+    running_.store(false);
+    compressed_size_ = mz_compressBound(kTraceBlockBytes);
+    records_ = 0;
+    compressed_bytes_ = 0;
+    full_waits_ = 0;
+}
+
+TraceFileWriter::~TraceFileWriter()
+{
+    Close();
+}
+
+bool TraceFileWriter::Open(const char* file_path)
+{
+    Close();
+
+    file_ = fopen(file_path, "wb");
+
+    if (!IsValidPointer(file_))
+    {
+        LogError(kLogCore, "TraceFileWriter: unable to open %s", file_path);
+        return false;
+    }
+
+    u32 version = kTraceFileVersion;
+    u32 record_size = sizeof(g6502::stTraceRecord);
+    fwrite(kTraceFileMagic, 1, sizeof(kTraceFileMagic), file_);
+    fwrite(&version, sizeof(version), 1, file_);
+    fwrite(&record_size, sizeof(record_size), 1, file_);
+
+    buffer_ = new g6502::TraceBuffer(kBufferRecords);
+    block_ = new g6502::stTraceRecord[kTraceBlockRecords];
+    planes_ = new u8[kTraceBlockBytes];
+    compressed_ = new u8[compressed_size_];
+    records_ = 0;
+    compressed_bytes_ = 0;
+    full_waits_ = 0;
+
+    running_.store(true);
+    thread_ = std::thread(&TraceFileWriter::Run, this);
+
+    return true;
+}
+
+// Waits for every record in the ring to reach the file. The CPU must not
+// be writing to the buffer anymore.
+void TraceFileWriter::Close()
+{
+    if (!IsValidPointer(file_))
+        return;
+
+    running_.store(false);
+    thread_.join();
+
+    fclose(file_);
+    InitPointer(file_);
+    full_waits_ = buffer_->GetFullWaits();
+    SafeDelete(buffer_);
+    SafeDeleteArray(block_);
+    SafeDeleteArray(planes_);
+    SafeDeleteArray(compressed_);
+}
+
+bool TraceFileWriter::IsOpen() const
+{
+    return IsValidPointer(file_);
+}
+
+g6502::TraceBuffer* TraceFileWriter::GetBuffer()
+{
+    return buffer_;
+}
+
+u64 TraceFileWriter::GetRecords() const
+{
+    return records_;
+}
+
+u64 TraceFileWriter::GetCompressedBytes() const
+{
+    return compressed_bytes_;
+}
+
+// Times the CPU had to wait for the writer, known once closed
+u64 TraceFileWriter::GetFullWaits() const
+{
+    return full_waits_;
+}
+
+// Fills whole blocks while tracing goes on, so they compress well, and
+// flushes the last partial one on Close()
+void TraceFileWriter::Run()
+{
+    int count = 0;
+
+    while (true)
+    {
+        bool stopping = !running_.load();
+
+        count += buffer_->Read(block_ + count, kTraceBlockRecords - count);
+
+        if (count == kTraceBlockRecords)
+        {
+            WriteBlock(count);
+            count = 0;
+        }
+        else if (stopping && buffer_->IsEmpty())
+        {
+            if (count > 0)
+                WriteBlock(count);
+            break;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    fflush(file_);
+}
+
+bool TraceFileWriter::WriteBlock(int count)
+{
+    mz_ulong size = compressed_size_;
+
+    SplitPlanes(block_, count, planes_);
+
+    if (mz_compress2(compressed_, &size, planes_, count * kTraceRecordBytes, MZ_BEST_SPEED) != MZ_OK)
+    {
+        LogError(kLogCore, "TraceFileWriter: compression failed");
+        return false;
+    }
+
+    u32 header[2] = { static_cast<u32>(count), static_cast<u32>(size) };
+    fwrite(header, sizeof(header), 1, file_);
+    fwrite(compressed_, 1, size, file_);
+
+    records_ += count;
+    compressed_bytes_ += sizeof(header) + size;
+
+    return true;
+}
+
+TraceFileReader::TraceFileReader()
+{
+    InitPointer(file_);
+    compressed_size_ = mz_compressBound(kTraceBlockBytes);
+    planes_ = new u8[kTraceBlockBytes];
+    compressed_ = new u8[compressed_size_];
+}
+
+TraceFileReader::~TraceFileReader()
+{
+    Close();
+    SafeDeleteArray(planes_);
+    SafeDeleteArray(compressed_);
+}
+
+bool TraceFileReader::Open(const char* file_path)
+{
+    Close();
+
+    file_ = fopen(file_path, "rb");
+
+    if (!IsValidPointer(file_))
+        return false;
+
+    char magic[8];
+    u32 version = 0;
+    u32 record_size = 0;
+
+    if ((fread(magic, 1, sizeof(magic), file_) != sizeof(magic)) || (memcmp(magic, kTraceFileMagic, sizeof(magic)) != 0) ||
+            (fread(&version, sizeof(version), 1, file_) != 1) || (fread(&record_size, sizeof(record_size), 1, file_) != 1) ||
+            (version != kTraceFileVersion) || (record_size != sizeof(g6502::stTraceRecord)))
+    {
+        LogError(kLogCore, "TraceFileReader: %s is not a trace file", file_path);
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void TraceFileReader::Close()
+{
+    if (IsValidPointer(file_))
+    {
+        fclose(file_);
+        InitPointer(file_);
+    }
+}
+
+// Reads the next block into records, which must hold kTraceBlockRecords.
+// Returns the records read, 0 at the end of the file and -1 on errors.
+int TraceFileReader::ReadBlock(g6502::stTraceRecord* records)
+{
+    u32 header[2];
+
+    if (!IsValidPointer(file_) || (fread(header, sizeof(header), 1, file_) != 1))
+        return 0;
+
+    if ((header[0] > static_cast<u32>(kTraceBlockRecords)) || (header[1] > compressed_size_) ||
+            (fread(compressed_, 1, header[1], file_) != header[1]))
+        return -1;
+
+    int count = static_cast<int>(header[0]);
+    mz_ulong size = count * kTraceRecordBytes;
+
+    if ((mz_uncompress(planes_, &size, compressed_, header[1]) != MZ_OK) || (size != static_cast<mz_ulong>(count * kTraceRecordBytes)))
+        return -1;
+
+    JoinPlanes(planes_, count, records);
+
+    return count;
+}
+
+} // namespace Gearnes
@@ -0,0 +1,97 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef TRACE_FILE_H_
+#define	TRACE_FILE_H_
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include "common.h"
+#include "G6502/g6502_trace.h"
+
+namespace Gearnes
+{
+
+// CPU trace file: a header, then blocks of g6502::stTraceRecord, each one
+// compressed on its own with miniz
+//   header: "GNTRACE\0", u32 version, u32 record size
+//   block:  u32 record count, u32 compressed size, compressed records
+// Before compression the cycle counts become deltas from the previous
+// record and the records are split in byte planes (byte 0 of every
+// record, then byte 1...). Most planes are then long runs, which deflate
+// much faster and smaller. Everything is in host byte order.
+const char kTraceFileMagic[8] = { 'G', 'N', 'T', 'R', 'A', 'C', 'E', 0 };
+const u32 kTraceFileVersion = 1;
+const int kTraceBlockRecords = 4096;
+
+// Owns the ring the CPU writes to and a thread that drains it to disk, so
+// compression and I/O stay off the emulation thread
+class TraceFileWriter
+{
+public:
+    TraceFileWriter();
+    ~TraceFileWriter();
+    bool Open(const char* file_path);
+    void Close();
+    bool IsOpen() const;
+    g6502::TraceBuffer* GetBuffer();
+    u64 GetRecords() const;
+    u64 GetCompressedBytes() const;
+    u64 GetFullWaits() const;
+
+private:
+    void Run();
+    bool WriteBlock(int count);
+
+private:
+    static const int kBufferRecords = 1 << 18;
+
+    FILE* file_;
+    g6502::TraceBuffer* buffer_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    g6502::stTraceRecord* block_;
+    u8* planes_;
+    u8* compressed_;
+    unsigned long compressed_size_;
+    u64 records_;
+    u64 compressed_bytes_;
+    u64 full_waits_;
+};
+
+class TraceFileReader
+{
+public:
+    TraceFileReader();
+    ~TraceFileReader();
+    bool Open(const char* file_path);
+    void Close();
+    int ReadBlock(g6502::stTraceRecord* records);
+
+private:
+    FILE* file_;
+    u8* planes_;
+    u8* compressed_;
+    unsigned long compressed_size_;
+};
+
+} // namespace Gearnes
+
+#endif // TRACE_FILE_H_
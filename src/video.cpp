@@ -19,23 +19,88 @@
 
 #include <cstring>
 #include "video.h"
+#include "memory.h"
+#include "compositor.h"
+#include "palette.h"
+#include "video_pipeline.h"
 
 namespace Gearnes
 {
 
+// How far the render thread can fall behind, in master cycles
+static const u64 kRenderSyncCycles = 8 * NES_PPU_CYCLES_PER_LINE * kMasterCyclesPerPPUCycle;
+
 Video::Video()
 {
+    InitPointer(cartridge_);
+    InitPointer(scheduler_);
+    InitPointer(processor_);
+    InitPointer(frame_buffer_);
+    InitPointer(indexed_frame_buffer_);
+    InitPointer(chr_);
+    chr_cache_ = new CHRCache();
+    output_palette_ = new Palette();
+
+    for (int i = 0; i < 8; i++)
+    {
+        InitPointer(pages_[i]);
+        InitPointer(pattern_rows_[i]);
+        pages_[8 + i] = vram_ + ((i & 0x03) * 0x400);
+    }
+
     memset(registers_, 0, 8);
+    memset(oam_, 0, 0x100);
+    memset(palette_, 0, 0x20);
+    memset(vram_, 0, 0x1000);
     latch_ = 0x00;
+    read_buffer_ = 0x00;
+    v_ = 0;
+    t_ = 0;
+    x_ = 0;
+    w_ = false;
+    frame_start_ = 0;
+    frame_cycle_ = 0;
+    render_line_ = -1;
+    render_x_ = 0;
+    render_h_ = 0;
+    skip_rendering_ = true;
+    sprite0_x_ = -1;
+    InitPointer(pipeline_);
+    replica_ = false;
+    InitPointer(chr_copy_);
+    chr_copy_size_ = 0;
+    compositor_ = GetCompositor(GetBestCompositorPath());
 }
 
 Video::~Video()
 {
-    
+    if (!replica_)
+    {
+        SafeDelete(output_palette_);
+    }
+    SafeDeleteArray(chr_copy_);
+    SafeDelete(chr_cache_);
+}
+
+void Video::Init(Cartridge* cartridge, Scheduler* scheduler, g6502::G6502<Memory>* processor)
+{
+    cartridge_ = cartridge;
+    scheduler_ = scheduler;
+    processor_ = processor;
+    output_palette_->Init();
+    Reset();
 }
 
-void Video::Init()
+// See VideoPipeline. scheduler only keeps the replayed time, there is no
+// processor to interrupt.
+void Video::InitReplica(Cartridge* cartridge, Scheduler* scheduler, Palette* palette)
 {
+    SafeDelete(output_palette_);
+    output_palette_ = palette;
+    replica_ = true;
+    cartridge_ = cartridge;
+    scheduler_ = scheduler;
+    InitPointer(processor_);
     Reset();
 }
 
@@ -50,28 +115,827 @@ void Video::Reset()
     registers_[6] = 0x00;
     registers_[7] = 0x00;
 
+    memset(oam_, 0, 0x100);
+    memset(palette_, 0, 0x20);
+    memset(vram_, 0, 0x1000);
     latch_ = 0x00;
+    read_buffer_ = 0x00;
+    v_ = 0;
+    t_ = 0;
+    x_ = 0;
+    w_ = false;
+
+    frame_start_ = scheduler_->GetClockCycles();
+    frame_cycle_ = 0;
+    render_line_ = -1;
+    render_x_ = 0;
+    render_h_ = 0;
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->Reset(frame_start_);
+    }
+
+    // Power on layout, the mapper sets its own after this
+    chr_ = cartridge_->GetCHRROM();
+
+    if (replica_ && IsValidPointer(chr_) && cartridge_->HasCHRRAM())
+    {
+        if (chr_copy_size_ != cartridge_->GetCHRROMSize())
+        {
+            SafeDeleteArray(chr_copy_);
+            chr_copy_size_ = cartridge_->GetCHRROMSize();
+            chr_copy_ = new u8[chr_copy_size_];
+        }
+
+        memcpy(chr_copy_, chr_, chr_copy_size_);
+        chr_ = chr_copy_;
+    }
+
+    if (IsValidPointer(chr_))
+    {
+        chr_cache_->Build(chr_, cartridge_->GetCHRROMSize());
+        MapCHR(0x0000, 0x2000, 0);
+    }
+    else
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            InitPointer(pages_[i]);
+            InitPointer(pattern_rows_[i]);
+        }
+    }
+    SetMirroring(cartridge_->GetMirroring());
+
+    scheduler_->Schedule(kSchedulerEventVBlank, GetLineTime(NES_VBLANK_LINE, 1));
+    scheduler_->Cancel(kSchedulerEventSprite0Hit);
+
+    if (IsValidPointer(pipeline_))
+    {
+        scheduler_->Schedule(kSchedulerEventRenderSync, frame_start_ + kRenderSyncCycles);
+    }
+    else
+    {
+        scheduler_->Cancel(kSchedulerEventRenderSync);
+    }
+}
+
+// Hands rendering to pipeline from the next Reset(), the replica has to
+// start from the same state. nullptr renders here again.
+void Video::SetPipeline(VideoPipeline* pipeline)
+{
+    pipeline_ = pipeline;
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->SetCompositor(compositor_);
+    }
+}
+
+// Scheduled every few lines while there is a pipeline, so the render
+// thread draws along with the CPU instead of all at once at VBlank
+void Video::SyncPipeline()
+{
+    u64 now = scheduler_->GetClockCycles();
+    pipeline_->Sync(now);
+    scheduler_->Schedule(kSchedulerEventRenderSync, now + kRenderSyncCycles);
+}
+
+// nullptr skips rendering: timing, VBlank, sprite 0 hit and sprite
+// overflow stay exact but no pixels are written
+void Video::SetFrameBuffer(NES_Color* frame_buffer)
+{
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->SetFrameBuffer(scheduler_->GetClockCycles(), frame_buffer, nullptr);
+        InitPointer(frame_buffer);
+    }
+
+    frame_buffer_ = frame_buffer;
+    InitPointer(indexed_frame_buffer_);
+    skip_rendering_ = !IsValidPointer(frame_buffer);
+}
+
+// NES_INDEXED_FRAME_SIZE bytes, see palette.h. nullptr skips rendering.
+void Video::SetIndexedFrameBuffer(u8* frame_buffer)
+{
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->SetFrameBuffer(scheduler_->GetClockCycles(), nullptr, frame_buffer);
+        InitPointer(frame_buffer);
+    }
+
+    indexed_frame_buffer_ = frame_buffer;
+    InitPointer(frame_buffer_);
+    skip_rendering_ = !IsValidPointer(frame_buffer);
+}
+
+Palette* Video::GetPalette()
+{
+    return output_palette_;
+}
+
+void Video::SetCompositor(CompositorFunction compositor)
+{
+    compositor_ = compositor;
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->SetCompositor(compositor);
+    }
+}
+
+void Video::SetMirroring(NES_Mirroring mirroring)
+{
+    switch (mirroring)
+    {
+        case kMirroringHorizontal:
+            MapNametable(0, 0);
+            MapNametable(1, 0);
+            MapNametable(2, 1);
+            MapNametable(3, 1);
+            break;
+        case kMirroringVertical:
+            MapNametable(0, 0);
+            MapNametable(1, 1);
+            MapNametable(2, 0);
+            MapNametable(3, 1);
+            break;
+        case kMirroringFourScreen:
+            for (int i = 0; i < 4; i++)
+            {
+                MapNametable(i, i);
+            }
+            break;
+        case kMirroringSingleScreenLow:
+            for (int i = 0; i < 4; i++)
+            {
+                MapNametable(i, 0);
+            }
+            break;
+        case kMirroringSingleScreenHigh:
+            for (int i = 0; i < 4; i++)
+            {
+                MapNametable(i, 1);
+            }
+            break;
+    }
+}
+
+// Points nametable 0-3 ($2000, $2400, $2800, $2C00 and their $3000
+// mirrors) at 1 KB page 0-3 of VRAM, for mappers with their own mirroring
+void Video::MapNametable(int nametable, int vram_page)
+{
+    RenderToNow();
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->MapNametable(scheduler_->GetClockCycles(), nametable, vram_page);
+    }
+
+    pages_[8 + nametable] = vram_ + (vram_page * 0x400);
+    pages_[12 + nametable] = pages_[8 + nametable];
+}
+
+// Maps size bytes of CHR memory from offset at PPU address, both in 1 KB
+// steps. Bank switches in the middle of a line take effect at the
+// current dot.
+void Video::MapCHR(u16 address, int size, int offset)
+{
+    RenderToNow();
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->MapCHR(scheduler_->GetClockCycles(), address, size, offset);
+    }
+
+    int first_page = address >> 10;
+    int page_count = size >> 10;
+
+    for (int i = 0; i < page_count; i++)
+    {
+        int chr_offset = offset + (i << 10);
+        pages_[first_page + i] = chr_ + chr_offset;
+        pattern_rows_[first_page + i] = chr_cache_->GetRow(chr_offset);
+    }
+}
+
+void Video::Sync(u64 timestamp)
+{
+    if (timestamp <= frame_start_)
+    {
+        return;
+    }
+
+    u64 target = (timestamp - frame_start_) / kMasterCyclesPerPPUCycle;
+
+    // Runs a scanline at a time, stopping only at the dots that do
+    // something: status flags, pixel output and VRAM address updates.
+    // Dots in (from, to] are processed on each step.
+    while (static_cast<u64>(frame_cycle_) < target)
+    {
+        int line = frame_cycle_ / NES_PPU_CYCLES_PER_LINE;
+        int line_start = line * NES_PPU_CYCLES_PER_LINE;
+        int line_end = line_start + NES_PPU_CYCLES_PER_LINE;
+        int next = (target < static_cast<u64>(line_end)) ? static_cast<int>(target) : line_end;
+        int from = frame_cycle_ - line_start;
+        int to = next - line_start;
+        bool fetching = ((registers_[1] & 0x18) != 0) && ((line < NES_HEIGHT) || (line == NES_PRERENDER_LINE));
+
+        if ((from < 1) && (1 <= to))
+        {
+            if (line == NES_VBLANK_LINE)
+            {
+                registers_[2] |= 0x80;
+            }
+            else if (line == NES_PRERENDER_LINE)
+            {
+                // Clear VBlank, sprite 0 hit and sprite overflow
+                registers_[2] &= 0x1F;
+            }
+        }
+
+        if ((from < 256) && (256 <= to))
+        {
+            if (line < NES_HEIGHT)
+            {
+                ScanLine(line);
+            }
+            if (fetching)
+            {
+                IncrementY();
+            }
+        }
+
+        if (fetching && (from < 257) && (257 <= to))
+        {
+            v_ = (v_ & ~0x041F) | (t_ & 0x041F);
+        }
+
+        if (fetching && (line == NES_PRERENDER_LINE) && (from < 280) && (280 <= to))
+        {
+            v_ = (v_ & ~0x7BE0) | (t_ & 0x7BE0);
+        }
+
+        frame_cycle_ = next;
+
+        if (frame_cycle_ == NES_PPU_CYCLES_PER_FRAME)
+        {
+            frame_start_ += static_cast<u64>(NES_PPU_CYCLES_PER_FRAME) * kMasterCyclesPerPPUCycle;
+            target -= NES_PPU_CYCLES_PER_FRAME;
+            frame_cycle_ = 0;
+        }
+    }
 }
 
-bool Video::Tick(unsigned int clock_cycles, NES_Color* frame_buffer)
+void Video::StartVBlank()
 {
-    return true;
+    CatchUp();
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->EndFrame(scheduler_->GetClockCycles());
+    }
+
+    if (((registers_[0] & 0x80) != 0) && IsValidPointer(processor_))
+    {
+        processor_->RequestNMI();
+    }
+
+    scheduler_->Schedule(kSchedulerEventVBlank, GetLineTime(NES_VBLANK_LINE + NES_LINES_PER_FRAME, 1));
+    UpdateSprite0Prediction();
+}
+
+void Video::Sprite0Hit()
+{
+    RenderToNow();
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->Sprite0Hit(scheduler_->GetClockCycles());
+    }
+
+    UpdateSprite0Prediction();
+}
+
+unsigned int Video::OAMDMA(const u8* data)
+{
+    CatchUp();
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->OAMDMA(scheduler_->GetClockCycles(), data);
+    }
+
+    for (int i = 0; i < 0x100; i++)
+    {
+        oam_[(registers_[3] + i) & 0xFF] = data[i];
+    }
+
+    UpdateSprite0Prediction();
+
+    // 513 CPU cycles, plus one if the write landed on an odd cycle
+    u64 cpu_cycle = scheduler_->GetClockCycles() / kMasterCyclesPerCPUCycle;
+    return 513 + static_cast<unsigned int>(cpu_cycle & 1);
+}
+
+void Video::UpdateSprite0Prediction()
+{
+    if (((registers_[1] & 0x18) != 0x18) || (oam_[0] >= (NES_HEIGHT - 1)))
+    {
+        scheduler_->Cancel(kSchedulerEventSprite0Hit);
+        return;
+    }
+
+    // Earliest dot the flag can be set. Past it, wait for the next frame.
+    u64 time = GetLineTime(oam_[0] + 1, oam_[3] + 1);
+
+    if ((time <= scheduler_->GetClockCycles()) || ((registers_[2] & 0x40) != 0))
+    {
+        time += static_cast<u64>(NES_PPU_CYCLES_PER_FRAME) * kMasterCyclesPerPPUCycle;
+    }
+
+    scheduler_->Schedule(kSchedulerEventSprite0Hit, time);
+}
+
+bool Video::IsSprite0Line(int line) const
+{
+    int height = ((registers_[0] & 0x20) != 0) ? 16 : 8;
+    int row = line - (oam_[0] + 1);
+
+    return ((registers_[1] & 0x18) == 0x18) && (row >= 0) && (row < height);
+}
+
+// CPU T-states from now during which reading $2002 keeps returning the
+// same value. VBlank is raised by a scheduler event, which bounds any
+// skip anyway; sprite 0 hit and overflow can be set by any line that has
+// the sprites, so those count from the start of the line.
+unsigned int Video::GetStatusIdleLimit()
+{
+    CatchUp();
+
+    if ((registers_[2] & 0x80) != 0)
+    {
+        // The next read clears it
+        return 0;
+    }
+
+    u64 now = scheduler_->GetClockCycles();
+    u64 stable = kSchedulerNever;
+
+    if ((registers_[2] & 0x60) != 0)
+    {
+        stable = GetLineTime(NES_PRERENDER_LINE, 1);
+    }
+
+    bool hit = ((registers_[1] & 0x18) == 0x18) && ((registers_[2] & 0x40) == 0);
+    bool overflow = ((registers_[1] & 0x18) != 0) && ((registers_[2] & 0x20) == 0);
+
+    if (hit || overflow)
+    {
+        u8 sprites[NES_HEIGHT] = { };
+
+        if (overflow)
+        {
+            int height = ((registers_[0] & 0x20) != 0) ? 16 : 8;
+
+            for (int i = 0; i < 64; i++)
+            {
+                for (int row = 0; row < height; row++)
+                {
+                    int line = oam_[i << 2] + 1 + row;
+
+                    if (line < NES_HEIGHT)
+                    {
+                        sprites[line]++;
+                    }
+                }
+            }
+        }
+
+        // From the current line, unless it is done, through the same
+        // point of the next frame
+        int line = frame_cycle_ / NES_PPU_CYCLES_PER_LINE;
+        int first = ((frame_cycle_ - (line * NES_PPU_CYCLES_PER_LINE)) < NES_WIDTH) ? line : line + 1;
+
+        for (int i = first; i < (line + NES_LINES_PER_FRAME); i++)
+        {
+            int visible = i % NES_LINES_PER_FRAME;
+
+            if ((visible < NES_HEIGHT) && ((hit && IsSprite0Line(visible)) || (overflow && (sprites[visible] > 8))))
+            {
+                u64 time = (i == line) ? now : GetLineTime(i, 0);
+                stable = (time < stable) ? time : stable;
+                break;
+            }
+        }
+    }
+
+    if (stable == kSchedulerNever)
+    {
+        return g6502::kIdleReadUnlimited;
+    }
+
+    if (stable <= now)
+    {
+        return 0;
+    }
+
+    u64 limit = (stable - now) / kMasterCyclesPerCPUCycle;
+
+    return (limit < g6502::kIdleReadUnlimited) ? static_cast<unsigned int>(limit) : g6502::kIdleReadUnlimited - 1;
+}
+
+// Runs the PPU up to now and draws the current line up to the current
+// dot, before something it depends on changes. Returns that line or -1.
+int Video::RenderToNow()
+{
+    CatchUp();
+
+    int line = GetRenderingLine();
+
+    if (line >= 0)
+    {
+        RenderSegment(line, frame_cycle_ - (line * NES_PPU_CYCLES_PER_LINE));
+    }
+
+    return line;
+}
+
+// Visible line whose pixels are being output right now, or -1
+int Video::GetRenderingLine() const
+{
+    int line = frame_cycle_ / NES_PPU_CYCLES_PER_LINE;
+    int dot = frame_cycle_ - (line * NES_PPU_CYCLES_PER_LINE);
+
+    return ((line < NES_HEIGHT) && (dot > 0) && (dot < NES_WIDTH)) ? line : -1;
+}
+
+void Video::IncrementY()
+{
+    if ((v_ & 0x7000) != 0x7000)
+    {
+        v_ += 0x1000;
+        return;
+    }
+
+    v_ &= ~0x7000;
+    int coarse_y = (v_ & 0x03E0) >> 5;
+
+    if (coarse_y == 29)
+    {
+        coarse_y = 0;
+        v_ ^= 0x0800;
+    }
+    else if (coarse_y == 31)
+    {
+        coarse_y = 0;
+    }
+    else
+    {
+        coarse_y++;
+    }
+
+    v_ = (v_ & ~0x03E0) | (coarse_y << 5);
 }
 
 void Video::ScanLine(int line)
 {
-    
+    RenderSegment(line, NES_WIDTH);
+}
+
+// Draws the current line from where it was left up to x_end
+void Video::RenderSegment(int line, int x_end)
+{
+    if (render_line_ != line)
+    {
+        render_line_ = line;
+        render_x_ = 0;
+        // Horizontal nametable bit and coarse X of the first tile
+        render_h_ = ((v_ >> 5) & 0x20) | (v_ & 0x1F);
+        EvaluateSprites(line);
+    }
+
+    if (x_end <= render_x_)
+    {
+        return;
+    }
+
+    if (skip_rendering_)
+    {
+        TestSprite0Hit(render_x_, x_end);
+    }
+    else
+    {
+        RenderBackground(render_x_, x_end);
+        ComposePixels(line, render_x_, x_end);
+    }
+
+    render_x_ = x_end;
+}
+
+// Sprite overflow always, sprite pixels only when rendering. Skipping,
+// just sprite 0 is drawn for TestSprite0Hit().
+void Video::EvaluateSprites(int line)
+{
+    sprite0_x_ = -1;
+
+    if (!skip_rendering_)
+    {
+        memset(sprite_line_, 0, NES_WIDTH);
+    }
+
+    if ((registers_[1] & 0x18) == 0)
+    {
+        return;
+    }
+
+    bool show = (registers_[1] & 0x10) != 0;
+    int height = ((registers_[0] & 0x20) != 0) ? 16 : 8;
+    int count = 0;
+
+    for (int i = 0; i < 64; i++)
+    {
+        const u8* sprite = &oam_[i << 2];
+        int row = line - (sprite[0] + 1);
+
+        if ((row < 0) || (row >= height))
+        {
+            continue;
+        }
+
+        if (count == 8)
+        {
+            registers_[2] |= 0x20;
+            break;
+        }
+
+        count++;
+
+        if (!show || (skip_rendering_ && (i != 0)))
+        {
+            continue;
+        }
+
+        u8 attributes = sprite[2];
+
+        if ((attributes & 0x80) != 0)
+        {
+            row = height - 1 - row;
+        }
+
+        u16 address;
+
+        if (height == 16)
+        {
+            address = ((sprite[1] & 0x01) << 12) | ((sprite[1] & 0xFE) << 4);
+            if (row >= 8)
+            {
+                address += 16;
+                row -= 8;
+            }
+        }
+        else
+        {
+            address = ((registers_[0] & 0x08) << 9) | (sprite[1] << 4);
+        }
+
+        address += row;
+
+        const u8* pixels = GetPatternRow(address);
+        // Bits 0-4 palette entry, bit 6 behind background, bit 7 sprite 0
+        u8 flags = 0x10 | ((attributes & 0x03) << 2) | ((attributes & 0x20) << 1) | ((i == 0) ? 0x80 : 0x00);
+        bool flip = (attributes & 0x40) != 0;
+
+        if (i == 0)
+        {
+            sprite0_x_ = sprite[3];
+
+            if (skip_rendering_)
+            {
+                memset(sprite_line_ + sprite0_x_, 0, (sprite0_x_ < NES_WIDTH - 8) ? 8 : NES_WIDTH - sprite0_x_);
+            }
+        }
+
+        for (int p = 0; p < 8; p++)
+        {
+            int x = sprite[3] + p;
+
+            if (x >= NES_WIDTH)
+            {
+                break;
+            }
+
+            u8 color = pixels[flip ? 7 - p : p];
+
+            // Lower OAM indexes win, even when they end up behind the background
+            if ((color != 0) && (sprite_line_[x] == 0))
+            {
+                sprite_line_[x] = flags | color;
+            }
+        }
+    }
+}
+
+void Video::RenderBackground(int x_start, int x_end)
+{
+    if ((registers_[1] & 0x08) == 0)
+    {
+        memset(bg_line_ + 8 + x_start, 0, x_end - x_start);
+        return;
+    }
+
+    int fine_y = (v_ >> 12) & 0x07;
+    int coarse_y = (v_ >> 5) & 0x1F;
+    int nametable_y = (v_ >> 10) & 0x02;
+    int pattern_table = (((registers_[0] & 0x10) != 0) ? 0x1000 : 0x0000) + fine_y;
+    int name_row = coarse_y << 5;
+    int attribute_row = 0x3C0 | ((coarse_y >> 2) << 3);
+    int attribute_shift = (coarse_y & 0x02) << 1;
+
+    // Left edge of the tile under x_start, it may start before the segment
+    int x = x_start - ((x_start + x_) & 0x07);
+
+    while (x < x_end)
+    {
+        int h = (render_h_ + ((x + x_) >> 3)) & 0x3F;
+        int coarse_x = h & 0x1F;
+        const u8* nametable = pages_[8 | (h >> 5) | nametable_y];
+
+        u8 tile = nametable[name_row | coarse_x];
+        u8 attribute = nametable[attribute_row | (coarse_x >> 2)];
+        u64 palette = ((attribute >> (attribute_shift | (coarse_x & 0x02))) & 0x03) << 2;
+
+        u64 pixels;
+        memcpy(&pixels, GetPatternRow(pattern_table + (tile << 4)), 8);
+
+        // Add the palette to the opaque pixels, each byte on its own
+        u64 opaque = (pixels | (pixels >> 1)) & 0x0101010101010101ULL;
+        pixels |= opaque * palette;
+
+        memcpy(bg_line_ + 8 + x, &pixels, 8);
+
+        x += 8;
+    }
+}
+
+void Video::ComposePixels(int line, int x_start, int x_end)
+{
+    u8 mask = registers_[1];
+    bool grayscale = (mask & 0x01) != 0;
+    u8 emphasis = mask >> 5;
+    const NES_Color* palette_colors = output_palette_->GetColors(grayscale) + (emphasis << 6);
+    const u8* palette_indexes = output_palette_->GetIndexes(grayscale);
+
+    NES_Color colors[0x20];
+    u8 indexes[0x20];
+
+    for (int i = 0; i < 0x20; i++)
+    {
+        indexes[i] = palette_indexes[palette_[i]];
+        colors[i] = palette_colors[palette_[i]];
+    }
+
+    stCompositorLine compositor_line;
+    compositor_line.background = bg_line_ + 8;
+    compositor_line.sprites = sprite_line_;
+    compositor_line.colors = colors;
+    compositor_line.indexes = indexes;
+
+    if (IsValidPointer(indexed_frame_buffer_))
+    {
+        // Emphasis is kept per line, the last segment drawn sets it
+        InitPointer(compositor_line.output);
+        compositor_line.indexed_output = indexed_frame_buffer_ + (line * NES_WIDTH);
+        indexed_frame_buffer_[(NES_WIDTH * NES_HEIGHT) + line] = emphasis;
+    }
+    else
+    {
+        compositor_line.output = frame_buffer_ + (line * NES_WIDTH);
+        InitPointer(compositor_line.indexed_output);
+    }
+
+    compositor_line.background_start = ((mask & 0x08) == 0) ? NES_WIDTH : (((mask & 0x02) != 0) ? 0 : 8);
+    compositor_line.sprites_start = ((mask & 0x10) == 0) ? NES_WIDTH : (((mask & 0x04) != 0) ? 0 : 8);
+
+    if (compositor_(compositor_line, x_start, x_end) >= 0)
+    {
+        registers_[2] |= 0x40;
+    }
+}
+
+// Render-skip version of ComposePixels(): the background is drawn only
+// under sprite 0, and only until the hit is found. Same rules as the
+// compositors: both layers opaque, clipping applies, never at x 255.
+void Video::TestSprite0Hit(int x_start, int x_end)
+{
+    u8 mask = registers_[1];
+
+    if ((sprite0_x_ < 0) || ((registers_[2] & 0x40) != 0) || ((mask & 0x18) != 0x18))
+    {
+        return;
+    }
+
+    int background_start = ((mask & 0x02) != 0) ? 0 : 8;
+    int sprites_start = ((mask & 0x04) != 0) ? 0 : 8;
+    int start = (x_start > sprite0_x_) ? x_start : sprite0_x_;
+    int end = (x_end < sprite0_x_ + 8) ? x_end : sprite0_x_ + 8;
+
+    start = (start > background_start) ? start : background_start;
+    start = (start > sprites_start) ? start : sprites_start;
+    end = (end < (NES_WIDTH - 1)) ? end : (NES_WIDTH - 1);
+
+    if (start >= end)
+    {
+        return;
+    }
+
+    RenderBackground(start, end);
+
+    for (int x = start; x < end; x++)
+    {
+        if (((sprite_line_[x] & 0x80) != 0) && (bg_line_[8 + x] != 0))
+        {
+            registers_[2] |= 0x40;
+            return;
+        }
+    }
+}
+
+void Video::WriteVRAM(u16 address, u8 value)
+{
+    address &= 0x3FFF;
+
+    if (address < 0x2000)
+    {
+        if (cartridge_->HasCHRRAM())
+        {
+            u8* page = pages_[address >> 10];
+            page[address & 0x03FF] = value;
+            chr_cache_->Update(static_cast<int>(page - chr_) + (address & 0x03FF));
+        }
+    }
+    else if (address < 0x3F00)
+    {
+        pages_[address >> 10][address & 0x03FF] = value;
+    }
+    else
+    {
+        u8 index = address & 0x1F;
+        palette_[((index & 0x13) == 0x10) ? (index & 0x0F) : index] = value & 0x3F;
+    }
 }
 
 u8 Video::Read(u16 address)
 {
+    CatchUp();
+
+    // Reading the status or data register changes the VRAM address
+    if (IsValidPointer(pipeline_) && ((address == 2) || (address == 7)))
+    {
+        pipeline_->Read(scheduler_->GetClockCycles(), address);
+    }
+
     switch (address)
     {
         case 2:
+        {
+            // Polling for sprite 0 hit needs the pixels up to now
+            int line = GetRenderingLine();
+            if ((line >= 0) && ((registers_[2] & 0x40) == 0) && IsSprite0Line(line))
+            {
+                RenderSegment(line, frame_cycle_ - (line * NES_PPU_CYCLES_PER_LINE));
+            }
+
+            // Status, reading it clears the VBlank flag and the write toggle
+            latch_ = (registers_[2] & 0xE0) | (latch_ & 0x1F);
+            registers_[2] &= 0x7F;
+            w_ = false;
+            return latch_;
+        }
         case 4:
+        {
+            latch_ = oam_[registers_[3]];
+            return latch_;
+        }
         case 7:
         {
-            latch_ = registers_[address];
+            u16 vram_address = v_ & 0x3FFF;
+
+            if (vram_address < 0x3F00)
+            {
+                // Buffered
+                latch_ = read_buffer_;
+                read_buffer_ = ReadVRAM(vram_address);
+            }
+            else
+            {
+                // Palette reads are immediate, the buffer gets the nametable below
+                latch_ = (ReadVRAM(vram_address) & 0x3F) | (latch_ & 0xC0);
+                read_buffer_ = ReadVRAM(vram_address - 0x1000);
+            }
+
+            v_ = (v_ + (((registers_[0] & 0x04) != 0) ? 32 : 1)) & 0x7FFF;
             return latch_;
         }
         default:
@@ -83,19 +947,91 @@ u8 Video::Read(u16 address)
 
 void Video::Write(u16 address, u8 value)
 {
+    // A register write in the middle of a visible line: draw the line up
+    // to this point with the old state
+    int line = RenderToNow();
+
+    if (IsValidPointer(pipeline_))
+    {
+        pipeline_->Write(scheduler_->GetClockCycles(), address, value);
+    }
+
     latch_ = value;
 
     switch (address)
     {
+        case 0:
+        {
+            // Enabling NMI during VBlank triggers it immediately
+            bool nmi_enabled = (registers_[0] & 0x80) != 0;
+            registers_[0] = latch_;
+            t_ = (t_ & ~0x0C00) | ((latch_ & 0x03) << 10);
+            if (!nmi_enabled && ((latch_ & 0x80) != 0) && ((registers_[2] & 0x80) != 0) && IsValidPointer(processor_))
+            {
+                processor_->RequestNMI();
+            }
+            break;
+        }
+        case 1:
+        {
+            registers_[1] = latch_;
+            UpdateSprite0Prediction();
+            break;
+        }
         case 2:
         {
-            Log("Writing to PPU register $%02X: 0x%02X, address, value");
+            LogDebug(kLogVideo, "Writing to PPU register $%02X: 0x%02X", address, value);
+            break;
+        }
+        case 4:
+        {
+            u8 oam_address = registers_[3];
+            oam_[oam_address] = latch_;
+            registers_[3] = oam_address + 1;
+            if (oam_address < 4)
+            {
+                UpdateSprite0Prediction();
+            }
             break;
         }
         case 5:
+        {
+            if (!w_)
+            {
+                t_ = (t_ & ~0x001F) | (latch_ >> 3);
+                x_ = latch_ & 0x07;
+            }
+            else
+            {
+                t_ = (t_ & ~0x73E0) | ((latch_ & 0x07) << 12) | ((latch_ & 0xF8) << 2);
+            }
+            w_ = !w_;
+            break;
+        }
         case 6:
         {
-            registers_[address] = latch_;
+            if (!w_)
+            {
+                t_ = (t_ & 0x00FF) | ((latch_ & 0x3F) << 8);
+            }
+            else
+            {
+                t_ = (t_ & 0xFF00) | latch_;
+                v_ = t_;
+
+                // Keep the rest of the line on the new tile
+                if ((line >= 0) && (render_line_ == line))
+                {
+                    render_h_ = ((((v_ >> 5) & 0x20) | (v_ & 0x1F)) - ((render_x_ + x_) >> 3)) & 0x3F;
+                }
+            }
+            w_ = !w_;
+            break;
+        }
+        case 7:
+        {
+            WriteVRAM(v_, latch_);
+            v_ = (v_ + (((registers_[0] & 0x04) != 0) ? 32 : 1)) & 0x7FFF;
             break;
         }
         default:
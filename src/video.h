@@ -21,12 +21,20 @@
 #define	VIDEO_H_
 
 #include "common.h"
+#include "scheduler.h"
+#include "cartridge.h"
+#include "chr_cache.h"
 
 namespace Gearnes
 {
 
 const int NES_WIDTH = 256;
 const int NES_HEIGHT = 240;
+const int NES_PPU_CYCLES_PER_LINE = 341;
+const int NES_LINES_PER_FRAME = 262;
+const int NES_PPU_CYCLES_PER_FRAME = NES_PPU_CYCLES_PER_LINE * NES_LINES_PER_FRAME;
+const int NES_VBLANK_LINE = 241;
+const int NES_PRERENDER_LINE = 261;
 
 struct NES_Color
 {
@@ -36,25 +44,159 @@ struct NES_Color
     u8 alpha;
 };
 
+class Memory;
+class Palette;
+class VideoPipeline;
+struct stCompositorLine;
+typedef int (*CompositorFunction)(const stCompositorLine& line, int x_start, int x_end);
+
 class Video
 {
 public:
     Video();
     ~Video();
-    void Init();
+    void Init(Cartridge* cartridge, Scheduler* scheduler, g6502::G6502<Memory>* processor);
+    void InitReplica(Cartridge* cartridge, Scheduler* scheduler, Palette* palette);
     void Reset();
-    bool Tick(unsigned int clock_cycles, NES_Color* frame_buffer);
+    void SetPipeline(VideoPipeline* pipeline);
+    void SyncPipeline();
+    void SetFrameBuffer(NES_Color* frame_buffer);
+    void SetIndexedFrameBuffer(u8* frame_buffer);
+    Palette* GetPalette();
+    void SetMirroring(NES_Mirroring mirroring);
+    void MapNametable(int nametable, int vram_page);
+    void MapCHR(u16 address, int size, int offset);
+    void SetCompositor(CompositorFunction compositor);
+    void CatchUp();
+    void StartVBlank();
+    void Sprite0Hit();
+    unsigned int OAMDMA(const u8* data);
+    u64 GetNextNMITime() const;
+    u64 GetNextSprite0HitTime() const;
+    unsigned int GetStatusIdleLimit();
     u8 Read(u16 address);
     void Write(u16 address, u8 value);
 
 private:
+    void Sync(u64 timestamp);
     void ScanLine(int line);
+    void RenderSegment(int line, int x_end);
+    void EvaluateSprites(int line);
+    void RenderBackground(int x_start, int x_end);
+    void ComposePixels(int line, int x_start, int x_end);
+    void TestSprite0Hit(int x_start, int x_end);
+    void UpdateSprite0Prediction();
+    int RenderToNow();
+    bool IsSprite0Line(int line) const;
+    int GetRenderingLine() const;
+    void IncrementY();
+    u8 ReadVRAM(u16 address) const;
+    const u8* GetPatternRow(int address) const;
+    void WriteVRAM(u16 address, u8 value);
+    u64 GetLineTime(int line, int cycle) const;
 
 private:
+    Cartridge* cartridge_;
+    Scheduler* scheduler_;
+    g6502::G6502<Memory>* processor_;
+    NES_Color* frame_buffer_;
+    u8* indexed_frame_buffer_;
+    Palette* output_palette_;
     u8 registers_[8];
     u8 latch_;
+    u8 oam_[0x100];
+    u8 palette_[0x20];
+    u8 vram_[0x1000];
+    u8* chr_;
+    CHRCache* chr_cache_;
+    // PPU address space in 1 KB pages, so fetches never do any mirroring
+    // or banking math: 0-7 are the pattern tables in CHR memory, 8-11 the
+    // nametables in VRAM and 12-15 mirror 8-11. Mappers move them with
+    // MapCHR(), SetMirroring() and MapNametable().
+    u8* pages_[16];
+    // CHR cache rows of each pattern table page
+    const u8* pattern_rows_[8];
+    u8 read_buffer_;
+    // Loopy registers: current and temporary VRAM address, fine X, write toggle
+    u16 v_;
+    u16 t_;
+    u8 x_;
+    bool w_;
+    // The PPU only runs when somebody looks at it. frame_cycle_ is the
+    // PPU cycle reached so far, counted from frame_start_.
+    u64 frame_start_;
+    int frame_cycle_;
+    // Visible lines are drawn whole at dot 256 unless a register changes
+    // mid-line; then they are drawn in segments up to each change
+    int render_line_;
+    int render_x_;
+    int render_h_;
+    // Whole tiles are written, with a tile of slack on both sides for
+    // fine X and segment edges. Pixel x lives at bg_line_[8 + x].
+    u8 bg_line_[8 + NES_WIDTH + 8];
+    u8 sprite_line_[NES_WIDTH];
+    CompositorFunction compositor_;
+    // No frame buffer of either kind: the PPU keeps its timing and status
+    // flags but only draws what sprite 0 hit needs
+    bool skip_rendering_;
+    // X of sprite 0 on render_line_, or -1 when it isn't there
+    int sprite0_x_;
+    // Rendering is done by a replica on another thread, this one only
+    // keeps the timing and feeds it
+    VideoPipeline* pipeline_;
+    // This is that replica. It draws with the palette of the other Video
+    // and keeps its own copy of CHR RAM, since the CPU side writes it
+    // ahead of time.
+    bool replica_;
+    u8* chr_copy_;
+    int chr_copy_size_;
 };
 
+// Master clock timestamp of a PPU cycle in the current frame
+inline u64 Video::GetLineTime(int line, int cycle) const
+{
+    return frame_start_ + static_cast<u64>((line * NES_PPU_CYCLES_PER_LINE) + cycle) * kMasterCyclesPerPPUCycle;
+}
+
+// Runs the PPU up to the current CPU timestamp
+inline void Video::CatchUp()
+{
+    Sync(scheduler_->GetClockCycles());
+}
+
+inline u64 Video::GetNextNMITime() const
+{
+    return ((registers_[0] & 0x80) != 0) ? scheduler_->GetEventTime(kSchedulerEventVBlank) : kSchedulerNever;
+}
+
+inline u64 Video::GetNextSprite0HitTime() const
+{
+    return scheduler_->GetEventTime(kSchedulerEventSprite0Hit);
+}
+
+inline u8 Video::ReadVRAM(u16 address) const
+{
+    address &= 0x3FFF;
+
+    if (address < 0x3F00)
+    {
+        return pages_[address >> 10][address & 0x03FF];
+    }
+    else
+    {
+        // $3F10/$3F14/$3F18/$3F1C mirror the background entries
+        u8 index = address & 0x1F;
+        return palette_[((index & 0x13) == 0x10) ? (index & 0x0F) : index];
+    }
+}
+
+// Decoded pixels of the pattern table row whose low bitplane byte is at
+// address, see CHRCache
+inline const u8* Video::GetPatternRow(int address) const
+{
+    return pattern_rows_[address >> 10] + ((((address & 0x03FF) >> 4) << 6) | ((address & 0x07) << 3));
+}
+
 } // namespace Gearnes
 
-#endif // GD_VIDEO_H_
+#endif // VIDEO_H_
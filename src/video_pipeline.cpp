@@ -0,0 +1,269 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "video_pipeline.h"
+
+namespace Gearnes
+{
+
+VideoPipeline::VideoPipeline()
+{
+    replica_ = new Video();
+    scheduler_ = new Scheduler();
+    commands_ = new stVideoCommand[kCapacity];
+    memset(oam_dma_, 0, 0x100);
+    running_ = false;
+    sleeping_.store(false);
+    spin_checks_ = (std::thread::hardware_concurrency() > 1) ? (1 << 14) : 0;
+    head_.store(0);
+    pending_head_ = 0;
+    tail_.store(0);
+    cached_tail_ = 0;
+}
+
+VideoPipeline::~VideoPipeline()
+{
+    if (running_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        work_condition_.notify_one();
+        thread_.join();
+    }
+
+    SafeDeleteArray(commands_);
+    SafeDelete(replica_);
+    SafeDelete(scheduler_);
+}
+
+// The replica draws with palette, which stays owned by the caller
+void VideoPipeline::Init(Cartridge* cartridge, Palette* palette)
+{
+    scheduler_->Init(nullptr);
+    replica_->InitReplica(cartridge, scheduler_, palette);
+    running_ = true;
+    thread_ = std::thread(&VideoPipeline::Run, this);
+}
+
+// Called from Video::Reset() with its new frame start, before anything
+// else is queued
+void VideoPipeline::Reset(u64 timestamp)
+{
+    WaitIdle();
+    scheduler_->Reset();
+    scheduler_->SetClockCycles(timestamp);
+    replica_->Reset();
+}
+
+void VideoPipeline::SetCompositor(CompositorFunction compositor)
+{
+    WaitIdle();
+    replica_->SetCompositor(compositor);
+}
+
+// One of the buffers is nullptr, both to skip rendering. The render
+// thread owns the buffer until EndFrame() returns.
+void VideoPipeline::SetFrameBuffer(u64 timestamp, NES_Color* frame_buffer, u8* indexed_frame_buffer)
+{
+    if (IsValidPointer(indexed_frame_buffer))
+    {
+        Push(kVideoCommandIndexedFrameBuffer, timestamp, 0, 0, 0, indexed_frame_buffer);
+    }
+    else
+    {
+        Push(kVideoCommandFrameBuffer, timestamp, 0, 0, 0, frame_buffer);
+    }
+}
+
+void VideoPipeline::OAMDMA(u64 timestamp, const u8* data)
+{
+    for (int i = 0; i < 0x40; i++)
+    {
+        u32 bytes = data[i << 2] | (data[(i << 2) + 1] << 8) | (data[(i << 2) + 2] << 16) | (static_cast<u32>(data[(i << 2) + 3]) << 24);
+        Push(kVideoCommandOAMDMA, timestamp, static_cast<u16>(i), 0, bytes, nullptr);
+    }
+}
+
+void VideoPipeline::MapCHR(u64 timestamp, u16 address, int size, int offset)
+{
+    Push(kVideoCommandMapCHR, timestamp, address, static_cast<u8>(size >> 10), static_cast<u32>(offset), nullptr);
+}
+
+void VideoPipeline::MapNametable(u64 timestamp, int nametable, int vram_page)
+{
+    Push(kVideoCommandMapNametable, timestamp, static_cast<u16>(nametable), static_cast<u8>(vram_page), 0, nullptr);
+}
+
+void VideoPipeline::Sprite0Hit(u64 timestamp)
+{
+    Push(kVideoCommandSprite0Hit, timestamp, 0, 0, 0, nullptr);
+}
+
+// Lets the render thread draw up to timestamp now instead of waiting for
+// more commands
+void VideoPipeline::Sync(u64 timestamp)
+{
+    Push(kVideoCommandSync, timestamp, 0, 0, 0, nullptr);
+    Publish();
+    Notify();
+}
+
+// Returns once the frame is in the frame buffer
+void VideoPipeline::EndFrame(u64 timestamp)
+{
+    Push(kVideoCommandStartVBlank, timestamp, 0, 0, 0, nullptr);
+    WaitIdle();
+}
+
+// Only when the render thread sleeps. Either it sees the command pushed
+// before the fence or this sees sleeping_; taking the mutex orders the
+// notification after its last check, so the wake up can't be lost.
+void VideoPipeline::Notify()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!sleeping_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    work_condition_.notify_one();
+}
+
+// Blocks until the render thread has replayed everything queued. The
+// replica can be used from this thread until the next command.
+void VideoPipeline::WaitIdle()
+{
+    Publish();
+    Notify();
+
+    for (int i = 0; i < spin_checks_; i++)
+    {
+        if (IsEmpty())
+        {
+            return;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_condition_.wait(lock, [this] { return IsEmpty(); });
+}
+
+void VideoPipeline::Run()
+{
+    while (true)
+    {
+        u64 tail = tail_.load(std::memory_order_relaxed);
+        u64 head = head_.load(std::memory_order_acquire);
+
+        for (int i = 0; (tail == head) && (i < spin_checks_); i++)
+        {
+            head = head_.load(std::memory_order_acquire);
+        }
+
+        if (tail == head)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_condition_.notify_all();
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            work_condition_.wait(lock, [this] { return !IsEmpty() || !running_; });
+            sleeping_.store(false, std::memory_order_relaxed);
+
+            if (!running_)
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        // Slots are handed back in small groups so a full queue drains
+        // without a store per command
+        while (tail != head)
+        {
+            Execute(commands_[tail & (kCapacity - 1)]);
+            tail++;
+
+            if ((tail & 0xFF) == 0)
+            {
+                tail_.store(tail, std::memory_order_release);
+            }
+        }
+
+        tail_.store(tail, std::memory_order_release);
+    }
+}
+
+void VideoPipeline::Execute(const stVideoCommand& command)
+{
+    scheduler_->SetClockCycles(command.time);
+
+    switch (command.type)
+    {
+        case kVideoCommandRead:
+            replica_->Read(command.address);
+            break;
+        case kVideoCommandWrite:
+            replica_->Write(command.address, command.value);
+            break;
+        case kVideoCommandOAMDMA:
+        {
+            u8* bytes = oam_dma_ + (command.address << 2);
+            bytes[0] = command.data & 0xFF;
+            bytes[1] = (command.data >> 8) & 0xFF;
+            bytes[2] = (command.data >> 16) & 0xFF;
+            bytes[3] = command.data >> 24;
+
+            if (command.address == 0x3F)
+            {
+                replica_->OAMDMA(oam_dma_);
+            }
+            break;
+        }
+        case kVideoCommandMapCHR:
+            replica_->MapCHR(command.address, command.value << 10, static_cast<int>(command.data));
+            break;
+        case kVideoCommandMapNametable:
+            replica_->MapNametable(command.address, command.value);
+            break;
+        case kVideoCommandSprite0Hit:
+            replica_->Sprite0Hit();
+            break;
+        case kVideoCommandStartVBlank:
+            replica_->StartVBlank();
+            break;
+        case kVideoCommandFrameBuffer:
+            replica_->SetFrameBuffer(static_cast<NES_Color*>(command.pointer));
+            break;
+        case kVideoCommandIndexedFrameBuffer:
+            replica_->SetIndexedFrameBuffer(static_cast<u8*>(command.pointer));
+            break;
+        case kVideoCommandSync:
+            replica_->CatchUp();
+            break;
+    }
+}
+
+} // namespace Gearnes
@@ -0,0 +1,182 @@
+/*
+ * Gearnes - NES / Famicom Emulator
+ * Copyright (C) 2015  Ignacio Sanchez Gines
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef VIDEO_PIPELINE_H_
+#define	VIDEO_PIPELINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "common.h"
+#include "video.h"
+
+namespace Gearnes
+{
+
+enum Video_Command
+{
+    kVideoCommandRead,
+    kVideoCommandWrite,
+    kVideoCommandOAMDMA,
+    kVideoCommandMapCHR,
+    kVideoCommandMapNametable,
+    kVideoCommandSprite0Hit,
+    kVideoCommandStartVBlank,
+    kVideoCommandFrameBuffer,
+    kVideoCommandIndexedFrameBuffer,
+    kVideoCommandSync
+};
+
+// Something the CPU did to the PPU, at master clock time
+struct stVideoCommand
+{
+    u64 time;
+    // Frame buffers
+    void* pointer;
+    // OAM bytes, CHR offset
+    u32 data;
+    u16 address;
+    u8 type;
+    u8 value;
+};
+
+// Renders on a second thread. The Video the CPU talks to runs in
+// render-skip mode, so everything the CPU reads ($2002, $2007, sprite 0
+// hit, NMI timing) is still answered on its own thread and exactly. What
+// can change the picture is queued with its timestamp, and a replica
+// Video on the render thread replays it at the same times, so frames are
+// bit-identical to rendering on one thread. The replica draws a few lines
+// behind the CPU, and StartVBlank waits for it to finish the frame.
+class VideoPipeline
+{
+public:
+    VideoPipeline();
+    ~VideoPipeline();
+    void Init(Cartridge* cartridge, Palette* palette);
+    void Reset(u64 timestamp);
+    void SetCompositor(CompositorFunction compositor);
+    void SetFrameBuffer(u64 timestamp, NES_Color* frame_buffer, u8* indexed_frame_buffer);
+    void Read(u64 timestamp, u16 address);
+    void Write(u64 timestamp, u16 address, u8 value);
+    void OAMDMA(u64 timestamp, const u8* data);
+    void MapCHR(u64 timestamp, u16 address, int size, int offset);
+    void MapNametable(u64 timestamp, int nametable, int vram_page);
+    void Sprite0Hit(u64 timestamp);
+    void Sync(u64 timestamp);
+    void EndFrame(u64 timestamp);
+
+private:
+    void Push(Video_Command type, u64 timestamp, u16 address, u8 value, u32 data, void* pointer);
+    void Publish();
+    void Notify();
+    void WaitIdle();
+    bool IsEmpty() const;
+    void Run();
+    void Execute(const stVideoCommand& command);
+
+private:
+    static const int kCapacity = 1 << 13;
+    // Commands are made visible to the render thread in groups, it only
+    // needs them all at each sync
+    static const int kPublishInterval = 64;
+
+
+    Video* replica_;
+    Scheduler* scheduler_;
+    stVideoCommand* commands_;
+    // OAM DMA goes in 4 byte pieces, gathered here
+    u8 oam_dma_[0x100];
+    std::thread thread_;
+    std::mutex mutex_;
+    // Wakes the render thread, and the CPU thread waiting for it
+    std::condition_variable work_condition_;
+    std::condition_variable idle_condition_;
+    bool running_;
+    // The render thread is waiting on work_condition_, or about to
+    std::atomic<bool> sleeping_;
+    // Checks of the queue before a thread goes to sleep on it, since
+    // waking up takes longer than the few lines of work between syncs.
+    // None with a single core, where spinning only delays the other side.
+    int spin_checks_;
+    // Each side on its own cache line
+    u8 padding_head_[64];
+    std::atomic<u64> head_;
+    u64 pending_head_;
+    u64 cached_tail_;
+    u8 padding_tail_[64];
+    std::atomic<u64> tail_;
+};
+
+inline void VideoPipeline::Read(u64 timestamp, u16 address)
+{
+    Push(kVideoCommandRead, timestamp, address, 0, 0, nullptr);
+}
+
+inline void VideoPipeline::Write(u64 timestamp, u16 address, u8 value)
+{
+    Push(kVideoCommandWrite, timestamp, address, value, 0, nullptr);
+}
+
+inline void VideoPipeline::Push(Video_Command type, u64 timestamp, u16 address, u8 value, u32 data, void* pointer)
+{
+    u64 head = pending_head_;
+
+    if ((head - cached_tail_) >= static_cast<u64>(kCapacity))
+    {
+        Publish();
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+
+        while ((head - cached_tail_) >= static_cast<u64>(kCapacity))
+        {
+            Notify();
+            std::this_thread::yield();
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+    }
+
+    stVideoCommand* command = &commands_[head & (kCapacity - 1)];
+    command->time = timestamp;
+    command->pointer = pointer;
+    command->data = data;
+    command->address = address;
+    command->type = static_cast<u8>(type);
+    command->value = value;
+
+    pending_head_ = head + 1;
+
+    if ((pending_head_ % kPublishInterval) == 0)
+    {
+        Publish();
+    }
+}
+
+inline void VideoPipeline::Publish()
+{
+    head_.store(pending_head_, std::memory_order_release);
+}
+
+inline bool VideoPipeline::IsEmpty() const
+{
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+} // namespace Gearnes
+
+#endif // VIDEO_PIPELINE_H_